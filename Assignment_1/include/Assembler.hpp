@@ -0,0 +1,67 @@
+// Header guards
+#ifndef ASSEMBLER_HPP_
+#define ASSEMBLER_HPP_
+//---------------------------------------------------------------------------------------------------------------------
+// Libraries
+#include<vector>
+#include<utility>
+#include "SparseMatrix.hpp"
+//---------------------------------------------------------------------------------------------------------------------
+// SparseAssembler class declaration
+/* Builder for CSR matrices: (i,j,v) triplets are just appended to a buffer (O(1) each, in any order and with
+   repetitions), then finalize() builds the CSR matrix in a single sort-and-compress pass, summing the values of
+   repeated (i,j) as finite element assembly requires. There is one buffer per thread: the thread t only appends
+   to the buffer t, so threads can add triplets at the same time without any synchronization. */
+template <typename T>
+class SparseAssembler{
+public:
+    // Constructor
+    SparseAssembler(const unsigned int &nr,
+                    const unsigned int &nc,
+                    const unsigned int &n_buffers=1);
+    // Destructor
+    ~SparseAssembler() {std::cout<<"Destructed SparseAssembler"<<std::endl;}
+
+    // Method to get the number of rows
+    unsigned int get_nrows()const{return n_rows;}
+    // Method to get the number of columns
+    unsigned int get_ncols()const{return n_cols;}
+    // Method to get the number of buffers (i.e. of threads that can add triplets at the same time)
+    unsigned int get_nbuffers()const{return buffers.size();}
+    // Method to get the number of triplets added so far (repetitions included)
+    unsigned long long get_ntriplets()const;
+    // Method to get the number of threads used by finalize
+    unsigned int get_threads()const{return n_threads;}
+    // Method to set the number of threads used by finalize (1 = serial, 0 = all available cores)
+    void set_threads(const unsigned int &nt){
+        n_threads = (nt==0) ? std::max(1u, std::thread::hardware_concurrency()) : nt;
+    }
+    // Method to reserve space for n triplets in a buffer
+    void reserve(const unsigned int &n, const unsigned int &buffer=0){buffers[buffer].reserve(n);}
+    // Method to add the triplet (i,j,v) to a buffer (different threads must use different buffers)
+    void add(const unsigned int i, const unsigned int j, const T v, const unsigned int buffer=0){
+        assert(i<n_rows && j<n_cols && buffer<buffers.size());
+        buffers[buffer].push_back({i, j, v});
+    }
+    // Method to build the CSR matrix (repeated entries are summed, zeros are dropped) and empty the buffers
+    SparseMatrixCSR<T>* finalize();
+
+private:
+    // Struct with a single triplet
+    struct Triplet{
+        unsigned int row;
+        unsigned int col;
+        T value;
+    };
+
+    // Attributes of the class SparseAssembler
+    unsigned int n_rows;
+    unsigned int n_cols;
+    std::vector<std::vector<Triplet>> buffers;
+    // Number of threads used by finalize (by default we keep the serial version)
+    unsigned int n_threads=1;
+};
+//---------------------------------------------------------------------------------------------------------------------
+//Link to the definition file
+#include "Assembler.tpl.hpp"
+#endif
@@ -0,0 +1,91 @@
+//---------------------------------------------------------------------------------------------------------------------
+// SparseAssembler definitions
+// SparseAssembler constructor
+template <typename T>
+SparseAssembler<T>::SparseAssembler(const unsigned int &nr,
+                                    const unsigned int &nc,
+                                    const unsigned int &n_buffers) : n_rows(nr), n_cols(nc),
+    buffers(std::max(1u, n_buffers)) {};
+
+// Method to get the number of triplets added so far
+template <typename T>
+unsigned long long SparseAssembler<T>::get_ntriplets()const{
+    unsigned long long total = 0;
+    for(const std::vector<Triplet> &buffer : buffers){
+        total += buffer.size();
+    }
+    return total;
+}
+
+// Method to build the CSR matrix
+template <typename T>
+SparseMatrixCSR<T>* SparseAssembler<T>::finalize(){
+    /* We proceed in three steps:
+        1) counting sort of the triplets (of all the buffers) on the row index: histogram of the rows,
+           cumulative sum and scatter of the (column, value) pairs in the range of their row;
+        2) each row is sorted by column and compressed, summing the values of equal columns and dropping zeros
+           (rows are independent, so they are split among threads with the same number of triplets);
+        3) the compressed rows are copied one after the other in the vectors of the CSR matrix.
+       Steps 1 and 3 are linear in the number of triplets, step 2 is O(row_nnz*log(row_nnz)) for each row */
+    const unsigned long long n_triplets = get_ntriplets();
+    assert(n_triplets<=UINT_MAX);
+    // (1) Counting sort on the rows
+    std::vector<unsigned int> raw_idx(n_rows+1, 0);
+    for(const std::vector<Triplet> &buffer : buffers){
+        for(const Triplet &triplet : buffer){
+            raw_idx[triplet.row+1]++;
+        }
+    }
+    for(unsigned int i=0; i<n_rows; i++){
+        raw_idx[i+1] += raw_idx[i];
+    }
+    std::vector<std::pair<unsigned int, T>> entries(n_triplets);
+    {
+        std::vector<unsigned int> position(raw_idx.begin(), raw_idx.end()-1);
+        for(std::vector<Triplet> &buffer : buffers){
+            for(const Triplet &triplet : buffer){
+                entries[position[triplet.row]++] = {triplet.col, triplet.value};
+            }
+            // The buffers are emptied (memory included) as soon as they are not needed anymore
+            std::vector<Triplet>().swap(buffer);
+        }
+    }
+    // (2) Sort and compress each row (in place: the compressed row is written at the beginning of its range)
+    std::vector<unsigned int> rows_idx(n_rows+1, 0);
+    run_blocks(nnz_partition(raw_idx, std::max(1u, std::min(n_threads, n_rows))),
+               [&](const unsigned int first, const unsigned int last){
+        for(unsigned int i=first; i<last; i++){
+            auto begin = entries.begin()+raw_idx[i], end = entries.begin()+raw_idx[i+1];
+            std::sort(begin, end, [](const std::pair<unsigned int, T> &a, const std::pair<unsigned int, T> &b){
+                return a.first < b.first;
+            });
+            auto out = begin;
+            for(auto it=begin; it!=end;){
+                std::pair<unsigned int, T> entry = *it;
+                for(++it; it!=end && it->first==entry.first; ++it){
+                    entry.second += it->second;
+                }
+                if(entry.second!=T(0)){
+                    *out++ = entry;
+                }
+            }
+            // For now rows_idx[i+1] holds the number of nonzeros of the row
+            rows_idx[i+1] = out-begin;
+        }
+    });
+    // (3) Cumulative sum of the row lengths and copy of the compressed rows
+    for(unsigned int i=0; i<n_rows; i++){
+        rows_idx[i+1] += rows_idx[i];
+    }
+    std::vector<T> values(rows_idx[n_rows]);
+    std::vector<unsigned int> cols(rows_idx[n_rows]);
+    for(unsigned int i=0; i<n_rows; i++){
+        for(unsigned int k=0; k<rows_idx[i+1]-rows_idx[i]; k++){
+            cols[rows_idx[i]+k] = entries[raw_idx[i]+k].first;
+            values[rows_idx[i]+k] = entries[raw_idx[i]+k].second;
+        }
+    }
+    SparseMatrixCSR<T>* matrix = new SparseMatrixCSR<T>{n_rows, n_cols, values, cols, rows_idx};
+    matrix->set_threads(n_threads);
+    return matrix;
+}
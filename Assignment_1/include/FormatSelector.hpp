@@ -0,0 +1,83 @@
+// Header guards
+#ifndef FORMATSELECTOR_HPP_
+#define FORMATSELECTOR_HPP_
+//---------------------------------------------------------------------------------------------------------------------
+// Libraries
+#include<vector>
+#include<string>
+#include<utility>
+#include<stdexcept>
+#include "SparseMatrix.hpp"
+#include "Reordering.hpp"
+//---------------------------------------------------------------------------------------------------------------------
+// Formats that the selector can choose
+enum class Format {CSR, SELL, BSR, Symmetric, HYB, Tiled};
+
+// Function to get the name of a format
+inline std::string format_name(const Format &format);
+
+//---------------------------------------------------------------------------------------------------------------------
+// Statistics of the structure of a matrix (the ones that decide which format is the fastest for the product)
+struct MatrixStats{
+    unsigned int n_rows=0;
+    unsigned int n_cols=0;
+    unsigned long long nnz=0;
+    double row_mean=0.;             // mean number of nonzeros per row
+    double row_variance=0.;         // variance of the number of nonzeros per row
+    unsigned int max_row=0;         // number of nonzeros of the longest row
+    unsigned int block_size=1;      // largest b such that the matrix is made of (almost) dense bxb blocks (1 = none)
+    double block_density=1.;        // nonzeros over stored elements with blocks of block_size (1 = dense blocks)
+    unsigned int bandwidth=0;       // maximum |i-j| over the nonzeros
+    bool symmetric=false;           // the matrix is square and equal to its transpose
+    // Method to print the statistics
+    void print() const;
+};
+
+// Report of a selection: statistics, format predicted by them, times of the candidates (if benchmarked) and choice
+struct FormatReport{
+    MatrixStats stats;
+    Format predicted=Format::CSR;
+    std::vector<std::pair<Format, double>> times;   // ms per product of each candidate (empty without benchmark)
+    Format selected=Format::CSR;
+    // Method to print the report
+    void print() const;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// Function to copy any SparseMatrix in a (dynamically allocated) SparseMatrixCSR
+/* Each format is converted with its own conversion function, linear in the nonzeros: COO, CSR (also with 64-bit row
+   pointers), SELL, BSR (square blocks from 2x2 to 8x8), CSC, Dynamic, Symmetric, Mixed (float or bfloat16), Tiled
+   and HYB. Any other matrix makes it throw std::invalid_argument */
+template <typename T>
+SparseMatrixCSR<T>* copy_to_CSR(const SparseMatrix<T> &matrix);
+
+// Helper function to copy a SparseMatrixBSR with square blocks of size 2 to B in a SparseMatrixCSR (null otherwise)
+template <typename T, unsigned int B>
+SparseMatrixCSR<T>* copy_BSR_to_CSR(const SparseMatrix<T> &matrix);
+
+// Function to compute the statistics of the structure of a CSR matrix
+template <typename T>
+MatrixStats analyze(const SparseMatrixCSR<T> &matrix);
+
+// Function to compute the statistics of the structure of any SparseMatrix (through a CSR copy)
+template <typename T>
+MatrixStats analyze(const SparseMatrix<T> &matrix);
+
+// Function to predict the fastest format for the product from the statistics of a matrix with values of type T
+template <typename T>
+Format predict_format(const MatrixStats &stats);
+
+// Function to build a format from a CSR matrix (the CSR matrix is left unchanged; block_size is used by BSR)
+template <typename T>
+SparseMatrix<T>* build_format(const SparseMatrixCSR<T> &matrix, const Format &format, const unsigned int block_size=1);
+
+/* Function to convert any SparseMatrix into the fastest format for its product: without benchmark it is the format
+   predicted by the statistics, with benchmark all the formats that make sense for the matrix are built and their
+   product is timed on the matrix itself (with the threads of the input matrix). If report is not null it is filled
+   with the statistics and the times. As the conversion functions, it deletes the input matrix */
+template <typename T>
+SparseMatrix<T>* select_format(SparseMatrix<T> *matrix, const bool benchmark=true, FormatReport *report=nullptr);
+//---------------------------------------------------------------------------------------------------------------------
+//Link to the definition file
+#include "FormatSelector.tpl.hpp"
+#endif
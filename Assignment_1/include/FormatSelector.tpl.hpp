@@ -0,0 +1,255 @@
+//---------------------------------------------------------------------------------------------------------------------
+// Format selector definitions
+// Function to get the name of a format
+inline std::string format_name(const Format &format){
+    switch(format){
+        case Format::CSR: return "CSR";
+        case Format::SELL: return "SELL";
+        case Format::BSR: return "BSR";
+        case Format::Symmetric: return "Symmetric";
+        case Format::HYB: return "HYB";
+        case Format::Tiled: return "Tiled";
+    }
+    return "";
+}
+
+// Method to print the statistics of a matrix
+inline void MatrixStats::print() const{
+    std::cout<<"Size: "<<n_rows<<" x "<<n_cols<<", "<<nnz<<" nonzeros"<<std::endl;
+    std::cout<<"Nonzeros per row: mean "<<row_mean<<", standard deviation "<<std::sqrt(row_variance)
+             <<", maximum "<<max_row<<std::endl;
+    std::cout<<"Block size: "<<block_size<<" (density "<<block_density<<")"<<std::endl;
+    std::cout<<"Bandwidth: "<<bandwidth<<std::endl;
+    std::cout<<"Symmetric: "<<(symmetric ? "yes" : "no")<<std::endl;
+}
+
+// Method to print the report of a selection
+inline void FormatReport::print() const{
+    stats.print();
+    std::cout<<"Predicted format: "<<format_name(predicted)<<std::endl;
+    if(!times.empty()){
+        std::cout<<"Benchmark (ms per product): ";
+        for(const std::pair<Format, double> &candidate : times){
+            std::cout<<format_name(candidate.first)<<": "<<candidate.second<<"  ";
+        }
+        std::cout<<std::endl;
+    }
+    std::cout<<"Selected format: "<<format_name(selected)<<std::endl;
+}
+
+// Helper function to copy a SparseMatrixBSR with square blocks of size B (or smaller, down to 2) in a SparseMatrixCSR
+template <typename T, unsigned int B>
+SparseMatrixCSR<T>* copy_BSR_to_CSR(const SparseMatrix<T> &matrix){
+    if(const SparseMatrixBSR<T,B,B> *bsr = dynamic_cast<const SparseMatrixBSR<T,B,B>*>(&matrix)){
+        return BSR_to_CSR(new SparseMatrixBSR<T,B,B>(*bsr));
+    }
+    if constexpr(B>2){
+        return copy_BSR_to_CSR<T,B-1>(matrix);
+    }
+    return nullptr;
+}
+
+// Function to copy any SparseMatrix in a SparseMatrixCSR
+template <typename T>
+SparseMatrixCSR<T>* copy_to_CSR(const SparseMatrix<T> &matrix){
+    // The conversion functions delete their input, so each one gets a copy of the matrix
+    if(const SparseMatrixCSR<T> *csr = dynamic_cast<const SparseMatrixCSR<T>*>(&matrix)){
+        return new SparseMatrixCSR<T>(*csr);
+    }
+    // (with 64-bit row pointers, the index types are converted back to the default ones)
+    typedef SparseMatrixCSR<T, unsigned int, unsigned long long> CSR64;
+    if(const CSR64 *csr = dynamic_cast<const CSR64*>(&matrix)){
+        return CSR_to_CSR<unsigned int, unsigned int>(new CSR64(*csr));
+    }
+    if(const SparseMatrixCOO<T> *coo = dynamic_cast<const SparseMatrixCOO<T>*>(&matrix)){
+        return COO_to_CSR(new SparseMatrixCOO<T>(*coo));
+    }
+    if(const SparseMatrixSELL<T> *sell = dynamic_cast<const SparseMatrixSELL<T>*>(&matrix)){
+        return SELL_to_CSR(new SparseMatrixSELL<T>(*sell));
+    }
+    if(const SparseMatrixTiled<T> *tiled = dynamic_cast<const SparseMatrixTiled<T>*>(&matrix)){
+        return Tiled_to_CSR(new SparseMatrixTiled<T>(*tiled));
+    }
+    if(SparseMatrixCSR<T> *copy = copy_BSR_to_CSR<T, 8>(matrix)){
+        return copy;
+    }
+    if(const SparseMatrixCSC<T> *csc = dynamic_cast<const SparseMatrixCSC<T>*>(&matrix)){
+        return CSC_to_CSR(new SparseMatrixCSC<T>(*csc));
+    }
+    if(const SparseMatrixDynamic<T> *dynamic = dynamic_cast<const SparseMatrixDynamic<T>*>(&matrix)){
+        return dynamic->freeze();
+    }
+    if(const SparseMatrixSymmetric<T> *symmetric = dynamic_cast<const SparseMatrixSymmetric<T>*>(&matrix)){
+        return Symmetric_to_CSR(new SparseMatrixSymmetric<T>(*symmetric));
+    }
+    if(const SparseMatrixHYB<T> *hyb = dynamic_cast<const SparseMatrixHYB<T>*>(&matrix)){
+        return HYB_to_CSR(new SparseMatrixHYB<T>(*hyb));
+    }
+    if(const SparseMatrixMixed<T, float> *mixed = dynamic_cast<const SparseMatrixMixed<T, float>*>(&matrix)){
+        return Mixed_to_CSR(new SparseMatrixMixed<T, float>(*mixed));
+    }
+    if(const SparseMatrixMixed<T, bfloat16> *mixed = dynamic_cast<const SparseMatrixMixed<T, bfloat16>*>(&matrix)){
+        return Mixed_to_CSR(new SparseMatrixMixed<T, bfloat16>(*mixed));
+    }
+    /* Any other format (e.g. BSR with rectangular blocks) would have to be read element by element, i.e. in
+       O(n_rows*n_cols): it is rejected instead */
+    throw std::invalid_argument("copy_to_CSR: the format of the matrix has no conversion to CSR");
+}
+
+// Function to compute the statistics of the structure of a CSR matrix
+template <typename T>
+MatrixStats analyze(const SparseMatrixCSR<T> &matrix){
+    MatrixStats stats;
+    const std::vector<unsigned int> &rows_idx = matrix.get_rows_idx();
+    const std::vector<unsigned int> &cols = matrix.get_cols();
+    stats.n_rows = matrix.get_nrows();
+    stats.n_cols = matrix.get_ncols();
+    stats.nnz = matrix.get_nzeros();
+    // (1) Row lengths: mean and variance (sum of the squares minus the square of the mean)
+    double sum_squares = 0.;
+    for(unsigned int i=0; i<stats.n_rows; i++){
+        const unsigned int length = rows_idx[i+1]-rows_idx[i];
+        stats.max_row = std::max(stats.max_row, length);
+        sum_squares += (double)length*length;
+    }
+    if(stats.n_rows>0){
+        stats.row_mean = (double)stats.nnz/stats.n_rows;
+        stats.row_variance = std::max(0., sum_squares/stats.n_rows - stats.row_mean*stats.row_mean);
+    }
+    // (2) Blocks: the largest size with at most 1.5 stored elements per nonzero, and its density
+    stats.block_size = detect_block_size(matrix, 1.5, &stats.block_density);
+    // (3) Bandwidth
+    stats.bandwidth = bandwidth(matrix);
+    // (4) Symmetry: the rows of the transpose come out sorted, as the ones of the matrix, so we compare the vectors
+    if(stats.n_rows==stats.n_cols){
+        std::vector<T> t_values;
+        std::vector<unsigned int> t_cols, t_rows_idx;
+        transpose_vectors(stats.n_cols, matrix.get_values(), cols, rows_idx, t_values, t_cols, t_rows_idx);
+        stats.symmetric = (t_rows_idx==rows_idx && t_cols==cols && t_values==matrix.get_values());
+    }
+    return stats;
+}
+
+// Function to compute the statistics of the structure of any SparseMatrix
+template <typename T>
+MatrixStats analyze(const SparseMatrix<T> &matrix){
+    SparseMatrixCSR<T> *copy = copy_to_CSR(matrix);
+    MatrixStats stats = analyze(*copy);
+    delete copy;
+    return stats;
+}
+
+// Function to predict the fastest format for the product
+template <typename T>
+Format predict_format(const MatrixStats &stats){
+    /* In order: the formats that read fewer bytes (half of the matrix, or one column per block), then the ones that
+       fix a bad access pattern (very different row lengths, x much larger than the cache), then SELL for regular
+       rows (SIMD on groups of rows) and CSR for everything else */
+    const double row_deviation = std::sqrt(stats.row_variance);
+    const unsigned int cache_columns = SparseMatrixTiled<T>::cache_columns();
+    if(stats.symmetric && stats.nnz>0){
+        return Format::Symmetric;
+    }
+    if(stats.block_size>1 && stats.block_density>=0.8){
+        return Format::BSR;
+    }
+    if(row_deviation>stats.row_mean && stats.max_row>16*stats.row_mean){
+        return Format::HYB;
+    }
+    if(stats.n_cols>2*cache_columns && stats.bandwidth>cache_columns){
+        return Format::Tiled;
+    }
+    if(row_deviation<=0.5*stats.row_mean){
+        return Format::SELL;
+    }
+    return Format::CSR;
+}
+
+// Function to build a format from a CSR matrix
+template <typename T>
+SparseMatrix<T>* build_format(const SparseMatrixCSR<T> &matrix, const Format &format, const unsigned int block_size){
+    SparseMatrixCSR<T> *copy = new SparseMatrixCSR<T>(matrix);
+    switch(format){
+        case Format::CSR: return copy;
+        case Format::SELL: return CSR_to_SELL(copy);
+        case Format::Symmetric: return CSR_to_Symmetric(copy);
+        case Format::HYB: return CSR_to_HYB(copy);
+        case Format::Tiled: return CSR_to_Tiled(copy);
+        case Format::BSR:
+            // The block size must be known at compile time: one instance for each size found by detect_block_size
+            switch(block_size){
+                case 2: return CSR_to_BSR<2,2>(copy);
+                case 3: return CSR_to_BSR<3,3>(copy);
+                case 4: return CSR_to_BSR<4,4>(copy);
+                case 5: return CSR_to_BSR<5,5>(copy);
+                case 6: return CSR_to_BSR<6,6>(copy);
+                case 7: return CSR_to_BSR<7,7>(copy);
+                case 8: return CSR_to_BSR<8,8>(copy);
+                default: break;
+            }
+            break;
+    }
+    // Formats that cannot be built (BSR without blocks) are left in CSR
+    return copy;
+}
+
+// Function to convert any SparseMatrix into the fastest format for its product
+template <typename T>
+SparseMatrix<T>* select_format(SparseMatrix<T> *matrix, const bool benchmark, FormatReport *report){
+    SparseMatrixCSR<T> *csr = copy_to_CSR(*matrix);
+    const unsigned int n_threads = matrix->get_threads();
+    csr->set_threads(n_threads);
+    /* Before analyzing the matrix, it makes sense to delete the initial version
+       Since we passed the input as a pointer, we can easily deallocate it with "delete" */
+    delete matrix;
+    FormatReport result;
+    result.stats = analyze(*csr);
+    result.predicted = predict_format<T>(result.stats);
+    result.selected = result.predicted;
+    SparseMatrix<T> *selected = nullptr;
+    if(benchmark){
+        // Candidates: CSR, SELL and all the formats whose conditions hold (even if not predicted)
+        const MatrixStats &stats = result.stats;
+        std::vector<Format> candidates{Format::CSR, Format::SELL};
+        if(stats.symmetric && stats.nnz>0) candidates.push_back(Format::Symmetric);
+        if(stats.block_size>1) candidates.push_back(Format::BSR);
+        if(stats.row_variance>0.) candidates.push_back(Format::HYB);
+        if(stats.n_cols>2*SparseMatrixTiled<T>::cache_columns()) candidates.push_back(Format::Tiled);
+        std::vector<T> x(stats.n_cols), y(stats.n_rows);
+        for(unsigned int k=0; k<stats.n_cols; k++){
+            x[k] = T(1)/T(1+k%7);
+        }
+        double best_time = std::numeric_limits<double>::max();
+        for(const Format candidate : candidates){
+            SparseMatrix<T> *built = build_format(*csr, candidate, stats.block_size);
+            built->set_threads(n_threads);
+            // One product to warm up the caches, then the best time of 5 products
+            built->multiply(T(1), x, T(0), y);
+            double time = std::numeric_limits<double>::max();
+            for(unsigned int rep=0; rep<5; rep++){
+                auto start = std::chrono::steady_clock::now();
+                built->multiply(T(1), x, T(0), y);
+                time = std::min(time, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()-start).count());
+            }
+            result.times.push_back({candidate, time});
+            if(time<best_time){
+                best_time = time;
+                result.selected = candidate;
+                delete selected;
+                selected = built;
+            }
+            else{
+                delete built;
+            }
+        }
+    }
+    else{
+        selected = build_format(*csr, result.selected, result.stats.block_size);
+        selected->set_threads(n_threads);
+    }
+    delete csr;
+    if(report!=nullptr){
+        *report = result;
+    }
+    return selected;
+}
@@ -0,0 +1,146 @@
+// Header guards
+#ifndef MATRIXIO_HPP_
+#define MATRIXIO_HPP_
+//---------------------------------------------------------------------------------------------------------------------
+// Libraries
+#include<vector>
+#include<string>
+#include<cstdint>
+#include<stdexcept>
+#include "SparseMatrix.hpp"
+#include "Assembler.hpp"
+//---------------------------------------------------------------------------------------------------------------------
+// (1) Matrix Market files
+/* Function to read a "coordinate" Matrix Market file (real, integer or pattern; general, symmetric or skew-symmetric).
+   The file is read in chunks of chunk_size bytes and each chunk is parsed straight into a SparseAssembler (split
+   among n_threads threads, each one writing its own buffer), so the whole text is never in memory at once. Repeated
+   entries are summed and explicit zeros are dropped (see SparseAssembler::finalize). It throws std::runtime_error if
+   the file cannot be read or is not a valid coordinate Matrix Market file */
+template <typename T>
+SparseMatrixCSR<T>* read_matrix_market(const std::string &path, const unsigned int &n_threads=1,
+                                       const unsigned int &chunk_size=1u<<24);
+
+// Function to write a matrix in a "coordinate real general" Matrix Market file (values with all their digits)
+template <typename T>
+void write_matrix_market(const SparseMatrixCSR<T> &matrix, const std::string &path);
+
+//---------------------------------------------------------------------------------------------------------------------
+// (2) Binary CSR files
+/* Layout of a binary CSR file (native byte order): the header, then values, cols and rows_idx one after the other,
+   each one starting at a multiple of 64 bytes (so that, once the file is mapped in memory, they are aligned).
+   The checksum is the 64-bit FNV-1a hash of all the bytes of the header before it */
+struct BinaryHeader{
+    char magic[8];                  // "SPARSCSR"
+    std::uint32_t version;          // version of the format (1)
+    std::uint32_t value_size;       // sizeof(T)
+    std::uint32_t value_float;      // 1 if T is a floating point type, 0 if it is an integer type
+    std::uint32_t index_size;       // sizeof of the column indices
+    std::uint32_t offset_size;      // sizeof of the row pointers
+    std::uint32_t n_rows;
+    std::uint32_t n_cols;
+    std::uint32_t reserved;
+    std::uint64_t nnz;
+    std::uint64_t values_offset;    // offset (in bytes, from the beginning of the file) of each vector
+    std::uint64_t cols_offset;
+    std::uint64_t rows_idx_offset;
+    std::uint64_t checksum;
+};
+
+// Function to write a CSR matrix in a binary CSR file
+template <typename T>
+void write_binary(const SparseMatrixCSR<T> &matrix, const std::string &path);
+
+//---------------------------------------------------------------------------------------------------------------------
+// ArrayView class declaration
+/* Read-only view of a contiguous array that belongs to someone else (e.g. a memory-mapped file): it has the
+   same read interface of a const std::vector, but it does not own (nor copy) the elements */
+template <typename U>
+class ArrayView{
+public:
+    typedef U value_type;
+    // Constructors
+    ArrayView() = default;
+    ArrayView(const U *d, const std::size_t n) : ptr(d), length(n) {};
+
+    // Methods to access the elements
+    const U* data()const{return ptr;}
+    std::size_t size()const{return length;}
+    bool empty()const{return length==0;}
+    const U &operator[](const std::size_t k)const{return ptr[k];}
+    const U &back()const{return ptr[length-1];}
+    const U* begin()const{return ptr;}
+    const U* end()const{return ptr+length;}
+    // Method to copy the elements in a std::vector
+    std::vector<U> to_vector()const{return std::vector<U>(ptr, ptr+length);}
+
+private:
+    const U *ptr=nullptr;
+    std::size_t length=0;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// MappedMatrixCSR class declaration
+/* Read-only CSR matrix whose vectors live in a binary CSR file mapped in memory: opening it is O(1) (only the header
+   is read and checked, the pages of values, cols and rows_idx are loaded by the OS when the products touch them),
+   and get_values(), get_cols() and get_rows_idx() are zero-copy views on the mapping.
+   It has the same products of SparseMatrixCSR (same kernels), so it can be used directly by the solvers,
+   e.g. SolverCG<T, MappedMatrixCSR<T>>. The constructor throws std::runtime_error if the file cannot be mapped,
+   if the header is corrupted (wrong magic or checksum), or if it was written with other value or index types.
+   The checksum covers only the header, and the constructor checks only the first and the last row pointers: the
+   body of the file is trusted, so a file that does not come from write_binary should be checked with validate()
+   (O(nnz)) before any product, since a wrong row pointer or column index would be read out of the mapping */
+template <typename T>
+class MappedMatrixCSR{
+public:
+    // Constructor
+    MappedMatrixCSR(const std::string &path);
+    // The mapping cannot be shared, so the class cannot be copied
+    MappedMatrixCSR(const MappedMatrixCSR &) = delete;
+    MappedMatrixCSR &operator=(const MappedMatrixCSR &) = delete;
+    // Destructor (it unmaps the file)
+    ~MappedMatrixCSR();
+
+    // Method to get the number of rows
+    unsigned int get_nrows()const{return n_rows;}
+    // Method to get the number of columns
+    unsigned int get_ncols()const{return n_cols;}
+    // Method to get the number of nonzeros
+    unsigned long long get_nzeros()const{return values.size();}
+    // Methods to get the (zero-copy) views of the vectors of the matrix
+    const ArrayView<T> &get_values()const{return values;}
+    const ArrayView<unsigned int> &get_cols()const{return cols;}
+    const ArrayView<unsigned int> &get_rows_idx()const{return rows_idx;}
+    // Methods to get and set the number of threads used by the products (1 = serial, 0 = all available cores)
+    unsigned int get_threads()const{return n_threads;}
+    void set_threads(const unsigned int &nt){
+        n_threads = (nt==0) ? std::max(1u, std::thread::hardware_concurrency()) : nt;
+    }
+    // Method to compute y = alpha*A*x + beta*y in place (also on raw pointers)
+    void multiply(const T alpha, const std::vector<T> &x, const T beta, std::vector<T> &y)const;
+    void multiply(const T alpha, const T *x, const T beta, T *y)const;
+    // Operator * for the matrix-vector product
+    std::vector<T> operator*(const std::vector<T> &x)const;
+    /* Method to check the whole structure (monotone row pointers, column indices < n_cols): it throws
+       std::runtime_error on the first inconsistency, and it touches all the pages of cols and rows_idx */
+    void validate()const;
+    // Method to copy the matrix in a (dynamically allocated) SparseMatrixCSR, e.g. to modify it
+    SparseMatrixCSR<T>* to_CSR()const;
+    // Method to print all information about the matrix
+    void get_info()const;
+
+private:
+    // Attributes of the class MappedMatrixCSR
+    unsigned int n_rows=0;
+    unsigned int n_cols=0;
+    void *mapping=nullptr;
+    std::size_t mapping_size=0;
+    ArrayView<T> values;
+    ArrayView<unsigned int> cols;
+    ArrayView<unsigned int> rows_idx;
+    // Number of threads used by the products (by default we keep the serial version)
+    unsigned int n_threads=1;
+};
+//---------------------------------------------------------------------------------------------------------------------
+//Link to the definition file
+#include "MatrixIO.tpl.hpp"
+#endif
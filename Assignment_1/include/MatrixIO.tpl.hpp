@@ -0,0 +1,430 @@
+//---------------------------------------------------------------------------------------------------------------------
+// Libraries needed only by the definitions (file access and memory mapping)
+#include<cstdio>
+#include<cstring>
+#include<cstddef>
+#include<cctype>
+#include<charconv>
+#include<memory>
+#include<type_traits>
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+
+//---------------------------------------------------------------------------------------------------------------------
+// Helper function to compute the 64-bit FNV-1a hash of n bytes
+inline std::uint64_t fnv1a_hash(const void *data, const std::size_t n){
+    const unsigned char *bytes = static_cast<const unsigned char*>(data);
+    std::uint64_t hash = 14695981039346656037ull;
+    for(std::size_t k=0; k<n; k++){
+        hash ^= bytes[k];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Helper function to compute the checksum of a binary CSR header (the hash of all its bytes before the checksum)
+inline std::uint64_t header_checksum(const BinaryHeader &header){
+    return fnv1a_hash(&header, offsetof(BinaryHeader, checksum));
+}
+
+// Helper function to round an offset up to a multiple of 64 bytes
+inline std::uint64_t align_offset(const std::uint64_t offset){
+    return (offset+63)/64*64;
+}
+
+// Helper function to read a whole line (without the '\n') of a text file, it returns false at the end of the file
+inline bool read_text_line(std::FILE *file, std::string &line){
+    char piece[4096];
+    line.clear();
+    while(std::fgets(piece, sizeof(piece), file)){
+        line += piece;
+        if(!line.empty() && line.back()=='\n'){
+            line.pop_back();
+            return true;
+        }
+    }
+    return !line.empty();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// (1) Function to read a Matrix Market file
+template <typename T>
+SparseMatrixCSR<T>* read_matrix_market(const std::string &path, const unsigned int &n_threads,
+                                       const unsigned int &chunk_size){
+    /* We proceed in three steps:
+        1) the banner ("%%MatrixMarket matrix coordinate <field> <symmetry>") and the size line are read line by line;
+        2) the entries are read in chunks: only the complete lines of a chunk are parsed (the last, incomplete one is
+           moved at the beginning of the buffer for the next read), split among the threads at line boundaries.
+           Numbers are parsed with std::from_chars (no locale, no streams) and added to the buffer of the thread;
+        3) the assembler builds the CSR matrix (symmetric files are expanded, so the matrix is always general) */
+    assert(chunk_size>1);
+    std::unique_ptr<std::FILE, int(*)(std::FILE*)> file(std::fopen(path.c_str(), "rb"), &std::fclose);
+    if(!file){
+        throw std::runtime_error("read_matrix_market: cannot open "+path);
+    }
+    // (1) Banner and size line
+    std::string line;
+    if(!read_text_line(file.get(), line)){
+        throw std::runtime_error("read_matrix_market: empty file "+path);
+    }
+    for(char &c : line){
+        c = std::tolower(static_cast<unsigned char>(c));
+    }
+    char object[64]="", format[64]="", field[64]="", symmetry[64]="";
+    if(std::sscanf(line.c_str(), "%%%%matrixmarket %63s %63s %63s %63s", object, format, field, symmetry)!=4 ||
+       std::strcmp(object, "matrix")!=0){
+        throw std::runtime_error("read_matrix_market: missing Matrix Market banner in "+path);
+    }
+    if(std::strcmp(format, "coordinate")!=0){
+        throw std::runtime_error("read_matrix_market: only coordinate files are supported ("+path+" is "+format+")");
+    }
+    const bool pattern = std::strcmp(field, "pattern")==0;
+    if(!pattern && std::strcmp(field, "real")!=0 && std::strcmp(field, "double")!=0 && std::strcmp(field, "integer")!=0){
+        throw std::runtime_error("read_matrix_market: unsupported field "+std::string(field)+" in "+path);
+    }
+    const bool skew = std::strcmp(symmetry, "skew-symmetric")==0;
+    const bool symmetric = skew || std::strcmp(symmetry, "symmetric")==0;
+    if(!symmetric && std::strcmp(symmetry, "general")!=0){
+        throw std::runtime_error("read_matrix_market: unsupported symmetry "+std::string(symmetry)+" in "+path);
+    }
+    unsigned int n_rows=0, n_cols=0;
+    unsigned long long nnz=0;
+    do{
+        if(!read_text_line(file.get(), line)){
+            throw std::runtime_error("read_matrix_market: missing size line in "+path);
+        }
+    } while(line.find_first_not_of(" \t\r")==std::string::npos || line[line.find_first_not_of(" \t\r")]=='%');
+    if(std::sscanf(line.c_str(), "%u %u %llu", &n_rows, &n_cols, &nnz)!=3){
+        throw std::runtime_error("read_matrix_market: invalid size line in "+path);
+    }
+    // (2) Entries, chunk by chunk
+    const unsigned int n_buffers = std::max(1u, n_threads);
+    SparseAssembler<T> assembler(n_rows, n_cols, n_buffers);
+    assembler.set_threads(n_buffers);
+    const unsigned long long expected = (symmetric ? 2 : 1)*nnz/n_buffers+1;
+    for(unsigned int t=0; t<n_buffers; t++){
+        assembler.reserve(std::min<unsigned long long>(expected, UINT_MAX), t);
+    }
+    std::vector<unsigned long long> counts(n_buffers, 0);
+    std::vector<std::string> errors(n_buffers);
+    // Parser of the complete lines in [first, last) of the buffer, run by the thread (and so on the buffer) t
+    auto parse_lines = [&](const char *first, const char *last, const unsigned int t){
+        auto skip_blanks = [&](const char *p){
+            while(p<last && (*p==' ' || *p=='\t' || *p=='\r')) p++;
+            return p;
+        };
+        const char *p = first;
+        while(p<last){
+            const char *eol = static_cast<const char*>(std::memchr(p, '\n', last-p));
+            p = skip_blanks(p);
+            if(p==eol || *p=='%'){
+                p = eol+1;
+                continue;
+            }
+            unsigned long long i=0, j=0;
+            double v=1.;
+            std::from_chars_result res = std::from_chars(p, eol, i);
+            if(res.ec==std::errc()) res = std::from_chars(skip_blanks(res.ptr), eol, j);
+            if(res.ec==std::errc() && !pattern){
+                const char *q = skip_blanks(res.ptr);
+                res = std::from_chars(q<eol && *q=='+' ? q+1 : q, eol, v);
+            }
+            if(res.ec!=std::errc() || skip_blanks(res.ptr)!=eol){
+                errors[t] = "malformed entry \""+std::string(p, eol)+"\"";
+                return;
+            }
+            if(i<1 || i>n_rows || j<1 || j>n_cols){
+                errors[t] = "entry ("+std::to_string(i)+","+std::to_string(j)+") out of range";
+                return;
+            }
+            assembler.add(i-1, j-1, T(v), t);
+            if(symmetric && i!=j){
+                assembler.add(j-1, i-1, skew ? T(-v) : T(v), t);
+            }
+            counts[t]++;
+            p = eol+1;
+        }
+    };
+    std::vector<char> buffer(std::size_t(chunk_size)+1);
+    std::size_t filled = 0;
+    while(true){
+        const std::size_t got = std::fread(buffer.data()+filled, 1, chunk_size-filled, file.get());
+        if(std::ferror(file.get())){
+            throw std::runtime_error("read_matrix_market: error while reading "+path);
+        }
+        filled += got;
+        const bool end_of_file = filled<chunk_size;
+        // The last line of the file may have no '\n' (there is always room for one more character)
+        if(end_of_file && filled>0 && buffer[filled-1]!='\n'){
+            buffer[filled++] = '\n';
+        }
+        std::size_t complete = filled;
+        while(complete>0 && buffer[complete-1]!='\n'){
+            complete--;
+        }
+        if(complete==0 && !end_of_file){
+            throw std::runtime_error("read_matrix_market: a line of "+path+" is longer than the chunk size");
+        }
+        // Boundaries of the pieces of the threads: the first '\n' after t*complete/n_buffers (the line is included)
+        std::vector<unsigned int> bounds(n_buffers+1, complete);
+        bounds[0] = 0;
+        for(unsigned int t=1; t<n_buffers; t++){
+            std::size_t k = std::max<std::size_t>(complete*t/n_buffers, bounds[t-1]);
+            while(k<complete && (k==0 || buffer[k-1]!='\n')){
+                k++;
+            }
+            bounds[t] = k;
+        }
+        run_blocks(bounds, [&](const unsigned int first, const unsigned int last){
+            const unsigned int t = std::upper_bound(bounds.begin(), bounds.end(), first)-bounds.begin()-1;
+            parse_lines(buffer.data()+first, buffer.data()+last, t);
+        });
+        for(const std::string &error : errors){
+            if(!error.empty()){
+                throw std::runtime_error("read_matrix_market: "+error+" in "+path);
+            }
+        }
+        std::memmove(buffer.data(), buffer.data()+complete, filled-complete);
+        filled -= complete;
+        if(end_of_file){
+            break;
+        }
+    }
+    unsigned long long n_entries = 0;
+    for(const unsigned long long count : counts){
+        n_entries += count;
+    }
+    if(n_entries!=nnz){
+        throw std::runtime_error("read_matrix_market: "+path+" has "+std::to_string(n_entries)+" entries instead of "
+                                 +std::to_string(nnz));
+    }
+    // (3) CSR matrix
+    SparseMatrixCSR<T>* matrix = assembler.finalize();
+    matrix->set_threads(n_threads);
+    return matrix;
+}
+
+// Function to write a Matrix Market file
+template <typename T>
+void write_matrix_market(const SparseMatrixCSR<T> &matrix, const std::string &path){
+    /*Numbers are written with std::to_chars, which gives the shortest text that is read back as the same value,
+      in a buffer that is flushed to the file once it is (almost) full*/
+    std::unique_ptr<std::FILE, int(*)(std::FILE*)> file(std::fopen(path.c_str(), "wb"), &std::fclose);
+    if(!file){
+        throw std::runtime_error("write_matrix_market: cannot open "+path);
+    }
+    const std::vector<T> &values = matrix.get_values();
+    const std::vector<unsigned int> &cols = matrix.get_cols();
+    const std::vector<unsigned int> &rows_idx = matrix.get_rows_idx();
+    std::fprintf(file.get(), "%%%%MatrixMarket matrix coordinate %s general\n",
+                 std::is_floating_point<T>::value ? "real" : "integer");
+    std::fprintf(file.get(), "%u %u %llu\n", matrix.get_nrows(), matrix.get_ncols(), (unsigned long long)values.size());
+    std::vector<char> buffer(1u<<20);
+    std::size_t filled = 0;
+    for(unsigned int i=0; i<matrix.get_nrows(); i++){
+        for(unsigned int k=rows_idx[i]; k<rows_idx[i+1]; k++){
+            // A line takes at most 2*10 digits for the indices, about 30 characters for the value and 3 separators
+            if(buffer.size()-filled<64){
+                std::fwrite(buffer.data(), 1, filled, file.get());
+                filled = 0;
+            }
+            char *p = buffer.data()+filled, *end = buffer.data()+buffer.size();
+            p = std::to_chars(p, end, i+1).ptr;
+            *p++ = ' ';
+            p = std::to_chars(p, end, cols[k]+1).ptr;
+            *p++ = ' ';
+            p = std::to_chars(p, end, values[k]).ptr;
+            *p++ = '\n';
+            filled = p-buffer.data();
+        }
+    }
+    std::fwrite(buffer.data(), 1, filled, file.get());
+    if(std::ferror(file.get())){
+        throw std::runtime_error("write_matrix_market: error while writing "+path);
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// (2) Function to write a binary CSR file
+template <typename T>
+void write_binary(const SparseMatrixCSR<T> &matrix, const std::string &path){
+    std::unique_ptr<std::FILE, int(*)(std::FILE*)> file(std::fopen(path.c_str(), "wb"), &std::fclose);
+    if(!file){
+        throw std::runtime_error("write_binary: cannot open "+path);
+    }
+    const std::vector<T> &values = matrix.get_values();
+    const std::vector<unsigned int> &cols = matrix.get_cols();
+    const std::vector<unsigned int> &rows_idx = matrix.get_rows_idx();
+    BinaryHeader header{};
+    std::memcpy(header.magic, "SPARSCSR", 8);
+    header.version = 1;
+    header.value_size = sizeof(T);
+    header.value_float = std::is_floating_point<T>::value ? 1 : 0;
+    header.index_size = sizeof(unsigned int);
+    header.offset_size = sizeof(unsigned int);
+    header.n_rows = matrix.get_nrows();
+    header.n_cols = matrix.get_ncols();
+    header.nnz = values.size();
+    header.values_offset = align_offset(sizeof(BinaryHeader));
+    header.cols_offset = align_offset(header.values_offset+header.nnz*sizeof(T));
+    header.rows_idx_offset = align_offset(header.cols_offset+header.nnz*sizeof(unsigned int));
+    header.checksum = header_checksum(header);
+    // Each vector is written at its offset (the gaps are filled with zeros)
+    std::uint64_t position = 0;
+    auto write_at = [&](const std::uint64_t offset, const void *data, const std::size_t n){
+        static const char zeros[64] = {};
+        std::fwrite(zeros, 1, offset-position, file.get());
+        std::fwrite(data, 1, n, file.get());
+        position = offset+n;
+    };
+    write_at(0, &header, sizeof(BinaryHeader));
+    write_at(header.values_offset, values.data(), values.size()*sizeof(T));
+    write_at(header.cols_offset, cols.data(), cols.size()*sizeof(unsigned int));
+    write_at(header.rows_idx_offset, rows_idx.data(), rows_idx.size()*sizeof(unsigned int));
+    if(std::ferror(file.get())){
+        throw std::runtime_error("write_binary: error while writing "+path);
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// MappedMatrixCSR definitions
+// MappedMatrixCSR constructor
+template <typename T>
+MappedMatrixCSR<T>::MappedMatrixCSR(const std::string &path){
+    /*The file is mapped read-only and private: nothing is read here but the header (and the first and last
+      row pointers), so the cost does not depend on the size of the matrix*/
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd<0){
+        throw std::runtime_error("MappedMatrixCSR: cannot open "+path);
+    }
+    struct stat info;
+    if(::fstat(fd, &info)!=0 || (std::size_t)info.st_size<sizeof(BinaryHeader)){
+        ::close(fd);
+        throw std::runtime_error("MappedMatrixCSR: "+path+" is too small to be a binary CSR file");
+    }
+    mapping_size = info.st_size;
+    mapping = ::mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping stays valid after the file descriptor is closed
+    ::close(fd);
+    if(mapping==MAP_FAILED){
+        throw std::runtime_error("MappedMatrixCSR: cannot map "+path);
+    }
+    // The destructor is not called if the constructor throws, so the file is unmapped here
+    auto fail = [&](const std::string &reason){
+        ::munmap(mapping, mapping_size);
+        throw std::runtime_error("MappedMatrixCSR: "+path+" "+reason);
+    };
+    BinaryHeader header;
+    std::memcpy(&header, mapping, sizeof(BinaryHeader));
+    if(std::memcmp(header.magic, "SPARSCSR", 8)!=0){
+        fail("is not a binary CSR file");
+    }
+    if(header.checksum!=header_checksum(header)){
+        fail("has a corrupted header (wrong checksum)");
+    }
+    if(header.version!=1){
+        fail("has an unsupported version");
+    }
+    if(header.value_size!=sizeof(T) || header.value_float!=(std::is_floating_point<T>::value ? 1u : 0u) ||
+       header.index_size!=sizeof(unsigned int) || header.offset_size!=sizeof(unsigned int)){
+        fail("was written with other value or index types");
+    }
+    /* Each vector must lie inside the mapping: offset + count*size could wrap around with a crafted header (the
+       checksum only detects accidental damage), so the count is compared with the space left after the offset */
+    auto fits = [&](const std::uint64_t offset, const std::uint64_t count, const std::size_t size){
+        return offset%size==0 && offset<=mapping_size && count<=(mapping_size-offset)/size;
+    };
+    if(header.nnz>std::numeric_limits<unsigned int>::max()){
+        fail("has more nonzeros than the row pointers can index");
+    }
+    if(!fits(header.values_offset, header.nnz, sizeof(T)) ||
+       !fits(header.cols_offset, header.nnz, sizeof(unsigned int)) ||
+       !fits(header.rows_idx_offset, header.n_rows+1ull, sizeof(unsigned int))){
+        fail("is truncated");
+    }
+    // The first and the last row pointers must delimit the nonzeros before any view is built on them
+    const char *base = static_cast<const char*>(mapping);
+    const unsigned int *row_pointers = reinterpret_cast<const unsigned int*>(base+header.rows_idx_offset);
+    if(row_pointers[0]!=0 || row_pointers[header.n_rows]!=header.nnz){
+        fail("has inconsistent row pointers");
+    }
+    n_rows = header.n_rows;
+    n_cols = header.n_cols;
+    values = ArrayView<T>(reinterpret_cast<const T*>(base+header.values_offset), header.nnz);
+    cols = ArrayView<unsigned int>(reinterpret_cast<const unsigned int*>(base+header.cols_offset), header.nnz);
+    rows_idx = ArrayView<unsigned int>(row_pointers, n_rows+1);
+}
+
+// MappedMatrixCSR destructor
+template <typename T>
+MappedMatrixCSR<T>::~MappedMatrixCSR(){
+    ::munmap(mapping, mapping_size);
+    std::cout<<"Destructed MappedMatrixCSR"<<std::endl;
+}
+
+// Method for the in-place matrix-vector product
+template <typename T>
+void MappedMatrixCSR<T>::multiply(const T alpha, const std::vector<T> &x, const T beta, std::vector<T> &y)const{
+    assert(x.size()==n_cols && y.size()==n_rows);
+    multiply(alpha, x.data(), beta, y.data());
+}
+
+// Method for the in-place matrix-vector product (on raw pointers)
+template <typename T>
+void MappedMatrixCSR<T>::multiply(const T alpha, const T *x, const T beta, T *y)const{
+    // Same kernels (and same row blocks in parallel) of SparseMatrixCSR
+    auto multiply_rows = [&](const unsigned int first, const unsigned int last){
+        csr_multiply_rows(values.data(), cols.data(), rows_idx.data(), first, last, n_cols, alpha, x, beta, y);
+    };
+    if(n_threads<=1 || n_rows<=1){
+        multiply_rows(0, n_rows);
+        return;
+    }
+    run_blocks(nnz_partition(rows_idx, n_threads), multiply_rows);
+}
+
+// Operator * for the matrix-vector product
+template <typename T>
+std::vector<T> MappedMatrixCSR<T>::operator*(const std::vector<T> &x)const{
+    assert(x.size()==n_cols);
+    std::vector<T> result(n_rows);
+    multiply(T(1), x.data(), T(0), result.data());
+    return result;
+}
+
+// Method to check the structure of the mapped matrix
+template <typename T>
+void MappedMatrixCSR<T>::validate()const{
+    // (the constructor already checked rows_idx[0]==0 and rows_idx[n_rows]==nnz)
+    for(unsigned int i=0; i<n_rows; i++){
+        if(rows_idx[i]>rows_idx[i+1]){
+            throw std::runtime_error("MappedMatrixCSR: the row pointers decrease at row "+std::to_string(i));
+        }
+        for(unsigned int k=rows_idx[i]; k<rows_idx[i+1]; k++){
+            if(cols[k]>=n_cols){
+                throw std::runtime_error("MappedMatrixCSR: the column index of nonzero "+std::to_string(k)+
+                                         " (row "+std::to_string(i)+") is out of range");
+            }
+        }
+    }
+}
+
+// Method to copy the matrix in a SparseMatrixCSR
+template <typename T>
+SparseMatrixCSR<T>* MappedMatrixCSR<T>::to_CSR()const{
+    SparseMatrixCSR<T>* matrix = new SparseMatrixCSR<T>{n_rows, n_cols, values.to_vector(), cols.to_vector(),
+                                                        rows_idx.to_vector()};
+    matrix->set_threads(n_threads);
+    return matrix;
+}
+
+// Method to print all information about the matrix
+template <typename T>
+void MappedMatrixCSR<T>::get_info()const{
+    std::cout<<std::endl;
+    std::cout<<"Number of rows: "<<n_rows<<", number of columns: "<<n_cols<<std::endl;
+    std::cout<<"Number of nonzero elements: "<<get_nzeros()<<std::endl;
+    std::cout<<"Mapped bytes: "<<mapping_size<<std::endl;
+}
@@ -0,0 +1,93 @@
+// Header guards
+#ifndef REORDERING_HPP_
+#define REORDERING_HPP_
+//---------------------------------------------------------------------------------------------------------------------
+// Libraries
+#include<vector>
+#include "SparseMatrix.hpp"
+//---------------------------------------------------------------------------------------------------------------------
+// Available reorderings
+/* RCM: Reverse Cuthill-McKee, a breadth-first numbering that keeps the nonzeros close to the diagonal (small bandwidth);
+   NestedDissection: recursive bisection of the graph by small separators (numbered last), whose leaves are numbered
+   with RCM, so each block of rows only touches a small (and contiguous) part of the input vector */
+enum class ReorderingMethod {RCM, NestedDissection};
+
+//---------------------------------------------------------------------------------------------------------------------
+// Reordering class declaration
+/* Symmetric permutation P of a square CSR matrix, computed from its structure (the graph of A+A^T, so that non-symmetric
+   matrices are reordered too): the reordered matrix is P*A*P^T, vectors are permuted with P and restored with P^T.
+   The constructor also measures bandwidth and profile before and after the reordering */
+template <typename T>
+class Reordering{
+public:
+    // Constructor (min_size is the size under which nested dissection stops bisecting)
+    Reordering(const SparseMatrixCSR<T> &matrix,
+               const ReorderingMethod &method=ReorderingMethod::RCM,
+               const unsigned int &min_size=64);
+    // Destructor
+    ~Reordering() {std::cout<<"Destructed Reordering"<<std::endl;}
+
+    // Method to get the permutation (original index of the k-th new row)
+    const std::vector<unsigned int> &get_perm()const{return perm;}
+    // Method to get the inverse permutation (new index of the i-th original row)
+    const std::vector<unsigned int> &get_inverse()const{return inv_perm;}
+    // Methods to get bandwidth and profile of the matrix before and after the reordering
+    unsigned int get_bandwidth_before()const{return bandwidth_before;}
+    unsigned int get_bandwidth_after()const{return bandwidth_after;}
+    unsigned long long get_profile_before()const{return profile_before;}
+    unsigned long long get_profile_after()const{return profile_after;}
+    // Method to print the report of the reordering (bandwidth and profile before and after)
+    void get_info() const;
+    // Method to build the reordered matrix P*A*P^T (the input matrix is left unchanged)
+    SparseMatrixCSR<T>* permute(const SparseMatrixCSR<T> &matrix) const;
+    // Method to permute a vector (P*v: the k-th entry is v[perm[k]])
+    std::vector<T> permute(const std::vector<T> &v) const;
+    // Method to restore the original order of a vector (P^T*v)
+    std::vector<T> restore(const std::vector<T> &v) const;
+
+private:
+    /* Some helper functions to make the constructor easier both to implement and understand.
+       The graph is visited only inside a part: the nodes v with part[v]==label */
+    // (I) Helper function to build the (symmetric, diagonal excluded) graph of the matrix
+    void buildGraph(const SparseMatrixCSR<T> &matrix);
+    // (II) Helper function to visit a part breadth-first from root (it returns the nodes, and the level of each one)
+    void levelStructure(const unsigned int root, const unsigned int label,
+                        std::vector<unsigned int> &order, std::vector<unsigned int> &level_start);
+    // (III) Helper function to find a pseudo-peripheral node (a node far from all the others) of a part
+    unsigned int peripheralNode(const unsigned int start, const unsigned int label);
+    // (IV) Helper function to append the Reverse Cuthill-McKee numbering of the nodes of a part to perm
+    void cuthillMcKee(const std::vector<unsigned int> &nodes, const unsigned int label);
+    // (V) Helper function to append the nested dissection numbering of the nodes of a part to perm
+    void dissect(const std::vector<unsigned int> &nodes, const unsigned int label, const unsigned int min_size);
+    // (VI) Helper function to measure bandwidth and profile of the matrix renumbered with new_index
+    void measure(const SparseMatrixCSR<T> &matrix, const std::vector<unsigned int> &new_index,
+                 unsigned int &bandwidth, unsigned long long &profile) const;
+
+    // Attributes of the class Reordering
+    unsigned int n;
+    std::vector<unsigned int> perm;          // original index of the k-th new row
+    std::vector<unsigned int> inv_perm;      // new index of the i-th original row
+    unsigned int bandwidth_before=0, bandwidth_after=0;
+    unsigned long long profile_before=0, profile_after=0;
+    // Graph of the matrix (CSR-like: neighbours of v are adj[adj_idx[v]:adj_idx[v+1]]) and visit bookkeeping
+    std::vector<unsigned int> adj_idx;
+    std::vector<unsigned int> adj;
+    std::vector<unsigned int> part;          // label of the part of each node (PLACED once it is numbered)
+    std::vector<unsigned int> mark;          // last visit in which each node was reached
+    unsigned int n_labels=1;                 // number of labels used so far (the whole graph has label 0)
+    unsigned int visit=0;                    // number of visits done so far
+    static constexpr unsigned int PLACED = UINT_MAX;
+};
+
+// Function to compute the bandwidth of a CSR matrix (maximum |i-j| over the nonzeros)
+template <typename T>
+unsigned int bandwidth(const SparseMatrixCSR<T> &matrix);
+
+// Function to compute the profile of a CSR matrix (sum over the rows of the distance between the diagonal and the
+// first nonzero of the row, if it comes before the diagonal)
+template <typename T>
+unsigned long long profile(const SparseMatrixCSR<T> &matrix);
+//---------------------------------------------------------------------------------------------------------------------
+//Link to the definition file
+#include "Reordering.tpl.hpp"
+#endif
@@ -0,0 +1,323 @@
+//---------------------------------------------------------------------------------------------------------------------
+// Reordering definitions
+// Reordering constructor
+template <typename T>
+Reordering<T>::Reordering(const SparseMatrixCSR<T> &matrix,
+                          const ReorderingMethod &method,
+                          const unsigned int &min_size) : n(matrix.get_nrows()) {
+    // A symmetric permutation needs a square matrix
+    assert(matrix.get_nrows()==matrix.get_ncols());
+    buildGraph(matrix);
+    part.assign(n, 0);
+    mark.assign(n, 0);
+    perm.reserve(n);
+    std::vector<unsigned int> nodes(n);
+    for(unsigned int v=0; v<n; v++){
+        nodes[v] = v;
+    }
+    if(method==ReorderingMethod::RCM){
+        cuthillMcKee(nodes, 0);
+    }
+    else{
+        dissect(nodes, 0, std::max(1u, min_size));
+    }
+    assert(perm.size()==n);
+    inv_perm.resize(n);
+    for(unsigned int k=0; k<n; k++){
+        inv_perm[perm[k]] = k;
+    }
+    // Report: bandwidth and profile with the original numbering and with the new one
+    bandwidth_before = bandwidth(matrix);
+    profile_before = profile(matrix);
+    measure(matrix, inv_perm, bandwidth_after, profile_after);
+    // The graph is not needed anymore
+    std::vector<unsigned int>().swap(adj_idx);
+    std::vector<unsigned int>().swap(adj);
+    std::vector<unsigned int>().swap(part);
+    std::vector<unsigned int>().swap(mark);
+}
+
+// Method to print the report of the reordering
+template <typename T>
+void Reordering<T>::get_info() const{
+    std::cout<<std::endl;
+    std::cout<<"Number of rows: "<<n<<std::endl;
+    std::cout<<"Bandwidth: "<<bandwidth_before<<" -> "<<bandwidth_after<<std::endl;
+    std::cout<<"Profile: "<<profile_before<<" -> "<<profile_after<<std::endl;
+}
+
+// Method to build the reordered matrix P*A*P^T
+template <typename T>
+SparseMatrixCSR<T>* Reordering<T>::permute(const SparseMatrixCSR<T> &matrix) const{
+    assert(matrix.get_nrows()==n && matrix.get_ncols()==n);
+    const std::vector<T> &values = matrix.get_values();
+    const std::vector<unsigned int> &cols = matrix.get_cols();
+    const std::vector<unsigned int> &rows_idx = matrix.get_rows_idx();
+    // The k-th new row is the row perm[k], with its columns renumbered (the CSR constructor sorts them again)
+    std::vector<T> new_values(values.size());
+    std::vector<unsigned int> new_cols(cols.size());
+    std::vector<unsigned int> new_rows_idx(n+1, 0);
+    for(unsigned int k=0; k<n; k++){
+        unsigned int position = new_rows_idx[k];
+        for(unsigned int l=rows_idx[perm[k]]; l<rows_idx[perm[k]+1]; l++, position++){
+            new_values[position] = values[l];
+            new_cols[position] = inv_perm[cols[l]];
+        }
+        new_rows_idx[k+1] = position;
+    }
+    SparseMatrixCSR<T>* reordered = new SparseMatrixCSR<T>{n, n, new_values, new_cols, new_rows_idx};
+    reordered->set_threads(matrix.get_threads());
+    return reordered;
+}
+
+// Method to permute a vector
+template <typename T>
+std::vector<T> Reordering<T>::permute(const std::vector<T> &v) const{
+    assert(v.size()==n);
+    std::vector<T> result(n);
+    for(unsigned int k=0; k<n; k++){
+        result[k] = v[perm[k]];
+    }
+    return result;
+}
+
+// Method to restore the original order of a vector
+template <typename T>
+std::vector<T> Reordering<T>::restore(const std::vector<T> &v) const{
+    assert(v.size()==n);
+    std::vector<T> result(n);
+    for(unsigned int k=0; k<n; k++){
+        result[perm[k]] = v[k];
+    }
+    return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// (I) Helper function to build the graph of the matrix
+    /*The neighbours of v are the columns of the row v of A and of A^T (both sorted, so they are merged in one pass
+      without duplicates), the diagonal excluded*/
+template <typename T>
+void Reordering<T>::buildGraph(const SparseMatrixCSR<T> &matrix){
+    const std::vector<unsigned int> &cols = matrix.get_cols();
+    const std::vector<unsigned int> &rows_idx = matrix.get_rows_idx();
+    std::vector<T> t_values;
+    std::vector<unsigned int> t_cols, t_rows_idx;
+    transpose_vectors(n, matrix.get_values(), cols, rows_idx, t_values, t_cols, t_rows_idx);
+    adj_idx.assign(n+1, 0);
+    adj.clear();
+    adj.reserve(2*cols.size());
+    for(unsigned int v=0; v<n; v++){
+        unsigned int a=rows_idx[v], b=t_rows_idx[v];
+        while(a<rows_idx[v+1] || b<t_rows_idx[v+1]){
+            unsigned int w;
+            if(b==t_rows_idx[v+1] || (a<rows_idx[v+1] && cols[a]<t_cols[b])){
+                w = cols[a++];
+            }
+            else if(a==rows_idx[v+1] || t_cols[b]<cols[a]){
+                w = t_cols[b++];
+            }
+            else{
+                w = cols[a++];
+                b++;
+            }
+            if(w!=v && (adj.size()==adj_idx[v] || adj.back()!=w)){
+                adj.push_back(w);
+            }
+        }
+        adj_idx[v+1] = adj.size();
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// (II) Helper function to visit a part breadth-first from root
+    /*order contains the reached nodes level by level: the level l is order[level_start[l]:level_start[l+1]]*/
+template <typename T>
+void Reordering<T>::levelStructure(const unsigned int root, const unsigned int label,
+                                   std::vector<unsigned int> &order, std::vector<unsigned int> &level_start){
+    visit++;
+    order.clear();
+    level_start.assign(1, 0);
+    order.push_back(root);
+    mark[root] = visit;
+    unsigned int head = 0;
+    while(head<order.size()){
+        const unsigned int level_end = order.size();
+        for(; head<level_end; head++){
+            const unsigned int u = order[head];
+            for(unsigned int k=adj_idx[u]; k<adj_idx[u+1]; k++){
+                const unsigned int w = adj[k];
+                if(part[w]==label && mark[w]!=visit){
+                    mark[w] = visit;
+                    order.push_back(w);
+                }
+            }
+        }
+        level_start.push_back(level_end);
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// (III) Helper function to find a pseudo-peripheral node of a part
+    /*George-Liu algorithm: from the current root we move to the node of minimum degree of the last level,
+      as long as the number of levels (i.e. the eccentricity of the root) grows*/
+template <typename T>
+unsigned int Reordering<T>::peripheralNode(const unsigned int start, const unsigned int label){
+    std::vector<unsigned int> order, level_start;
+    unsigned int root = start;
+    levelStructure(root, label, order, level_start);
+    unsigned int depth = level_start.size();
+    while(true){
+        const unsigned int last_level = level_start[level_start.size()-2];
+        unsigned int candidate = order[last_level];
+        for(unsigned int k=last_level; k<order.size(); k++){
+            if(adj_idx[order[k]+1]-adj_idx[order[k]] < adj_idx[candidate+1]-adj_idx[candidate]){
+                candidate = order[k];
+            }
+        }
+        levelStructure(candidate, label, order, level_start);
+        if(level_start.size()<=depth){
+            return root;
+        }
+        root = candidate;
+        depth = level_start.size();
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// (IV) Helper function to append the Reverse Cuthill-McKee numbering of the nodes of a part to perm
+    /*Each connected component is visited breadth-first from a pseudo-peripheral node, adding the neighbours of
+      each node by increasing degree; the numbering of the whole part is then reversed (which reduces the profile)*/
+template <typename T>
+void Reordering<T>::cuthillMcKee(const std::vector<unsigned int> &nodes, const unsigned int label){
+    const unsigned int first = perm.size();
+    std::vector<unsigned int> neighbours;
+    auto degree = [&](const unsigned int v){return adj_idx[v+1]-adj_idx[v];};
+    for(const unsigned int v : nodes){
+        // Nodes of the components already numbered are PLACED
+        if(part[v]!=label){
+            continue;
+        }
+        const unsigned int root = peripheralNode(v, label);
+        part[root] = PLACED;
+        perm.push_back(root);
+        for(unsigned int head=perm.size()-1; head<perm.size(); head++){
+            const unsigned int u = perm[head];
+            neighbours.clear();
+            for(unsigned int k=adj_idx[u]; k<adj_idx[u+1]; k++){
+                if(part[adj[k]]==label){
+                    part[adj[k]] = PLACED;
+                    neighbours.push_back(adj[k]);
+                }
+            }
+            std::stable_sort(neighbours.begin(), neighbours.end(), [&](const unsigned int a, const unsigned int b){
+                return degree(a) < degree(b);
+            });
+            perm.insert(perm.end(), neighbours.begin(), neighbours.end());
+        }
+    }
+    std::reverse(perm.begin()+first, perm.end());
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// (V) Helper function to append the nested dissection numbering of the nodes of a part to perm
+    /*The level structure from a pseudo-peripheral node is cut at the level that splits the nodes in two halves:
+      that level is a separator (no edge joins the levels before it with the ones after it), so the two halves are
+      numbered first (recursively) and the separator last. Small parts (or parts with less than 3 levels, which
+      have no separator) are numbered with RCM*/
+template <typename T>
+void Reordering<T>::dissect(const std::vector<unsigned int> &nodes, const unsigned int label,
+                            const unsigned int min_size){
+    if(nodes.size()<=min_size){
+        cuthillMcKee(nodes, label);
+        return;
+    }
+    std::vector<unsigned int> order, level_start;
+    levelStructure(peripheralNode(nodes[0], label), label, order, level_start);
+    const unsigned int n_levels = level_start.size()-1;
+    if(n_levels<3){
+        cuthillMcKee(nodes, label);
+        return;
+    }
+    // Separator level: the first level that reaches half of the nodes (but neither the first nor the last one)
+    unsigned int sep_level = 1;
+    while(sep_level<n_levels-2 && level_start[sep_level+1]<nodes.size()/2){
+        sep_level++;
+    }
+    const unsigned int label_a = n_labels++, label_b = n_labels++, label_sep = n_labels++;
+    std::vector<unsigned int> nodes_a(order.begin(), order.begin()+level_start[sep_level]);
+    std::vector<unsigned int> separator(order.begin()+level_start[sep_level], order.begin()+level_start[sep_level+1]);
+    for(const unsigned int v : nodes_a){
+        part[v] = label_a;
+    }
+    for(const unsigned int v : separator){
+        part[v] = label_sep;
+    }
+    // The second half is everything else: the levels after the separator and the other connected components
+    std::vector<unsigned int> nodes_b;
+    for(const unsigned int v : nodes){
+        if(part[v]==label){
+            part[v] = label_b;
+            nodes_b.push_back(v);
+        }
+    }
+    dissect(nodes_a, label_a, min_size);
+    dissect(nodes_b, label_b, min_size);
+    cuthillMcKee(separator, label_sep);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// (VI) Helper function to measure bandwidth and profile of the matrix renumbered with new_index
+template <typename T>
+void Reordering<T>::measure(const SparseMatrixCSR<T> &matrix, const std::vector<unsigned int> &new_index,
+                            unsigned int &bandwidth, unsigned long long &profile) const{
+    const std::vector<unsigned int> &cols = matrix.get_cols();
+    const std::vector<unsigned int> &rows_idx = matrix.get_rows_idx();
+    // first_col[r] is the first column of the new row r (if it comes before the diagonal)
+    std::vector<unsigned int> first_col(n);
+    for(unsigned int r=0; r<n; r++){
+        first_col[r] = r;
+    }
+    bandwidth = 0;
+    for(unsigned int i=0; i<n; i++){
+        const unsigned int r = new_index[i];
+        for(unsigned int k=rows_idx[i]; k<rows_idx[i+1]; k++){
+            const unsigned int c = new_index[cols[k]];
+            bandwidth = std::max(bandwidth, r>c ? r-c : c-r);
+            first_col[r] = std::min(first_col[r], c);
+        }
+    }
+    profile = 0;
+    for(unsigned int r=0; r<n; r++){
+        profile += r-first_col[r];
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Function to compute the bandwidth of a CSR matrix
+template <typename T>
+unsigned int bandwidth(const SparseMatrixCSR<T> &matrix){
+    const std::vector<unsigned int> &cols = matrix.get_cols();
+    const std::vector<unsigned int> &rows_idx = matrix.get_rows_idx();
+    unsigned int result = 0;
+    for(unsigned int i=0; i<matrix.get_nrows(); i++){
+        for(unsigned int k=rows_idx[i]; k<rows_idx[i+1]; k++){
+            result = std::max(result, i>cols[k] ? i-cols[k] : cols[k]-i);
+        }
+    }
+    return result;
+}
+
+// Function to compute the profile of a CSR matrix
+template <typename T>
+unsigned long long profile(const SparseMatrixCSR<T> &matrix){
+    const std::vector<unsigned int> &cols = matrix.get_cols();
+    const std::vector<unsigned int> &rows_idx = matrix.get_rows_idx();
+    unsigned long long result = 0;
+    for(unsigned int i=0; i<matrix.get_nrows(); i++){
+        // Columns are sorted, so the first nonzero of the row is the first one stored
+        if(rows_idx[i]<rows_idx[i+1] && cols[rows_idx[i]]<i){
+            result += i-cols[rows_idx[i]];
+        }
+    }
+    return result;
+}
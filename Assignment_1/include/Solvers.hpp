@@ -0,0 +1,190 @@
+// Header guards
+#ifndef SOLVERS_HPP_
+#define SOLVERS_HPP_
+//---------------------------------------------------------------------------------------------------------------------
+// Libraries
+#include<vector>
+#include<cmath>
+#include<string>
+#include<stdexcept>
+#include "SparseMatrix.hpp"
+#include "TriangularSolve.hpp"
+//---------------------------------------------------------------------------------------------------------------------
+// (1) Preconditioner class declaration (base class)
+/* A preconditioner M approximates the matrix A, so that M^-1*A is "closer" to the identity than A:
+   the solvers just need to apply z = M^-1*r at each iteration */
+template <typename T>
+class Preconditioner{
+public:
+    // Virtual destructor
+    virtual ~Preconditioner() {std::cout<<"Destructed Preconditioner"<<std::endl;}
+    // Virtual method to apply the preconditioner (z = M^-1*r, z and r must be different vectors)
+    virtual void apply(const std::vector<T> &r, std::vector<T> &z) const=0;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// (2) JacobiPreconditioner class declaration (derived class of Preconditioner)
+/* M is the diagonal of A: applying it is just a (point-wise) division by the diagonal */
+template <typename T>
+class JacobiPreconditioner: public Preconditioner<T>{
+public:
+    // Constructor (from the CSR vectors of the matrix, every diagonal element must be nonzero, otherwise it throws)
+    JacobiPreconditioner(const SparseMatrixCSR<T> &matrix);
+    // Destructor
+    ~JacobiPreconditioner() {std::cout<<"Destructed JacobiPreconditioner"<<std::endl;}
+    // Method to apply the preconditioner
+    void apply(const std::vector<T> &r, std::vector<T> &z) const override;
+
+private:
+    //Here the only private attribute of the class JacobiPreconditioner (inverse of the diagonal)
+    std::vector<T> inv_diag;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// (3) ILU0Preconditioner class declaration (derived class of Preconditioner)
+/* M = L*U is the incomplete LU factorization of A with zero fill-in: L and U have the same nonzero pattern as A
+   (L is unit lower triangular, so both factors fit in a single copy of the CSR values of A).
+   Applying it means two triangular solves, done by two SpTRSV (their level analysis is done once, here) */
+template <typename T>
+class ILU0Preconditioner: public Preconditioner<T>{
+public:
+    // Constructor (from the CSR vectors of the matrix, every diagonal element must be stored and nonzero)
+    ILU0Preconditioner(const SparseMatrixCSR<T> &matrix);
+    // Destructor
+    ~ILU0Preconditioner() {std::cout<<"Destructed ILU0Preconditioner"<<std::endl;}
+    // Method to apply the preconditioner (forward substitution with L, then backward substitution with U)
+    void apply(const std::vector<T> &r, std::vector<T> &z) const override;
+    // Method to set the number of threads used by the triangular solves (1 = serial, 0 = all available cores)
+    void set_threads(const unsigned int &nt){lower.set_threads(nt); upper.set_threads(nt);}
+    // Methods to get the triangular solves (e.g. to print their levels)
+    const SpTRSV<T> &get_lower()const{return lower;}
+    const SpTRSV<T> &get_upper()const{return upper;}
+
+private:
+    // Helper function to compute the incomplete factorization (the values of L and U in the pattern of A)
+    static std::vector<T> factorize(const SparseMatrixCSR<T> &matrix);
+
+    // Attributes of the class ILU0Preconditioner
+    std::vector<T> lu;                   // values of L (strictly lower part) and U (upper part, diagonal included)
+    SpTRSV<T> lower;                     // solve with L (unit diagonal)
+    SpTRSV<T> upper;                     // solve with U
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// Struct with the outcome of a solver
+struct SolverResult{
+    bool converged=false;           // true if the relative residual went below the tolerance
+    unsigned int iterations=0;      // number of iterations done
+    double residual=0.;             // final relative residual ||b-A*x||/||b||
+    std::vector<double> history;    // relative residual at each iteration (the first one is the initial residual)
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// (4) IterativeSolver class declaration (base class)
+/* The solvers work on any square SparseMatrix through its in-place product: all the vectors they need
+   are allocated once by the constructor (workspace), so the iterations do not allocate anything.
+   Matrix is the type the product is called on: with the default (SparseMatrix<T>) any format is accepted at run time,
+   with a format (e.g. SparseMatrixCSR<T>) the product is a direct call to its kernel (see SparseFormat) */
+template <typename T, typename Matrix=SparseMatrix<T>>
+class IterativeSolver{
+public:
+    // Constructor
+    IterativeSolver(const Matrix &matrix,
+                    const unsigned int &max_it=1000,
+                    const double &tol=1e-10);
+    // Virtual destructor
+    virtual ~IterativeSolver() {std::cout<<"Destructed IterativeSolver"<<std::endl;}
+
+    // Method to get the maximum number of iterations
+    unsigned int get_max_iterations()const{return max_iterations;}
+    // Method to set the maximum number of iterations
+    void set_max_iterations(const unsigned int &max_it){max_iterations=max_it;}
+    // Method to get the tolerance on the relative residual
+    double get_tolerance()const{return tolerance;}
+    // Method to set the tolerance on the relative residual
+    void set_tolerance(const double &tol){tolerance=tol;}
+    // Method to print the residual every "every" iterations while solving (0 = never)
+    void set_verbose(const unsigned int &every){verbose=every;}
+    // Virtual method to solve A*x = b (x is the initial guess and it is overwritten with the solution)
+    virtual SolverResult solve(const std::vector<T> &b, std::vector<T> &x,
+                               const Preconditioner<T> *precond=nullptr)=0;
+
+protected:
+    // Helper function to store (and maybe print) the relative residual of an iteration
+    void monitor(SolverResult &result, const double residual) const;
+
+    // Attributes of the class IterativeSolver
+    const Matrix &A;
+    unsigned int max_iterations;
+    double tolerance;
+    unsigned int verbose=0;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// (5) SolverCG class declaration (derived class of IterativeSolver)
+/* (Preconditioned) Conjugate Gradient: the matrix (and the preconditioner) must be symmetric positive definite */
+template <typename T, typename Matrix=SparseMatrix<T>>
+class SolverCG: public IterativeSolver<T, Matrix>{
+public:
+    // Constructor
+    SolverCG(const Matrix &matrix,
+             const unsigned int &max_it=1000,
+             const double &tol=1e-10);
+    // Destructor
+    ~SolverCG() {std::cout<<"Destructed SolverCG"<<std::endl;}
+    // Method to solve A*x = b
+    SolverResult solve(const std::vector<T> &b, std::vector<T> &x,
+                       const Preconditioner<T> *precond=nullptr) override;
+
+private:
+    // Workspace: residual, preconditioned residual, search direction and A times the search direction
+    std::vector<T> r, z, p, q;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// (6) SolverBiCGSTAB class declaration (derived class of IterativeSolver)
+/* (Right preconditioned) BiConjugate Gradient Stabilized: it works with non-symmetric matrices too */
+template <typename T, typename Matrix=SparseMatrix<T>>
+class SolverBiCGSTAB: public IterativeSolver<T, Matrix>{
+public:
+    // Constructor
+    SolverBiCGSTAB(const Matrix &matrix,
+                   const unsigned int &max_it=1000,
+                   const double &tol=1e-10);
+    // Destructor
+    ~SolverBiCGSTAB() {std::cout<<"Destructed SolverBiCGSTAB"<<std::endl;}
+    // Method to solve A*x = b
+    SolverResult solve(const std::vector<T> &b, std::vector<T> &x,
+                       const Preconditioner<T> *precond=nullptr) override;
+
+private:
+    // Workspace: residuals (r, r0 shadow one and s), directions (p, v, t) and their preconditioned versions
+    std::vector<T> r, r0, p, v, s, t, p_hat, s_hat;
+};
+
+// Function to compute the dot product of two vectors
+template <typename T>
+T dot(const std::vector<T> &a, const std::vector<T> &b);
+
+// Function to compute z = y + alpha*x and return z*z (fused: the vectors are read just once, z may be y itself)
+template <typename T>
+T axpy_dot(const T alpha, const std::vector<T> &x, const std::vector<T> &y, std::vector<T> &z);
+
+// Function to compute the dot products a*b and a*a in a single pass
+template <typename T>
+void dot_pair(const std::vector<T> &a, const std::vector<T> &b, T &ab, T &aa);
+
+// Function to compute the CG update x = x + alpha*p, r = r - alpha*q and return r*r (fused in a single pass)
+template <typename T>
+T cg_update(const T alpha, const std::vector<T> &p, const std::vector<T> &q, std::vector<T> &x, std::vector<T> &r);
+
+// Function to compute the BiCGSTAB update x = x + alpha*p_hat + omega*s_hat, r = s - omega*t
+/* (fused in a single pass, it returns r*r and writes r0*r in r0r) */
+template <typename T>
+T bicgstab_update(const T alpha, const std::vector<T> &p_hat, const T omega, const std::vector<T> &s_hat,
+                  const std::vector<T> &s, const std::vector<T> &t, const std::vector<T> &r0,
+                  std::vector<T> &x, std::vector<T> &r, T &r0r);
+//---------------------------------------------------------------------------------------------------------------------
+//Link to the definition file
+#include "Solvers.tpl.hpp"
+#endif
@@ -0,0 +1,354 @@
+//---------------------------------------------------------------------------------------------------------------------
+// (2) JacobiPreconditioner definitions
+// JacobiPreconditioner constructor
+template <typename T>
+JacobiPreconditioner<T>::JacobiPreconditioner(const SparseMatrixCSR<T> &matrix) : inv_diag(matrix.get_nrows(), 0) {
+    const std::vector<T> &values = matrix.get_values();
+    const std::vector<unsigned int> &cols = matrix.get_cols();
+    const std::vector<unsigned int> &rows_idx = matrix.get_rows_idx();
+    for(unsigned int i=0; i<matrix.get_nrows(); i++){
+        // A zero (or missing) diagonal element cannot be inverted
+        T diag = T(0);
+        for(unsigned int k=rows_idx[i]; k<rows_idx[i+1]; k++){
+            if(cols[k]==i){
+                diag = values[k];
+            }
+        }
+        if(diag==T(0)){
+            throw std::invalid_argument("JacobiPreconditioner: the diagonal element of row "+std::to_string(i)+
+                                        " is zero or not stored");
+        }
+        inv_diag[i] = T(1)/diag;
+    }
+}
+
+// Method to apply the Jacobi preconditioner
+template <typename T>
+void JacobiPreconditioner<T>::apply(const std::vector<T> &r, std::vector<T> &z) const{
+    for(unsigned int i=0; i<inv_diag.size(); i++){
+        z[i] = inv_diag[i]*r[i];
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// (3) ILU0Preconditioner definitions
+// ILU0Preconditioner constructor
+    /*The factors are computed once (lu), then each SpTRSV keeps its triangle in the order of its levels,
+      so lu is not needed anymore*/
+template <typename T>
+ILU0Preconditioner<T>::ILU0Preconditioner(const SparseMatrixCSR<T> &matrix) :
+    lu(factorize(matrix)),
+    lower(matrix.get_nrows(), lu, matrix.get_cols(), matrix.get_rows_idx(), Triangle::Lower, true),
+    upper(matrix.get_nrows(), lu, matrix.get_cols(), matrix.get_rows_idx(), Triangle::Upper, false) {
+    std::vector<T>().swap(lu);
+}
+
+// Helper function to compute the incomplete factorization
+    /*We copy the CSR vectors of A (whose columns are sorted inside each row) and we run the IKJ version of
+      Gaussian elimination, dropping every element outside the pattern of A: for each row i
+      and each k<i in the row, l_ik = a_ik/u_kk and then a_ij -= l_ik*u_kj for the j>k in both rows i and k.
+      A marker array (position of each column in the row i, -1 if missing) finds j in the row i in O(1)*/
+template <typename T>
+std::vector<T> ILU0Preconditioner<T>::factorize(const SparseMatrixCSR<T> &matrix){
+    const unsigned int n = matrix.get_nrows();
+    assert(n==matrix.get_ncols());
+    std::vector<T> lu = matrix.get_values();
+    const std::vector<unsigned int> &cols = matrix.get_cols();
+    const std::vector<unsigned int> &rows_idx = matrix.get_rows_idx();
+    // (1) Position of the diagonal element of each row
+    std::vector<unsigned int> diag(n);
+    for(unsigned int i=0; i<n; i++){
+        diag[i] = rows_idx[i] + sorted_lower_bound(cols.data()+rows_idx[i], rows_idx[i+1]-rows_idx[i], i);
+        // The diagonal element must be stored (the factorization divides by it, checked also without asserts)
+        if(diag[i]==rows_idx[i+1] || cols[diag[i]]!=i){
+            throw std::invalid_argument("ILU0Preconditioner: the diagonal element of row "+std::to_string(i)+" is not stored");
+        }
+    }
+    // (2) Incomplete factorization, row by row
+    std::vector<int> position(n, -1);
+    for(unsigned int i=0; i<n; i++){
+        for(unsigned int k=rows_idx[i]; k<rows_idx[i+1]; k++){
+            position[cols[k]] = k;
+        }
+        for(unsigned int k=rows_idx[i]; k<diag[i]; k++){
+            const unsigned int row = cols[k];
+            if(lu[diag[row]]==T(0)){
+                throw std::invalid_argument("ILU0Preconditioner: zero pivot in row "+std::to_string(row));
+            }
+            lu[k] /= lu[diag[row]];
+            for(unsigned int l=diag[row]+1; l<rows_idx[row+1]; l++){
+                if(position[cols[l]]!=-1){
+                    lu[position[cols[l]]] -= lu[k]*lu[l];
+                }
+            }
+        }
+        for(unsigned int k=rows_idx[i]; k<rows_idx[i+1]; k++){
+            position[cols[k]] = -1;
+        }
+    }
+    return lu;
+}
+
+// Method to apply the ILU(0) preconditioner
+template <typename T>
+void ILU0Preconditioner<T>::apply(const std::vector<T> &r, std::vector<T> &z) const{
+    // Forward substitution: L*w = r (w is stored in z), then backward substitution in place: U*z = w
+    lower.solve(r, z);
+    upper.solve(z, z);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// (4) IterativeSolver definitions
+// IterativeSolver constructor
+template <typename T, typename Matrix>
+IterativeSolver<T, Matrix>::IterativeSolver(const Matrix &matrix,
+                                            const unsigned int &max_it,
+                                            const double &tol) : A(matrix), max_iterations(max_it), tolerance(tol) {
+    // Krylov solvers need a square matrix
+    assert(matrix.get_nrows()==matrix.get_ncols());
+}
+
+// Helper function to store (and maybe print) the relative residual of an iteration
+template <typename T, typename Matrix>
+void IterativeSolver<T, Matrix>::monitor(SolverResult &result, const double residual) const{
+    result.residual = residual;
+    result.history.push_back(residual);
+    if(verbose>0 && result.iterations%verbose==0){
+        std::cout<<"Iteration "<<result.iterations<<": relative residual "<<std::scientific<<residual
+                 <<std::fixed<<std::endl;
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// (5) SolverCG definitions
+// SolverCG constructor (the workspace is allocated here, once for all the calls to solve)
+template <typename T, typename Matrix>
+SolverCG<T, Matrix>::SolverCG(const Matrix &matrix,
+                              const unsigned int &max_it,
+                              const double &tol) : IterativeSolver<T, Matrix>(matrix, max_it, tol),
+    r(matrix.get_nrows()), z(matrix.get_nrows()), p(matrix.get_nrows()), q(matrix.get_nrows()) {};
+
+// Method to solve A*x = b with the (preconditioned) Conjugate Gradient
+template <typename T, typename Matrix>
+SolverResult SolverCG<T, Matrix>::solve(const std::vector<T> &b, std::vector<T> &x,
+                                        const Preconditioner<T> *precond){
+    const unsigned int n = this->A.get_nrows();
+    assert(b.size()==n && x.size()==n);
+    SolverResult result;
+    result.history.reserve(this->max_iterations+1);
+    const double b_norm = std::sqrt((double)dot(b, b));
+    if(b_norm==0.){
+        // The solution of A*x = 0 is x = 0
+        std::fill(x.begin(), x.end(), T(0));
+        result.converged = true;
+        return result;
+    }
+    // r = b - A*x
+    r = b;
+    this->A.multiply(T(-1), x, T(1), r);
+    T rr = dot(r, r);
+    this->monitor(result, std::sqrt((double)rr)/b_norm);
+    if(result.residual<=this->tolerance){
+        result.converged = true;
+        return result;
+    }
+    // Without preconditioner z = r, so we just refer to r instead of copying it
+    const std::vector<T> &z_ref = (precond!=nullptr) ? z : r;
+    if(precond!=nullptr){
+        precond->apply(r, z);
+    }
+    p = z_ref;
+    T rz = (precond!=nullptr) ? dot(r, z) : rr;
+    while(result.iterations<this->max_iterations){
+        result.iterations++;
+        // q = A*p and step length alpha = (r*z)/(p*A*p)
+        this->A.multiply(T(1), p, T(0), q);
+        const T pq = dot(p, q);
+        if(pq==T(0)){
+            // Breakdown (p is in the kernel of A): we cannot go on
+            break;
+        }
+        const T alpha = rz/pq;
+        // x = x + alpha*p, r = r - alpha*q (and r*r for the convergence check) in a single pass
+        rr = cg_update(alpha, p, q, x, r);
+        this->monitor(result, std::sqrt((double)rr)/b_norm);
+        if(result.residual<=this->tolerance){
+            result.converged = true;
+            break;
+        }
+        // New direction p = z + beta*p, with beta = (r_new*z_new)/(r*z)
+        T rz_new = rr;
+        if(precond!=nullptr){
+            precond->apply(r, z);
+            rz_new = dot(r, z);
+        }
+        const T beta = rz_new/rz;
+        rz = rz_new;
+        for(unsigned int i=0; i<n; i++){
+            p[i] = z_ref[i] + beta*p[i];
+        }
+    }
+    return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// (6) SolverBiCGSTAB definitions
+// SolverBiCGSTAB constructor (the workspace is allocated here, once for all the calls to solve)
+template <typename T, typename Matrix>
+SolverBiCGSTAB<T, Matrix>::SolverBiCGSTAB(const Matrix &matrix,
+                                          const unsigned int &max_it,
+                                          const double &tol) : IterativeSolver<T, Matrix>(matrix, max_it, tol),
+    r(matrix.get_nrows()), r0(matrix.get_nrows()), p(matrix.get_nrows()), v(matrix.get_nrows()),
+    s(matrix.get_nrows()), t(matrix.get_nrows()), p_hat(matrix.get_nrows()), s_hat(matrix.get_nrows()) {};
+
+// Method to solve A*x = b with the (right preconditioned) BiCGSTAB
+template <typename T, typename Matrix>
+SolverResult SolverBiCGSTAB<T, Matrix>::solve(const std::vector<T> &b, std::vector<T> &x,
+                                              const Preconditioner<T> *precond){
+    const unsigned int n = this->A.get_nrows();
+    assert(b.size()==n && x.size()==n);
+    SolverResult result;
+    result.history.reserve(this->max_iterations+1);
+    const double b_norm = std::sqrt((double)dot(b, b));
+    if(b_norm==0.){
+        // The solution of A*x = 0 is x = 0
+        std::fill(x.begin(), x.end(), T(0));
+        result.converged = true;
+        return result;
+    }
+    // r = b - A*x, and the shadow residual r0 is its initial value
+    r = b;
+    this->A.multiply(T(-1), x, T(1), r);
+    r0 = r;
+    T rho = dot(r0, r);
+    this->monitor(result, std::sqrt((double)rho)/b_norm);
+    if(result.residual<=this->tolerance){
+        result.converged = true;
+        return result;
+    }
+    // Without preconditioner p_hat = p and s_hat = s, so we just refer to them instead of copying
+    const std::vector<T> &p_ref = (precond!=nullptr) ? p_hat : p;
+    const std::vector<T> &s_ref = (precond!=nullptr) ? s_hat : s;
+    T rho_old = 1, alpha = 1, omega = 1;
+    while(result.iterations<this->max_iterations){
+        result.iterations++;
+        // (1) New direction p = r + beta*(p - omega*v), with beta = (rho/rho_old)*(alpha/omega)
+        if(result.iterations==1){
+            p = r;
+        }
+        else{
+            const T beta = (rho/rho_old)*(alpha/omega);
+            for(unsigned int i=0; i<n; i++){
+                p[i] = r[i] + beta*(p[i]-omega*v[i]);
+            }
+        }
+        if(precond!=nullptr){
+            precond->apply(p, p_hat);
+        }
+        // (2) v = A*p_hat, alpha = rho/(r0*v) and s = r - alpha*v (with s*s in the same pass)
+        this->A.multiply(T(1), p_ref, T(0), v);
+        const T r0v = dot(r0, v);
+        if(r0v==T(0)){
+            // Breakdown: r0 is orthogonal to v
+            break;
+        }
+        alpha = rho/r0v;
+        const T ss = axpy_dot(-alpha, v, r, s);
+        if(std::sqrt((double)ss)/b_norm<=this->tolerance){
+            // Early exit: s is already small enough, so the half step is the solution
+            for(unsigned int i=0; i<n; i++){
+                x[i] += alpha*p_ref[i];
+            }
+            this->monitor(result, std::sqrt((double)ss)/b_norm);
+            result.converged = true;
+            break;
+        }
+        if(precond!=nullptr){
+            precond->apply(s, s_hat);
+        }
+        // (3) t = A*s_hat and omega = (t*s)/(t*t) (both dot products in the same pass)
+        this->A.multiply(T(1), s_ref, T(0), t);
+        T ts, tt;
+        dot_pair(t, s, ts, tt);
+        if(tt==T(0)){
+            break;
+        }
+        omega = ts/tt;
+        // (4) x = x + alpha*p_hat + omega*s_hat, r = s - omega*t (and r*r, r0*r) in a single pass
+        T r0r;
+        const T rr = bicgstab_update(alpha, p_ref, omega, s_ref, s, t, r0, x, r, r0r);
+        this->monitor(result, std::sqrt((double)rr)/b_norm);
+        if(result.residual<=this->tolerance){
+            result.converged = true;
+            break;
+        }
+        if(omega==T(0) || r0r==T(0)){
+            // Breakdown: the method stagnates (omega=0) or r0 became orthogonal to r
+            break;
+        }
+        rho_old = rho;
+        rho = r0r;
+    }
+    return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Function to compute the dot product of two vectors
+template <typename T>
+T dot(const std::vector<T> &a, const std::vector<T> &b){
+    T sum = 0;
+    for(unsigned int i=0; i<a.size(); i++){
+        sum += a[i]*b[i];
+    }
+    return sum;
+}
+
+// Function to compute z = y + alpha*x and return z*z
+template <typename T>
+T axpy_dot(const T alpha, const std::vector<T> &x, const std::vector<T> &y, std::vector<T> &z){
+    T sum = 0;
+    for(unsigned int i=0; i<z.size(); i++){
+        z[i] = y[i] + alpha*x[i];
+        sum += z[i]*z[i];
+    }
+    return sum;
+}
+
+// Function to compute a*b and a*a
+template <typename T>
+void dot_pair(const std::vector<T> &a, const std::vector<T> &b, T &ab, T &aa){
+    ab = 0;
+    aa = 0;
+    for(unsigned int i=0; i<a.size(); i++){
+        ab += a[i]*b[i];
+        aa += a[i]*a[i];
+    }
+}
+
+// Function to compute the CG update (x = x + alpha*p, r = r - alpha*q) and return r*r
+template <typename T>
+T cg_update(const T alpha, const std::vector<T> &p, const std::vector<T> &q, std::vector<T> &x, std::vector<T> &r){
+    T sum = 0;
+    for(unsigned int i=0; i<r.size(); i++){
+        x[i] += alpha*p[i];
+        r[i] -= alpha*q[i];
+        sum += r[i]*r[i];
+    }
+    return sum;
+}
+
+// Function to compute the BiCGSTAB update (x = x + alpha*p_hat + omega*s_hat, r = s - omega*t), r*r and r0*r
+template <typename T>
+T bicgstab_update(const T alpha, const std::vector<T> &p_hat, const T omega, const std::vector<T> &s_hat,
+                  const std::vector<T> &s, const std::vector<T> &t, const std::vector<T> &r0,
+                  std::vector<T> &x, std::vector<T> &r, T &r0r){
+    T sum = 0;
+    r0r = 0;
+    for(unsigned int i=0; i<r.size(); i++){
+        x[i] += alpha*p_hat[i] + omega*s_hat[i];
+        r[i] = s[i] - omega*t[i];
+        sum += r[i]*r[i];
+        r0r += r0[i]*r[i];
+    }
+    return sum;
+}
@@ -6,21 +6,34 @@
 #include<iostream>
 #include<vector>
 #include<cassert>
+#include<thread>
+#include<algorithm>
+#include<climits>
+#include<limits>
+#include<cmath>
+#include<chrono>
+#include<utility>
+#include<stdexcept>
+#include<unistd.h>
+#include "simd.hpp"
 //---------------------------------------------------------------------------------------------------------------------
 // (1) SparseMatrix class declaration (base class)
-template <typename T>
+/* I is the type of the column indices (unsigned int by default): a narrower type (e.g. unsigned short for matrices
+   with at most 65536 columns) means less memory traffic in the bandwidth-bound products. Only COO and CSR let
+   the user choose it, the other formats always use unsigned int */
+template <typename T, typename I=unsigned int>
 class SparseMatrix{
 public:
     // Default constructor
     SparseMatrix(const unsigned int &nr,
                  const unsigned int &nc,
                  const std::vector<T> &d,
-                 const std::vector<unsigned int> &c);
+                 const std::vector<I> &c);
                  /*rows vector not defined here: its meaning will be completely different among derived classes*/
     // Copy constructor
-    SparseMatrix(const SparseMatrix<T> &other);
+    SparseMatrix(const SparseMatrix<T,I> &other);
     // Assignment operator
-    SparseMatrix<T> & operator =(const SparseMatrix<T> &other);
+    SparseMatrix<T,I> & operator =(const SparseMatrix<T,I> &other);
     // Virtual destructor
     virtual ~SparseMatrix() {std::cout<<"Destructed SparseMatrix"<<std::endl;}
     /*Since we used std::vector, we don't need to worry about memory deallocation*/
@@ -29,14 +42,30 @@ public:
     unsigned int get_nrows()const{return n_rows;}
     // Method to get the number of columns
     unsigned int get_ncols()const{return n_cols;}
-    // Method to get the number of nonzero values
-    unsigned int get_nzeros()const{return values.size();}
-    // Method to get the nonzero values
-    std::vector<T> get_values()const{return values;}
+    // Method to get the number of nonzero values (virtual: some formats also store padding zeros)
+    virtual unsigned long long get_nzeros()const{return values.size();}
+    // Method to get the nonzero values (by reference, to avoid copying the whole vector)
+    const std::vector<T> &get_values()const{return values;}
     // Method to get the column vector
-    std::vector<unsigned int> get_cols()const{return cols;}
-    // Virtual operator for matrix-vector product
-    virtual const std::vector<T> operator*(const std::vector<T> &vec)const=0;
+    const std::vector<I> &get_cols()const{return cols;}
+    // Method to get the number of threads used by the parallel kernels
+    unsigned int get_threads()const{return n_threads;}
+    // Method to set the number of threads used by the parallel kernels (1 = serial, 0 = all available cores)
+    void set_threads(const unsigned int &nt){
+        n_threads = (nt==0) ? std::max(1u, std::thread::hardware_concurrency()) : nt;
+    }
+    // Operator for matrix-vector product (it allocates the result, see multiply to reuse an existing vector)
+    std::vector<T> operator*(const std::vector<T> &vec)const;
+    // Method to compute y = alpha*A*x + beta*y in place (no allocation: y is provided by the caller)
+    void multiply(const T alpha, const std::vector<T> &x, const T beta, std::vector<T> &y)const;
+    // Same method on raw buffers (x of length n_cols, y of length n_rows, e.g. parts of a bigger array)
+    void multiply(const T alpha, const T *x, const T beta, T *y)const{multiply_add(alpha, x, beta, y);}
+    // Method to compute y = alpha*A^T*x + beta*y in place (without building the transpose)
+    void multiply_transposed(const T alpha, const std::vector<T> &x, const T beta, std::vector<T> &y)const;
+    // Same method on raw buffers (x of length n_rows, y of length n_cols)
+    void multiply_transposed(const T alpha, const T *x, const T beta, T *y)const{
+        multiply_add_transposed(alpha, x, beta, y);
+    }
     // Virtual method to print a matrix in a convenient way
     virtual void print()=0;
     // Virtual method to print all information about the matrix
@@ -60,7 +89,7 @@ public:
             return *this;
         }
     private:
-        SparseMatrix<T>& matrix;
+        SparseMatrix<T,I>& matrix;
         unsigned int row;
         unsigned int col;
     };
@@ -78,108 +107,854 @@ protected:
     /* Some (virtual) helper functions to make other class methods easier both to 
        implement and understand (check "helper.hpp" file for their definition) */
     // (I) Helper function to find the index (in values vector) of an element at position (i,j)
-    virtual const int findIndex(const unsigned int i, const unsigned int j) const=0;
+    virtual const long long findIndex(const unsigned int i, const unsigned int j) const=0;
     // (II) Helper function to get the value at position (i, j)
     virtual const T getValue(const unsigned int i, const unsigned int j) const=0;
     // (III) Helper function to set the new value at position (i, j)
     virtual void setValue(const unsigned int i, const unsigned int j, const T value)=0;
+    // (IV) Helper function to compute y = alpha*A*x + beta*y (x and y must not overlap; if beta is 0, y is not read)
+    virtual void multiply_add(const T alpha, const T *x, const T beta, T *y) const=0;
+    // (V) Helper function to compute y = alpha*A^T*x + beta*y (same rules as multiply_add)
+    virtual void multiply_add_transposed(const T alpha, const T *x, const T beta, T *y) const=0;
     
     // Attributes of the class SparseMatrix
     unsigned int n_rows;
     unsigned int n_cols;
     std::vector<T> values;
-    std::vector<unsigned int> cols;
+    std::vector<I> cols;
+    // Number of threads used by the parallel kernels (by default we keep the serial version)
+    unsigned int n_threads=1;
 };
 
 //---------------------------------------------------------------------------------------------------------------------
-// (2) SparseMatrixCOO class declaration (derived class of SparseMatrix)
-template <typename T>
-class SparseMatrixCOO : public SparseMatrix<T>{
+// SparseFormat class declaration (static interface of the formats, between SparseMatrix and the derived classes)
+/* CRTP layer: each format derives from SparseFormat<Format, T>, which re-declares element access and products with
+   qualified (so non-virtual) calls to the helpers of Format. Code that knows the format at compile time, e.g. a
+   template on the matrix type, gets direct calls that the compiler can inline; through a SparseMatrix<T> reference
+   the virtual helpers are still used, so the base class is just a thin adapter to the same functions. */
+template <typename Derived, typename T, typename I=unsigned int>
+class SparseFormat: public SparseMatrix<T,I>{
+public:
+    // Constructor (the same as the base class)
+    SparseFormat(const unsigned int &nr,
+                 const unsigned int &nc,
+                 const std::vector<T> &d,
+                 const std::vector<I> &c) : SparseMatrix<T,I>(nr, nc, d, c) {};
+
+    // Method to read the value at position (i,j) without proxy
+    T get(const unsigned int i, const unsigned int j) const{
+        assert(i<this->n_rows && j<this->n_cols);
+        return derived().Derived::getValue(i, j);
+    }
+    // Method to write the value at position (i,j) without proxy
+    void set(const unsigned int i, const unsigned int j, const T value){
+        assert(i<this->n_rows && j<this->n_cols);
+        derived().Derived::setValue(i, j, value);
+    }
+    // Operator for matrix-vector product (the same as the base class, with a direct call to the kernel)
+    std::vector<T> operator*(const std::vector<T> &vec)const{
+        assert(vec.size()==this->n_cols);
+        std::vector<T> result(this->n_rows);
+        derived().Derived::multiply_add(T(1), vec.data(), T(0), result.data());
+        return result;
+    }
+    // Method to compute y = alpha*A*x + beta*y in place (direct call to the kernel)
+    void multiply(const T alpha, const std::vector<T> &x, const T beta, std::vector<T> &y)const{
+        assert(x.size()==this->n_cols && y.size()==this->n_rows && &x!=&y);
+        derived().Derived::multiply_add(alpha, x.data(), beta, y.data());
+    }
+    // Same method on raw buffers
+    void multiply(const T alpha, const T *x, const T beta, T *y)const{
+        derived().Derived::multiply_add(alpha, x, beta, y);
+    }
+    // Method to compute y = alpha*A^T*x + beta*y in place (direct call to the kernel)
+    void multiply_transposed(const T alpha, const std::vector<T> &x, const T beta, std::vector<T> &y)const{
+        assert(x.size()==this->n_rows && y.size()==this->n_cols && &x!=&y);
+        derived().Derived::multiply_add_transposed(alpha, x.data(), beta, y.data());
+    }
+    // Same method on raw buffers
+    void multiply_transposed(const T alpha, const T *x, const T beta, T *y)const{
+        derived().Derived::multiply_add_transposed(alpha, x, beta, y);
+    }
+
+    //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    // Proxy to implement reading-writing access on a matrix of a known format
+    class ProxyFormat {
+    public:
+        ProxyFormat(Derived& matrix,
+                    const unsigned int i,
+                    const unsigned int j): matrix(matrix), row(i), col(j) {}
+
+        // Reading operator
+        operator T() const {
+            return matrix.Derived::getValue(row, col);
+        }
+        // Writing operator
+        ProxyFormat& operator=(const T &value) {
+            matrix.Derived::setValue(row, col, value);
+            return *this;
+        }
+    private:
+        Derived& matrix;
+        unsigned int row;
+        unsigned int col;
+    };
+    //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+    // Access operator
+    ProxyFormat operator()(const unsigned int i, const unsigned int j) {
+        assert(i<this->n_rows && j<this->n_cols);
+        return ProxyFormat(derived(), i, j);
+    }
+
+private:
+    // Helper functions to get the derived class (the format) of the object
+    const Derived &derived() const{return static_cast<const Derived&>(*this);}
+    Derived &derived(){return static_cast<Derived&>(*this);}
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// (2) SparseMatrixCOO class declaration (derived class of SparseMatrix, through SparseFormat)
+/* I is the type of the (row and column) indices, P the type of the positions in values (used by the hash index),
+   so P must be able to count all the nonzeros */
+template <typename T, typename I=unsigned int, typename P=unsigned int>
+class SparseMatrixCOO: public SparseFormat<SparseMatrixCOO<T,I,P>, T, I>{
 public:
     // Constructor
     SparseMatrixCOO(const unsigned int &nr,
                     const unsigned int &nc,
                     const std::vector<T> &d,
-                    const std::vector<unsigned int> &c,
-                    const std::vector<unsigned int> &r);
+                    const std::vector<I> &c,
+                    const std::vector<I> &r);
     // Copy constructor
-    SparseMatrixCOO(const SparseMatrixCOO<T> &other);
+    SparseMatrixCOO(const SparseMatrixCOO<T,I,P> &other);
     // Destructor
     ~SparseMatrixCOO() {std::cout<<"Destructed SparseMatrixCOO"<<std::endl;}
     //Assignment operator
-    SparseMatrixCOO<T> & operator =(const SparseMatrixCOO<T> &other);
+    SparseMatrixCOO<T,I,P> & operator =(const SparseMatrixCOO<T,I,P> &other);
     // Method to print a SparseMatrixCOO
     void print() override;
     // Method to print information about a SparseMatrixCOO
     void get_info() const override;
     //Method to get the rows
-    std::vector<unsigned int> get_rows()const{return rows;}
-    // Operator for COO matrix-vector product
-    const std::vector<T> operator*(const std::vector<T> &vec) const override;
+    const std::vector<I> &get_rows()const{return rows;}
+    // Method to check if element access uses the hash index
+    bool is_indexed()const{return !index_keys.empty();}
+    // Method to build (true) or drop (false) the hash index used by element access
+    void set_indexed(const bool &flag);
     
 
 private:
+    // The static interface (SparseFormat) calls the helper functions directly
+    friend class SparseFormat<SparseMatrixCOO<T,I,P>, T, I>;
     /* Some helper functions to make other class methods easier both to 
        implement and understand (check "helper.hpp" file for their definition) */
     // (I) Helper function to find the index (in values vector) of an element at position (i,j)
-    const int findIndex(const unsigned int i, const unsigned int j) const override;
+    const long long findIndex(const unsigned int i, const unsigned int j) const override;
     // (II) Helper function to get the value at position (i, j)
     const T getValue(const unsigned int i, const unsigned int j) const override;
     // (III) Helper function to set the new value at position (i, j)
     void setValue(const unsigned int i, const unsigned int j, const T value) override;
+    // (IV) Helper function to compute y = alpha*A*x + beta*y
+    void multiply_add(const T alpha, const T *x, const T beta, T *y) const override;
+    // (V) Helper function to compute y = alpha*A^T*x + beta*y
+    void multiply_add_transposed(const T alpha, const T *x, const T beta, T *y) const override;
+    // (VI) Helper function to get the slot where the probe sequence of a key starts in the hash index
+    std::size_t homeSlot(const unsigned long long key) const;
+    // (VII) Helper function to find the slot of the key (i,j) in the hash index (or the empty slot where it would go)
+    std::size_t findSlot(const unsigned int i, const unsigned int j) const;
+    // (VIII) Helper function to rebuild the hash index with a given (power of 2) number of slots
+    void rebuildIndex(const std::size_t n_slots);
+    // (IX) Helper function to remove the key in a slot of the hash index (keeping the other keys reachable)
+    void eraseSlot(std::size_t slot);
+    // (X) Helper function to index another occurrence of (i,j), if any, after the indexed one was removed
+    void reindexDuplicate(const unsigned int i, const unsigned int j);
 
-    //Here the only private attribute of the class SparseMatrixCOO (rows)
-    std::vector<unsigned int> rows;
+    // Attributes of the class SparseMatrixCOO
+    std::vector<I> rows;
+    /* Optional hash index (open addressing with linear probing): index_keys holds the packed key (row<<32|col)
+       of each slot (EMPTY_KEY if free) and index_pos the position of that element in values */
+    std::vector<unsigned long long> index_keys;
+    std::vector<P> index_pos;
+    // Number of elements left out of the hash index because their (i,j) was already there (duplicates)
+    P index_duplicates=0;
+    static constexpr unsigned long long EMPTY_KEY = ~0ULL;
 };
 
 //---------------------------------------------------------------------------------------------------------------------
-// (3) SparseMatrixCSR class declaration (derived class of SparseMatrix)
-template <typename T>
-class SparseMatrixCSR: public SparseMatrix<T>{
+// (3) SparseMatrixCSR class declaration (derived class of SparseMatrix, through SparseFormat)
+/* The columns of each row are always sorted: the constructor sorts the rows that are not, and setValue inserts
+   new elements in their sorted position (so element access can use a binary search inside the row).
+   I is the type of the column indices and P the type of the row pointers (rows_idx): they are independent, so e.g.
+   a matrix with more than 4.29 billion nonzeros can keep 32-bit columns with 64-bit row pointers */
+template <typename T, typename I=unsigned int, typename P=unsigned int>
+class SparseMatrixCSR: public SparseFormat<SparseMatrixCSR<T,I,P>, T, I>{
 public:
     // Constructor
     SparseMatrixCSR(const unsigned int &nr,
                     const unsigned int &nc,
                     const std::vector<T> &d,
-                    const std::vector<unsigned int> &c,
-                    const std::vector<unsigned int> &r);
+                    const std::vector<I> &c,
+                    const std::vector<P> &r);
     
     // Copy constructor
-    SparseMatrixCSR(const SparseMatrixCSR<T> &other);
+    SparseMatrixCSR(const SparseMatrixCSR<T,I,P> &other);
     // Destructor
     ~SparseMatrixCSR() {std::cout<<"Destructed SparseMatrixCSR"<<std::endl;}
     // Assignment operator
-    SparseMatrixCSR<T> & operator =(const SparseMatrixCSR<T> &other);
+    SparseMatrixCSR<T,I,P> & operator =(const SparseMatrixCSR<T,I,P> &other);
     // Method to print a SparseMatrixCSR
     void print() override;
     // Method to print information about a SparseMatrixCSR
     void get_info() const override;
     //Method to get the rows indexes
-    std::vector<unsigned int> get_rows_idx()const{return rows_idx;}
-    // Operator for CSR matrix-vector product
-    const std::vector<T> operator*(const std::vector<T> &vec) const override;
+    const std::vector<P> &get_rows_idx()const{return rows_idx;}
+    // Operator for CSR matrix-vector product (the one of SparseFormat, hidden by the CSR-CSR one otherwise)
+    using SparseFormat<SparseMatrixCSR<T,I,P>, T, I>::operator*;
+    // Operator for CSR matrix-matrix product (SpGEMM)
+    SparseMatrixCSR<T,I,P> operator*(const SparseMatrixCSR<T,I,P> &other) const;
+    // Method to multiply the matrix by n_vec vectors at once (X and the result are dense and row-major)
+    std::vector<T> multiply_vectors(const std::vector<T> &X, const unsigned int n_vec) const;
+    // Method to compute Y = alpha*A*X + beta*Y in place for n_vec vectors at once (X and Y dense and row-major)
+    void multiply_vectors(const T alpha, const std::vector<T> &X, const T beta, std::vector<T> &Y,
+                          const unsigned int n_vec) const;
+    // Same method on raw buffers
+    void multiply_vectors(const T alpha, const T *X, const T beta, T *Y, const unsigned int n_vec) const;
 
 private:
+    // The static interface (SparseFormat) calls the helper functions directly
+    friend class SparseFormat<SparseMatrixCSR<T,I,P>, T, I>;
     /* Some helper functions to make other class methods easier both to 
        implement and understand (check "helper.hpp" file for their definition) */
     // (I) Helper function to find the index (in values vector) of an element at position (i,j)
-    const int findIndex(const unsigned int i, const unsigned int j) const override;
+    const long long findIndex(const unsigned int i, const unsigned int j) const override;
     // (II) Helper function to get the value at position (i, j)
     const T getValue(const unsigned int i, const unsigned int j) const override;
     // (III) Helper function to set the new value at position (i, j)
     void setValue(const unsigned int i, const unsigned int j, const T value) override;
+    // (IV) Helper function to compute y = alpha*A*x + beta*y
+    void multiply_add(const T alpha, const T *x, const T beta, T *y) const override;
+    // (V) Helper function to compute y = alpha*A^T*x + beta*y
+    void multiply_add_transposed(const T alpha, const T *x, const T beta, T *y) const override;
+    // (VI) Helper function to compute the matrix-vector product restricted to the rows [first,last)
+    void multiply_rows(const unsigned int first, const unsigned int last,
+                       const T alpha, const T *x, const T beta, T *y) const;
+    // (VII) Helper function to sort the columns (and the values) of the rows that are not sorted
+    void sortRows();
 
     //Here the only private attribute of the class SparseMatrixCSR (rows_idx)
+    std::vector<P> rows_idx;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// (4) SparseMatrixSELL class declaration (derived class of SparseMatrix, through SparseFormat)
+/* Sliced ELLPACK (SELL-C-sigma) format: rows are sorted by decreasing length inside windows of sigma rows,
+   then grouped in chunks of C consecutive (sorted) rows. Each chunk is padded to the length of its longest row
+   and stored column-major, so that the C rows of a chunk can be processed together by SIMD lanes. */
+template <typename T>
+class SparseMatrixSELL: public SparseFormat<SparseMatrixSELL<T>, T>{
+public:
+    // Constructor (from the CSR vectors of the matrix)
+    SparseMatrixSELL(const unsigned int &nr,
+                     const unsigned int &nc,
+                     const std::vector<T> &d,
+                     const std::vector<unsigned int> &c,
+                     const std::vector<unsigned int> &r,
+                     const unsigned int &chunk=8,
+                     const unsigned int &window=256);
+    // Copy constructor
+    SparseMatrixSELL(const SparseMatrixSELL<T> &other);
+    // Destructor
+    ~SparseMatrixSELL() {std::cout<<"Destructed SparseMatrixSELL"<<std::endl;}
+    // Assignment operator
+    SparseMatrixSELL<T> & operator =(const SparseMatrixSELL<T> &other);
+    // Method to print a SparseMatrixSELL
+    void print() override;
+    // Method to print information about a SparseMatrixSELL
+    void get_info() const override;
+    // Method to get the number of nonzero values (padding excluded)
+    unsigned long long get_nzeros() const override{return nnz;}
+    // Method to get the chunk size (C)
+    unsigned int get_chunk_size()const{return chunk_size;}
+    // Method to get the sorting window (sigma)
+    unsigned int get_sigma()const{return sigma;}
+    // Method to get the chunks indexes (position of the first element of each chunk in values)
+    const std::vector<unsigned int> &get_chunks_idx()const{return chunks_idx;}
+    // Method to get the chunks lengths (padded length of the rows of each chunk)
+    const std::vector<unsigned int> &get_chunks_len()const{return chunks_len;}
+    // Method to get the rows permutation (original index of the row in each sorted position)
+    const std::vector<unsigned int> &get_perm()const{return perm;}
+    // Method to get the rows lengths (actual length, padding excluded, of the row in each sorted position)
+    const std::vector<unsigned int> &get_rows_len()const{return rows_len;}
+
+private:
+    // The static interface (SparseFormat) calls the helper functions directly
+    friend class SparseFormat<SparseMatrixSELL<T>, T>;
+    /* Some helper functions to make other class methods easier both to 
+       implement and understand (check "helper.hpp" file for their definition) */
+    // (I) Helper function to find the index (in values vector) of an element at position (i,j)
+    const long long findIndex(const unsigned int i, const unsigned int j) const override;
+    // (II) Helper function to get the value at position (i, j)
+    const T getValue(const unsigned int i, const unsigned int j) const override;
+    // (III) Helper function to set the new value at position (i, j)
+    void setValue(const unsigned int i, const unsigned int j, const T value) override;
+    // (IV) Helper function to compute y = alpha*A*x + beta*y
+    void multiply_add(const T alpha, const T *x, const T beta, T *y) const override;
+    // (V) Helper function to compute y = alpha*A^T*x + beta*y
+    void multiply_add_transposed(const T alpha, const T *x, const T beta, T *y) const override;
+
+    // Attributes of the class SparseMatrixSELL
+    unsigned int chunk_size;                 // number of rows in each chunk (C)
+    unsigned int sigma;                      // number of rows in each sorting window
+    unsigned int nnz;                        // number of nonzeros (padding excluded)
+    std::vector<unsigned int> chunks_idx;    // cumulative number of stored elements up to the k-th chunk (excluded)
+    std::vector<unsigned int> chunks_len;    // padded length of the rows of the k-th chunk
+    std::vector<unsigned int> rows_len;      // actual length of the row in the p-th sorted position
+    std::vector<unsigned int> perm;          // original index of the row in the p-th sorted position
+    std::vector<unsigned int> perm_inv;      // sorted position of the i-th original row
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// (5) SparseMatrixBSR class declaration (derived class of SparseMatrix, through SparseFormat)
+/* Block CSR format with (compile-time) RxC dense blocks: it is a CSR matrix whose "elements" are blocks, so we store
+   one column index per block instead of one per value. Matrix dimensions must be multiples of the block size
+   (otherwise the constructor throws std::invalid_argument: the last block row/column would be dropped). */
+template <typename T, unsigned int R, unsigned int C>
+class SparseMatrixBSR: public SparseFormat<SparseMatrixBSR<T,R,C>, T>{
+public:
+    // Constructor
+    SparseMatrixBSR(const unsigned int &nr,
+                    const unsigned int &nc,
+                    const std::vector<T> &d,
+                    const std::vector<unsigned int> &c,
+                    const std::vector<unsigned int> &r);
+                    /*d contains the blocks one after the other (each one row-major), c the block column of each block
+                      and r the cumulative number of blocks up to the i-th block row (excluded)*/
+    // Copy constructor
+    SparseMatrixBSR(const SparseMatrixBSR<T,R,C> &other);
+    // Destructor
+    ~SparseMatrixBSR() {std::cout<<"Destructed SparseMatrixBSR"<<std::endl;}
+    // Assignment operator
+    SparseMatrixBSR<T,R,C> & operator =(const SparseMatrixBSR<T,R,C> &other);
+    // Method to print a SparseMatrixBSR
+    void print() override;
+    // Method to print information about a SparseMatrixBSR
+    void get_info() const override;
+    // Method to get the number of nonzero values (explicit zeros inside the blocks excluded)
+    unsigned long long get_nzeros() const override;
+    // Method to get the number of blocks
+    unsigned int get_nblocks()const{return this->cols.size();}
+    // Method to get the blocks indexes
+    const std::vector<unsigned int> &get_blocks_idx()const{return blocks_idx;}
+
+private:
+    // The static interface (SparseFormat) calls the helper functions directly
+    friend class SparseFormat<SparseMatrixBSR<T,R,C>, T>;
+    /* Some helper functions to make other class methods easier both to 
+       implement and understand (check "helper.hpp" file for their definition) */
+    // (I) Helper function to find the index (in values vector) of an element at position (i,j)
+    const long long findIndex(const unsigned int i, const unsigned int j) const override;
+    // (II) Helper function to get the value at position (i, j)
+    const T getValue(const unsigned int i, const unsigned int j) const override;
+    // (III) Helper function to set the new value at position (i, j)
+    void setValue(const unsigned int i, const unsigned int j, const T value) override;
+    // (IV) Helper function to compute y = alpha*A*x + beta*y
+    void multiply_add(const T alpha, const T *x, const T beta, T *y) const override;
+    // (V) Helper function to compute y = alpha*A^T*x + beta*y
+    void multiply_add_transposed(const T alpha, const T *x, const T beta, T *y) const override;
+    // (VI) Helper function to compute the matrix-vector product restricted to the block rows [first,last)
+    void multiply_block_rows(const unsigned int first, const unsigned int last,
+                             const T alpha, const T *x, const T beta, T *y) const;
+
+    //Here the only private attribute of the class SparseMatrixBSR (blocks_idx)
+    std::vector<unsigned int> blocks_idx;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// (6) SparseMatrixCSC class declaration (derived class of SparseMatrix, through SparseFormat)
+/* Compressed Sparse Column format: the same as CSR, with the roles of rows and columns swapped (so the CSC vectors
+   of a matrix are the CSR vectors of its transpose). The cumulative number of nonzeros up to the j-th column is
+   stored in cols_idx and the row of each nonzero in rows (the cols vector of the base class is not used, as in the
+   dynamic format, so it never holds anything but column indices). */
+template <typename T>
+class SparseMatrixCSC: public SparseFormat<SparseMatrixCSC<T>, T>{
+public:
+    // Constructor
+    SparseMatrixCSC(const unsigned int &nr,
+                    const unsigned int &nc,
+                    const std::vector<T> &d,
+                    const std::vector<unsigned int> &r,
+                    const std::vector<unsigned int> &c);
+                    /*r contains the row of each nonzero and c the cumulative number of nonzeros up to the j-th column*/
+    // Copy constructor
+    SparseMatrixCSC(const SparseMatrixCSC<T> &other);
+    // Destructor
+    ~SparseMatrixCSC() {std::cout<<"Destructed SparseMatrixCSC"<<std::endl;}
+    // Assignment operator
+    SparseMatrixCSC<T> & operator =(const SparseMatrixCSC<T> &other);
+    // Method to print a SparseMatrixCSC
+    void print() override;
+    // Method to print information about a SparseMatrixCSC
+    void get_info() const override;
+    // Method to get the rows
+    const std::vector<unsigned int> &get_rows()const{return rows;}
+    // Method to get the columns indexes
+    const std::vector<unsigned int> &get_cols_idx()const{return cols_idx;}
+
+private:
+    // The static interface (SparseFormat) calls the helper functions directly
+    friend class SparseFormat<SparseMatrixCSC<T>, T>;
+    /* Some helper functions to make other class methods easier both to 
+       implement and understand (check "helper.hpp" file for their definition) */
+    // (I) Helper function to find the index (in values vector) of an element at position (i,j)
+    const long long findIndex(const unsigned int i, const unsigned int j) const override;
+    // (II) Helper function to get the value at position (i, j)
+    const T getValue(const unsigned int i, const unsigned int j) const override;
+    // (III) Helper function to set the new value at position (i, j)
+    void setValue(const unsigned int i, const unsigned int j, const T value) override;
+    // (IV) Helper function to compute y = alpha*A*x + beta*y
+    void multiply_add(const T alpha, const T *x, const T beta, T *y) const override;
+    // (V) Helper function to compute y = alpha*A^T*x + beta*y
+    void multiply_add_transposed(const T alpha, const T *x, const T beta, T *y) const override;
+
+    // Attributes of the class SparseMatrixCSC
+    std::vector<unsigned int> rows;
+    std::vector<unsigned int> cols_idx;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// (7) SparseMatrixDynamic class declaration (derived class of SparseMatrix, through SparseFormat)
+/* Mutable format for update-heavy phases: each row is a small vector of (sorted) columns with its values,
+   so inserting or removing an element only shifts the elements of its row (O(row_nnz)) instead of the whole matrix.
+   The vectors values and cols of the base class are not used (they stay empty): freeze() builds the compact CSR
+   version of the matrix (O(nnz)) for the read-heavy phase. */
+template <typename T>
+class SparseMatrixDynamic: public SparseFormat<SparseMatrixDynamic<T>, T>{
+public:
+    // Constructor (empty matrix)
+    SparseMatrixDynamic(const unsigned int &nr,
+                        const unsigned int &nc);
+    // Copy constructor
+    SparseMatrixDynamic(const SparseMatrixDynamic<T> &other);
+    // Destructor
+    ~SparseMatrixDynamic() {std::cout<<"Destructed SparseMatrixDynamic"<<std::endl;}
+    // Assignment operator
+    SparseMatrixDynamic<T> & operator =(const SparseMatrixDynamic<T> &other);
+    // Method to print a SparseMatrixDynamic
+    void print() override;
+    // Method to print information about a SparseMatrixDynamic
+    void get_info() const override;
+    // Method to get the number of nonzero values
+    unsigned long long get_nzeros() const override{return nnz;}
+    // Method to get the (sorted) columns of the i-th row
+    const std::vector<unsigned int> &get_row_cols(const unsigned int i)const{return row_cols[i];}
+    // Method to get the values of the i-th row
+    const std::vector<T> &get_row_values(const unsigned int i)const{return row_values[i];}
+    // Method to build the compact CSR version of the matrix (the dynamic matrix is left unchanged)
+    SparseMatrixCSR<T>* freeze() const;
+
+private:
+    // The static interface (SparseFormat) calls the helper functions directly
+    friend class SparseFormat<SparseMatrixDynamic<T>, T>;
+    /* Some helper functions to make other class methods easier both to 
+       implement and understand (check "helper.hpp" file for their definition) */
+    // (I) Helper function to find the index (in the vectors of the row i) of an element at position (i,j)
+    const long long findIndex(const unsigned int i, const unsigned int j) const override;
+    // (II) Helper function to get the value at position (i, j)
+    const T getValue(const unsigned int i, const unsigned int j) const override;
+    // (III) Helper function to set the new value at position (i, j)
+    void setValue(const unsigned int i, const unsigned int j, const T value) override;
+    // (IV) Helper function to compute y = alpha*A*x + beta*y
+    void multiply_add(const T alpha, const T *x, const T beta, T *y) const override;
+    // (V) Helper function to compute y = alpha*A^T*x + beta*y
+    void multiply_add_transposed(const T alpha, const T *x, const T beta, T *y) const override;
+
+    // Attributes of the class SparseMatrixDynamic
+    std::vector<std::vector<unsigned int>> row_cols;    // sorted columns of each row
+    std::vector<std::vector<T>> row_values;             // values of each row (in the same order)
+    unsigned int nnz=0;                                 // total number of nonzeros
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// (8) SparseMatrixSymmetric class declaration (derived class of SparseMatrix, through SparseFormat)
+/* Symmetric CSR format: only the upper triangle (diagonal included) of a square symmetric matrix is stored, in the
+   CSR vectors values, cols and rows_idx (columns sorted, so the first element of a row is its diagonal, if stored).
+   Each off-diagonal element is used twice by the product: a_ij*x_j for y_i and a_ij*x_i for y_j, so the matrix is
+   streamed just once with about half the bytes of the full CSR. Element (i,j) and (j,i) are the same element. */
+template <typename T>
+class SparseMatrixSymmetric: public SparseFormat<SparseMatrixSymmetric<T>, T>{
+public:
+    // Constructor (from the CSR vectors of the upper triangle, i.e. cols[k]>=i for every element of the row i)
+    SparseMatrixSymmetric(const unsigned int &n,
+                          const std::vector<T> &d,
+                          const std::vector<unsigned int> &c,
+                          const std::vector<unsigned int> &r);
+    // Copy constructor
+    SparseMatrixSymmetric(const SparseMatrixSymmetric<T> &other);
+    // Destructor
+    ~SparseMatrixSymmetric() {std::cout<<"Destructed SparseMatrixSymmetric"<<std::endl;}
+    // Assignment operator
+    SparseMatrixSymmetric<T> & operator =(const SparseMatrixSymmetric<T> &other);
+    // Method to print a SparseMatrixSymmetric
+    void print() override;
+    // Method to print information about a SparseMatrixSymmetric
+    void get_info() const override;
+    // Method to get the number of nonzero values of the whole matrix (both triangles)
+    unsigned long long get_nzeros() const override{return 2*this->values.size()-n_diag;}
+    // Method to get the number of stored values (upper triangle and diagonal)
+    unsigned long long get_nstored() const{return this->values.size();}
+    // Method to get the rows_idx vector
+    const std::vector<unsigned int> &get_rows_idx()const{return rows_idx;}
+
+private:
+    // The static interface (SparseFormat) calls the helper functions directly
+    friend class SparseFormat<SparseMatrixSymmetric<T>, T>;
+    /* Some helper functions to make other class methods easier both to 
+       implement and understand (check "helper.hpp" file for their definition) */
+    // (I) Helper function to find the index (in values vector) of an element at position (i,j) (or (j,i))
+    const long long findIndex(const unsigned int i, const unsigned int j) const override;
+    // (II) Helper function to get the value at position (i, j)
+    const T getValue(const unsigned int i, const unsigned int j) const override;
+    // (III) Helper function to set the new value at position (i, j) (and so at position (j, i))
+    void setValue(const unsigned int i, const unsigned int j, const T value) override;
+    // (IV) Helper function to compute y = alpha*A*x + beta*y
+    void multiply_add(const T alpha, const T *x, const T beta, T *y) const override;
+    // (V) Helper function to compute y = alpha*A^T*x + beta*y (the same as multiply_add, since A^T=A)
+    void multiply_add_transposed(const T alpha, const T *x, const T beta, T *y) const override;
+    // (VI) Helper function to compute the product of the rows [first,last): the contributions of their transposed
+    //      part to the rows >= last are accumulated in spill (spill[j-last] for the row j) instead of y
+    void multiply_rows(const unsigned int first, const unsigned int last,
+                       const T alpha, const T *x, const T beta, T *y, T *spill) const;
+
+    // Attributes of the class SparseMatrixSymmetric
     std::vector<unsigned int> rows_idx;
+    unsigned int n_diag=0;              // number of stored diagonal elements
 };
 
-// Function to convert a SparseMatrixCOO into a SparseMatrixCSR
+//---------------------------------------------------------------------------------------------------------------------
+// (9) SparseMatrixMixed class declaration (derived class of SparseMatrix, through SparseFormat)
+/* Mixed precision CSR format: the values are stored in a narrower type S (float or bfloat16) and converted to T
+   (double) as the product loads them, so x, y and all the sums are in T and the matrix streams 4 (float) or 2
+   (bfloat16) bytes per value instead of 8. Only the rounding of the stored values changes the result: see
+   precision_report() to measure it. The vector values of the base class is not used (it stays empty) */
+template <typename T, typename S>
+class SparseMatrixMixed: public SparseFormat<SparseMatrixMixed<T,S>, T>{
+public:
+    // Constructor (from the CSR vectors, with the values already in the storage type)
+    SparseMatrixMixed(const unsigned int &nr,
+                      const unsigned int &nc,
+                      const std::vector<S> &d,
+                      const std::vector<unsigned int> &c,
+                      const std::vector<unsigned int> &r);
+    // Copy constructor
+    SparseMatrixMixed(const SparseMatrixMixed<T,S> &other);
+    // Destructor
+    ~SparseMatrixMixed() {std::cout<<"Destructed SparseMatrixMixed"<<std::endl;}
+    // Assignment operator
+    SparseMatrixMixed<T,S> & operator =(const SparseMatrixMixed<T,S> &other);
+    // Method to print a SparseMatrixMixed
+    void print() override;
+    // Method to print information about a SparseMatrixMixed
+    void get_info() const override;
+    // Method to get the number of nonzero values
+    unsigned long long get_nzeros() const override{return low_values.size();}
+    // Method to get the stored values (in the storage type)
+    const std::vector<S> &get_low_values()const{return low_values;}
+    // Method to get the rows_idx vector
+    const std::vector<unsigned int> &get_rows_idx()const{return rows_idx;}
+
+private:
+    // The static interface (SparseFormat) calls the helper functions directly
+    friend class SparseFormat<SparseMatrixMixed<T,S>, T>;
+    /* Some helper functions to make other class methods easier both to 
+       implement and understand (check "helper.hpp" file for their definition) */
+    // (I) Helper function to find the index (in low_values vector) of an element at position (i,j)
+    const long long findIndex(const unsigned int i, const unsigned int j) const override;
+    // (II) Helper function to get the value at position (i, j) (converted to T)
+    const T getValue(const unsigned int i, const unsigned int j) const override;
+    // (III) Helper function to set the new value at position (i, j) (rounded to S)
+    void setValue(const unsigned int i, const unsigned int j, const T value) override;
+    // (IV) Helper function to compute y = alpha*A*x + beta*y
+    void multiply_add(const T alpha, const T *x, const T beta, T *y) const override;
+    // (V) Helper function to compute y = alpha*A^T*x + beta*y
+    void multiply_add_transposed(const T alpha, const T *x, const T beta, T *y) const override;
+
+    // Attributes of the class SparseMatrixMixed
+    std::vector<S> low_values;
+    std::vector<unsigned int> rows_idx;
+};
+
+// Struct with the accuracy of a mixed precision matrix with respect to the full precision one
+struct PrecisionReport{
+    double unit_roundoff=0.;        // maximum relative rounding error of the storage type (2^-24 float, 2^-8 bfloat16)
+    double max_value_error=0.;      // maximum relative rounding error of the stored values
+    double max_abs_error=0.;        // maximum |y-y_mixed| over the entries of the product
+    double relative_error=0.;       // ||y-y_mixed||/||y|| (2-norm) of the product
+    double bytes_ratio=0.;          // bytes of the mixed precision matrix over bytes of the full precision one
+    // Method to print the report
+    void print() const;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// (10) SparseMatrixTiled class declaration (derived class of SparseMatrix, through SparseFormat)
+/* Column-blocked CSR format for very wide matrices: the columns are split in tiles of tile_width columns and each
+   tile is a small CSR matrix of its nonempty rows only (rows without nonzeros in the tile are not stored), with
+   columns relative to the first column of the tile. The product goes tile by tile, so it only gathers from the
+   slice of x of the current tile: if the slice fits in the cache, each line of x is loaded from memory once per
+   tile instead of (almost) once per nonzero. The vectors of the base class contain the tiles one after the other
+   (cols are the local columns); for tile t, the rows are tile_rows[tiles_idx[t]:tiles_idx[t+1]] and the nonzeros
+   of the r-th stored row are [row_ptr[r], row_ptr[r+1]). The tile width is chosen at construction, if not given,
+   by timing a few candidates around the size of the L2 cache (and the untiled layout) on the matrix itself. */
 template <typename T>
-SparseMatrixCSR<T>* COO_to_CSR(SparseMatrixCOO<T> *matrix);
+class SparseMatrixTiled: public SparseFormat<SparseMatrixTiled<T>, T>{
+public:
+    // Constructor (from the CSR vectors of the matrix; tile_width=0 means auto-tuned with n_threads threads)
+    SparseMatrixTiled(const unsigned int &nr,
+                      const unsigned int &nc,
+                      const std::vector<T> &d,
+                      const std::vector<unsigned int> &c,
+                      const std::vector<unsigned int> &r,
+                      const unsigned int &tile_width=0,
+                      const unsigned int &n_threads=1);
+    // Copy constructor
+    SparseMatrixTiled(const SparseMatrixTiled<T> &other);
+    // Destructor
+    ~SparseMatrixTiled() {std::cout<<"Destructed SparseMatrixTiled"<<std::endl;}
+    // Assignment operator
+    SparseMatrixTiled<T> & operator =(const SparseMatrixTiled<T> &other);
+    // Method to print a SparseMatrixTiled
+    void print() override;
+    // Method to print information about a SparseMatrixTiled
+    void get_info() const override;
+    // Method to get the number of columns of each tile (the last one may be narrower)
+    unsigned int get_tile_width()const{return tile_width;}
+    // Method to get the number of tiles
+    unsigned int get_ntiles()const{return tiles_idx.size()-1;}
+    // Methods to get the tiles_idx, tile_rows and row_ptr vectors of the matrix
+    const std::vector<unsigned int> &get_tiles_idx()const{return tiles_idx;}
+    const std::vector<unsigned int> &get_tile_rows()const{return tile_rows;}
+    const std::vector<unsigned int> &get_row_ptr()const{return row_ptr;}
+    // Method to get the time (per product, in ms) measured by the auto-tuning for each candidate tile width
+    const std::vector<std::pair<unsigned int, double>> &get_tuning()const{return tuning;}
+    // Method to get the number of columns of the L2 cache (half of it) for a value type, the base of the auto-tuning
+    static unsigned int cache_columns();
+
+private:
+    // The static interface (SparseFormat) calls the helper functions directly
+    friend class SparseFormat<SparseMatrixTiled<T>, T>;
+    /* Some helper functions to make other class methods easier both to 
+       implement and understand (check "helper.hpp" file for their definition) */
+    // (I) Helper function to find the index (in values vector) of an element at position (i,j)
+    const long long findIndex(const unsigned int i, const unsigned int j) const override;
+    // (II) Helper function to get the value at position (i, j)
+    const T getValue(const unsigned int i, const unsigned int j) const override;
+    // (III) Helper function to set the new value at position (i, j)
+    void setValue(const unsigned int i, const unsigned int j, const T value) override;
+    // (IV) Helper function to compute y = alpha*A*x + beta*y
+    void multiply_add(const T alpha, const T *x, const T beta, T *y) const override;
+    // (V) Helper function to compute y = alpha*A^T*x + beta*y
+    void multiply_add_transposed(const T alpha, const T *x, const T beta, T *y) const override;
+    // (VI) Helper function to compute the product of the rows [first,last) (all the tiles, one after the other)
+    void multiply_rows(const unsigned int first, const unsigned int last,
+                       const T alpha, const T *x, const T beta, T *y) const;
+    // (VII) Helper function to build the tiles of the given width from the CSR vectors of the matrix
+    void buildTiles(const unsigned int width, const std::vector<T> &d, const std::vector<unsigned int> &c,
+                    const std::vector<unsigned int> &r);
+    // (VIII) Helper function to find the position (in tile_rows) of the first stored row >= i of the tile t
+    unsigned int findTileRow(const unsigned int t, const unsigned int i) const;
+
+    // Attributes of the class SparseMatrixTiled
+    unsigned int tile_width=0;
+    std::vector<unsigned int> tiles_idx;    // cumulative number of stored rows up to the t-th tile (excluded)
+    std::vector<unsigned int> tile_rows;    // row index of each stored row
+    std::vector<unsigned int> row_ptr;      // cumulative number of nonzeros up to each stored row (excluded)
+    std::vector<unsigned int> rows_idx;     // CSR rows_idx of the whole matrix (to split the rows among threads)
+    std::vector<std::pair<unsigned int, double>> tuning;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// (11) SparseMatrixHYB class declaration (derived class of SparseMatrix, through SparseFormat)
+/* Hybrid ELL+COO format, for matrices whose rows have very different lengths (e.g. power-law graphs): the first
+   ell_width nonzeros of each row are in an ELL slab (n_rows x ell_width, column-major, padded with zeros: the vectors
+   values and cols of the base class), the others in a COO tail sorted by row (a SparseMatrixCOO). The slab has the
+   same work for each row and the tail is split by nonzeros, so both parts of the product are balanced among threads
+   whatever the row lengths are. If not given, ell_width is the largest width filled by at least a third of the rows. */
+template <typename T>
+class SparseMatrixHYB: public SparseFormat<SparseMatrixHYB<T>, T>{
+public:
+    // Constructor (from the CSR vectors of the matrix; ell_width=0 means chosen from the row lengths)
+    SparseMatrixHYB(const unsigned int &nr,
+                    const unsigned int &nc,
+                    const std::vector<T> &d,
+                    const std::vector<unsigned int> &c,
+                    const std::vector<unsigned int> &r,
+                    const unsigned int &ell_width=0);
+    // Copy constructor
+    SparseMatrixHYB(const SparseMatrixHYB<T> &other);
+    // Destructor
+    ~SparseMatrixHYB() {std::cout<<"Destructed SparseMatrixHYB"<<std::endl;}
+    // Assignment operator
+    SparseMatrixHYB<T> & operator =(const SparseMatrixHYB<T> &other);
+    // Method to print a SparseMatrixHYB
+    void print() override;
+    // Method to print information about a SparseMatrixHYB
+    void get_info() const override;
+    // Method to get the number of nonzero values (padding excluded, tail included)
+    unsigned long long get_nzeros() const override{return ell_nnz + tail.get_nzeros();}
+    // Method to get the width of the ELL slab
+    unsigned int get_ell_width()const{return ell_width;}
+    // Method to get the number of nonzeros of each row in the ELL slab
+    const std::vector<unsigned int> &get_ell_len()const{return ell_len;}
+    // Method to get the COO tail
+    const SparseMatrixCOO<T> &get_tail()const{return tail;}
+
+private:
+    // The static interface (SparseFormat) calls the helper functions directly
+    friend class SparseFormat<SparseMatrixHYB<T>, T>;
+    /* Some helper functions to make other class methods easier both to 
+       implement and understand (check "helper.hpp" file for their definition) */
+    // (I) Helper function to find the index of an element at position (i,j) (positions after the slab are in the tail)
+    const long long findIndex(const unsigned int i, const unsigned int j) const override;
+    // (II) Helper function to get the value at position (i, j)
+    const T getValue(const unsigned int i, const unsigned int j) const override;
+    // (III) Helper function to set the new value at position (i, j)
+    void setValue(const unsigned int i, const unsigned int j, const T value) override;
+    // (IV) Helper function to compute y = alpha*A*x + beta*y
+    void multiply_add(const T alpha, const T *x, const T beta, T *y) const override;
+    // (V) Helper function to compute y = alpha*A^T*x + beta*y
+    void multiply_add_transposed(const T alpha, const T *x, const T beta, T *y) const override;
+    // (VI) Helper function to compute y = alpha*A_ell*x + beta*y restricted to the rows [first,last)
+    void multiply_ell(const unsigned int first, const unsigned int last,
+                      const T alpha, const T *x, const T beta, T *y) const;
+    // (VII) Helper function to find the first position of the row i in the tail
+    unsigned int findTailRow(const unsigned int i) const;
+    // (VIII) Helper function to choose the width of the slab (the largest one filled by at least a third of the rows)
+    static unsigned int chooseWidth(const std::vector<unsigned int> &r);
+    // (IX) Helper function to get the elements of v (values or cols) that go in the tail
+    template <typename U>
+    static std::vector<U> tailEntries(const std::vector<U> &v, const std::vector<unsigned int> &r,
+                                      const unsigned int width);
+    // (X) Helper function to get the rows of the elements that go in the tail
+    static std::vector<unsigned int> tailRows(const std::vector<unsigned int> &r, const unsigned int width);
+
+    // Attributes of the class SparseMatrixHYB
+    unsigned int ell_width=0;
+    unsigned long long ell_nnz=0;            // number of nonzeros in the slab (padding excluded)
+    std::vector<unsigned int> ell_len;       // number of nonzeros of the i-th row in the slab
+    SparseMatrixCOO<T> tail;                 // nonzeros that do not fit in the slab (sorted by row)
+};
+
+// Function to split the rows of a CSR matrix in blocks with (roughly) the same number of nonzeros
+/* (any cumulative vector can be used in place of rows_idx, e.g. the cumulative work of each row, or a read-only view
+    with size(), back(), begin() and end() such as the ArrayView of a memory-mapped matrix) */
+template <typename V>
+std::vector<unsigned int> nnz_partition(const V &rows_idx, const unsigned int n_parts);
+
+// Function to call fn(first, last) on each non-empty block [bounds[t], bounds[t+1]), one thread per block
+template <typename F>
+void run_blocks(const std::vector<unsigned int> &bounds, F fn);
+
+// Function to compute y = alpha*A^T*x + beta*y from the CSR vectors of A (y has length n_out = number of columns of A)
+/* (parallel scatter if n_threads>1: each thread accumulates its rows into a private copy of y, taken from scratch,
+    which is enlarged if needed and kept by the caller, or allocated for this product if scratch is null).
+   The values may be stored in a type V narrower than T (Mixed format), the products are computed in T */
+template <typename T, typename V, typename I, typename P>
+void scatter_product(const std::vector<V> &values, const std::vector<I> &cols,
+                     const std::vector<P> &rows_idx, const unsigned int n_out, const unsigned int n_threads,
+                     const T alpha, const T *x, const T beta, T *y, std::vector<T> *scratch=nullptr);
+
+// Function to transpose the CSR vectors of a matrix (counting sort on the columns, linear in the number of nonzeros)
+template <typename T, typename I, typename P>
+void transpose_vectors(const unsigned int n_cols, const std::vector<T> &values, const std::vector<I> &cols,
+                       const std::vector<P> &rows_idx, std::vector<T> &t_values,
+                       std::vector<I> &t_cols, std::vector<P> &t_rows_idx);
+
+// Function to compute v = beta*v in place (if beta is 0 the vector is just zeroed, so it may be uninitialized)
+template <typename T>
+void scale_vector(T *v, const unsigned int n, const T beta);
+
+// Function to convert a SparseMatrixCOO into a SparseMatrixCSR (parallel if the input has more than one thread)
+template <typename T, typename I, typename P>
+SparseMatrixCSR<T,I,P>* COO_to_CSR(SparseMatrixCOO<T,I,P> *matrix);
 
 // Function to convert a SparseMatrixCSR into a SparseMatrixCOO
+template <typename T, typename I, typename P>
+SparseMatrixCOO<T,I,P>* CSR_to_COO(SparseMatrixCSR<T,I,P> *matrix);
+
+// Function to convert a SparseMatrixCSR into a SparseMatrixCSR with other index types (e.g. narrower columns)
+/* (the new types must be able to hold the column indices and the number of nonzeros, this is checked by an assert) */
+template <typename I2, typename P2, typename T, typename I, typename P>
+SparseMatrixCSR<T,I2,P2>* CSR_to_CSR(SparseMatrixCSR<T,I,P> *matrix);
+
+// Function to convert a SparseMatrixCSR into a SparseMatrixSELL
+template <typename T>
+SparseMatrixSELL<T>* CSR_to_SELL(SparseMatrixCSR<T> *matrix, const unsigned int chunk=8, const unsigned int window=256);
+
+// Function to convert a SparseMatrixSELL into a SparseMatrixCSR (the padding is dropped)
+template <typename T>
+SparseMatrixCSR<T>* SELL_to_CSR(SparseMatrixSELL<T> *matrix);
+
+// Function to convert a SparseMatrixCSR into a SparseMatrixCSC
+template <typename T>
+SparseMatrixCSC<T>* CSR_to_CSC(SparseMatrixCSR<T> *matrix);
+
+// Function to convert a SparseMatrixCSC into a SparseMatrixCSR
+template <typename T>
+SparseMatrixCSR<T>* CSC_to_CSR(SparseMatrixCSC<T> *matrix);
+
+// Function to convert a SparseMatrixCSR into a SparseMatrixDynamic (e.g. to update it for a while)
+template <typename T>
+SparseMatrixDynamic<T>* CSR_to_Dynamic(SparseMatrixCSR<T> *matrix);
+
+// Function to convert a (symmetric) SparseMatrixCSR into a SparseMatrixSymmetric (the lower triangle is dropped)
+template <typename T>
+SparseMatrixSymmetric<T>* CSR_to_Symmetric(SparseMatrixCSR<T> *matrix);
+
+// Function to convert a SparseMatrixSymmetric into a SparseMatrixCSR (with both triangles)
 template <typename T>
-SparseMatrixCOO<T>* CSR_to_COO(SparseMatrixCSR<T> *matrix);
+SparseMatrixCSR<T>* Symmetric_to_CSR(SparseMatrixSymmetric<T> *matrix);
+
+// Function to convert a SparseMatrixCSR into a SparseMatrixMixed with values stored as S (e.g. CSR_to_Mixed<float>)
+template <typename S, typename T>
+SparseMatrixMixed<T,S>* CSR_to_Mixed(SparseMatrixCSR<T> *matrix);
+
+// Function to convert a SparseMatrixMixed into a (full precision) SparseMatrixCSR
+template <typename T, typename S>
+SparseMatrixCSR<T>* Mixed_to_CSR(SparseMatrixMixed<T,S> *matrix);
+
+// Function to compare a mixed precision matrix with the full precision one it was built from (values and product A*x)
+template <typename T, typename S>
+PrecisionReport precision_report(const SparseMatrixCSR<T> &full, const SparseMatrixMixed<T,S> &mixed,
+                                 const std::vector<T> &x);
+
+// Function to convert a SparseMatrixCSR into a SparseMatrixTiled (tile_width=0 means auto-tuned)
+template <typename T>
+SparseMatrixTiled<T>* CSR_to_Tiled(SparseMatrixCSR<T> *matrix, const unsigned int tile_width=0);
+
+// Function to convert a SparseMatrixTiled into a SparseMatrixCSR
+template <typename T>
+SparseMatrixCSR<T>* Tiled_to_CSR(SparseMatrixTiled<T> *matrix);
+
+// Function to convert a SparseMatrixCSR into a SparseMatrixHYB (ell_width=0 means chosen from the row lengths)
+template <typename T>
+SparseMatrixHYB<T>* CSR_to_HYB(SparseMatrixCSR<T> *matrix, const unsigned int ell_width=0);
+
+// Function to convert a SparseMatrixHYB into a SparseMatrixCSR
+template <typename T>
+SparseMatrixCSR<T>* HYB_to_CSR(SparseMatrixHYB<T> *matrix);
+
+// Function to detect the largest square block size for which a SparseMatrixCSR is made of (almost) dense blocks
+// (if density is not null, the nonzeros over the stored elements of those blocks are written there, 1 for size 1)
+template <typename T>
+unsigned int detect_block_size(const SparseMatrixCSR<T> &matrix, const double max_fill=1.0, double *density=nullptr);
+
+// Function to convert a SparseMatrixCSR into a SparseMatrixBSR with RxC blocks
+template <unsigned int R, unsigned int C, typename T>
+SparseMatrixBSR<T,R,C>* CSR_to_BSR(SparseMatrixCSR<T> *matrix);
+
+// Function to convert a SparseMatrixBSR into a SparseMatrixCSR (the explicit zeros inside the blocks are dropped)
+template <typename T, unsigned int R, unsigned int C>
+SparseMatrixCSR<T>* BSR_to_CSR(SparseMatrixBSR<T,R,C> *matrix);
 //---------------------------------------------------------------------------------------------------------------------
 //Link to the definition file
 #include "SparseMatrix.tpl.hpp"
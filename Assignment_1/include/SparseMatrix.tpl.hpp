@@ -11,60 +11,119 @@ void print_vector(std::vector<T> v){
 //---------------------------------------------------------------------------------------------------------------------
 // (1) SparseMatrix definitions
 // SparseMatrix default constructor
-template <typename T>
-SparseMatrix<T>::SparseMatrix(const unsigned int &nr,
+template <typename T, typename I>
+SparseMatrix<T,I>::SparseMatrix(const unsigned int &nr,
                               const unsigned int &nc,
                               const std::vector<T> &d,
-                              const std::vector<unsigned int> &c):n_rows(nr), n_cols(nc),values(d),cols(c) {};
+                              const std::vector<I> &c):n_rows(nr), n_cols(nc),values(d),cols(c) {};
 
 // SparseMatrix copy constructor
-template <typename T>
-SparseMatrix<T>::SparseMatrix(const SparseMatrix<T> &other):
-    n_rows(other.n_rows), n_cols(other.n_cols), values(other.values), cols(other.cols) {};
+template <typename T, typename I>
+SparseMatrix<T,I>::SparseMatrix(const SparseMatrix<T,I> &other):
+    n_rows(other.n_rows), n_cols(other.n_cols), values(other.values), cols(other.cols), n_threads(other.n_threads) {};
 
 // SparseMatrix assignment operator
-template <typename T>
-SparseMatrix<T> & SparseMatrix<T>::operator =(const SparseMatrix<T> &other){
+template <typename T, typename I>
+SparseMatrix<T,I> & SparseMatrix<T,I>::operator =(const SparseMatrix<T,I> &other){
     if(this != &other){
         n_rows= other.n_rows;
         n_cols= other.n_cols;
         values= other.values;
         cols = other.cols;
+        n_threads= other.n_threads;
         return (*this);
     }
     return (*this);
 }
+
+// SparseMatrix operator for matrix-vector product
+template <typename T, typename I>
+std::vector<T> SparseMatrix<T,I>::operator*(const std::vector<T> &vec)const{
+    // Check if matrix and vector dimensions are consistent 
+    assert(vec.size()==n_cols);
+    // Result vector of length=n_rows (with beta=0 its content is never read, it is just overwritten)
+    std::vector<T> result(n_rows);
+    multiply_add(T(1), vec.data(), T(0), result.data());
+    return result;
+}
+
+// SparseMatrix method for in-place matrix-vector product
+template <typename T, typename I>
+void SparseMatrix<T,I>::multiply(const T alpha, const std::vector<T> &x, const T beta, std::vector<T> &y)const{
+    // Check if matrix and vectors dimensions are consistent (and that x is not overwritten while it is read)
+    assert(x.size()==n_cols && y.size()==n_rows && &x!=&y);
+    multiply_add(alpha, x.data(), beta, y.data());
+}
+
+// SparseMatrix method for in-place transposed matrix-vector product
+template <typename T, typename I>
+void SparseMatrix<T,I>::multiply_transposed(const T alpha, const std::vector<T> &x, const T beta, std::vector<T> &y)const{
+    // Check if matrix and vectors dimensions are consistent (and that x is not overwritten while it is read)
+    assert(x.size()==n_rows && y.size()==n_cols && &x!=&y);
+    multiply_add_transposed(alpha, x.data(), beta, y.data());
+}
 //---------------------------------------------------------------------------------------------------------------------
 // (2) SparseMatrixCOO definitions
 // SparseMatrixCOO default constructor
-template <typename T>
-SparseMatrixCOO<T>::SparseMatrixCOO(const unsigned int &nr,
-                                    const unsigned int &nc,
-                                    const std::vector<T> &d,
-                                    const std::vector<unsigned int> &c,
-                                    const std::vector<unsigned int> &r) : SparseMatrix<T>(nr, nc, d, c), rows(r) {};
+template <typename T, typename I, typename P>
+SparseMatrixCOO<T,I,P>::SparseMatrixCOO(const unsigned int &nr,
+                                        const unsigned int &nc,
+                                        const std::vector<T> &d,
+                                        const std::vector<I> &c,
+                                        const std::vector<I> &r) :
+    SparseFormat<SparseMatrixCOO<T,I,P>, T, I>(nr, nc, d, c), rows(r) {
+    // Check that the index types can hold the indices of the matrix
+    assert(nr==0 || nr-1<=std::numeric_limits<I>::max());
+    assert(nc==0 || nc-1<=std::numeric_limits<I>::max());
+    assert(d.size()<=std::numeric_limits<P>::max());
+};
 
 // SparseMatrixCOO copy constructor
-template <typename T>
-SparseMatrixCOO<T>::SparseMatrixCOO(const SparseMatrixCOO<T> &other)
-    :SparseMatrix<T>(other), rows(other.rows){};
+template <typename T, typename I, typename P>
+SparseMatrixCOO<T,I,P>::SparseMatrixCOO(const SparseMatrixCOO<T,I,P> &other)
+    :SparseFormat<SparseMatrixCOO<T,I,P>, T, I>(other), rows(other.rows), index_keys(other.index_keys),
+    index_pos(other.index_pos), index_duplicates(other.index_duplicates){};
 
 // SparseMatrixCOO assignment operator
-template <typename T>
-SparseMatrixCOO<T> & SparseMatrixCOO<T>::operator =(const SparseMatrixCOO<T> &other){
+template <typename T, typename I, typename P>
+SparseMatrixCOO<T,I,P> & SparseMatrixCOO<T,I,P>::operator =(const SparseMatrixCOO<T,I,P> &other){
     if(this != &other){
         this->n_rows= other.n_rows;
         this->n_cols= other.n_cols;
         this->values= other.values;
         this->rows= other.rows;
         this->cols= other.cols;
+        this->n_threads= other.n_threads;
+        this->index_keys= other.index_keys;
+        this->index_pos= other.index_pos;
+        this->index_duplicates= other.index_duplicates;
         return (*this);
     }
     return (*this);
 }   
+// Method to build or drop the hash index of a SparseMatrixCOO
+template <typename T, typename I, typename P>
+void SparseMatrixCOO<T,I,P>::set_indexed(const bool &flag){
+    if(!flag){
+        // Without the index, element access goes back to the linear search
+        index_keys.clear();
+        index_pos.clear();
+        index_keys.shrink_to_fit();
+        index_pos.shrink_to_fit();
+        index_duplicates = 0;
+        return;
+    }
+    // Number of slots: a power of 2 with a load factor of at most 1/2 (so probe sequences stay short)
+    std::size_t n_slots = 16;
+    while(n_slots < 2*this->values.size()){
+        n_slots *= 2;
+    }
+    rebuildIndex(n_slots);
+}
+
 // Method to print information about a SparseMatrixCOO
-template <typename T>
-void SparseMatrixCOO<T>::get_info()const{
+template <typename T, typename I, typename P>
+void SparseMatrixCOO<T,I,P>::get_info()const{
     std::cout<<std::endl;
     std::cout<<"Number of nonzero elements: "<< this->get_nzeros()<<std::endl;
 
@@ -72,16 +131,16 @@ void SparseMatrixCOO<T>::get_info()const{
     print_vector<T>(this->values); 
 
     std::cout<<"Columns: ";
-    print_vector<unsigned int>(this->cols);
+    print_vector<I>(this->cols);
 
     std::cout<<"Rows: ";
-    print_vector<unsigned int>(this->rows);  
+    print_vector<I>(this->rows);  
 }
 
 // Method to print a SparseMatrixCOO
 /* If either rows or columns are >10, we decided to print just the sparse values!*/  
-template <typename T>                 
-void SparseMatrixCOO<T>::print(){
+template <typename T, typename I, typename P>
+void SparseMatrixCOO<T,I,P>::print(){
     std::cout<<std::endl;
     // First we check matrix dimensions 
     // Case 1: both dimensions are <= 10 (we print the whole matrix)
@@ -99,7 +158,7 @@ void SparseMatrixCOO<T>::print(){
     else{
         std::cout<<"Matrix too large: only sparse values will be printed!"<<std::endl;
         // We just need to iterate over the values vector
-        for (unsigned int i=0; i<this->get_nzeros(); i++){
+        for (P i=0; i<this->get_nzeros(); i++){
             std::cout<<"["<< rows[i]<< ","<< this->cols[i]<<"] = "<< this->values[i]<<std::endl;
             
         }
@@ -107,52 +166,65 @@ void SparseMatrixCOO<T>::print(){
     }
 }
 
-// Operator for COO matrix-vector product
-template <typename T>
-const std::vector<T> SparseMatrixCOO<T>::operator*(const std::vector<T> &vec) const{
-    // Check if matrix and vector dimensions are consistent 
-    assert(vec.size()==this->n_cols);
-    // Result vector of length=n_rows (initialized with zeros)
-    std::vector<T> result(this->n_rows, 0);
+// Method for COO in-place matrix-vector product
+template <typename T, typename I, typename P>
+void SparseMatrixCOO<T,I,P>::multiply_add(const T alpha, const T *x, const T beta, T *y) const{
+    // Nonzeros are accumulated one by one into y, so first we scale it by beta
+    scale_vector(y, this->n_rows, beta);
     // This is a simplified version of the classic matrix-vector product which consider just nonzero values!
-    for (unsigned int i=0; i<this->values.size(); i++){
-        result[rows[i]] += this->values[i] * vec[this->cols[i]];
-    }
-    return result;
+    // (the loop is in "simd.hpp")
+    coo_multiply(this->values.data(), this->cols.data(), rows.data(), this->get_nzeros(), alpha, x, y);
+}
+
+// Method for COO in-place transposed matrix-vector product
+template <typename T, typename I, typename P>
+void SparseMatrixCOO<T,I,P>::multiply_add_transposed(const T alpha, const T *x, const T beta, T *y) const{
+    // The element (i,j) of A is the element (j,i) of A^T: we just swap the roles of rows and cols
+    scale_vector(y, this->n_cols, beta);
+    coo_multiply(this->values.data(), rows.data(), this->cols.data(), this->get_nzeros(), alpha, x, y);
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 // (3) SparseMatrixCSR definitions
 // SparseMatrixCSR class constructor
-template <typename T>
-SparseMatrixCSR<T>::SparseMatrixCSR(const unsigned int &nr,
-                                    const unsigned int &nc,
-                                    const std::vector<T> &d,
-                                    const std::vector<unsigned int> &c,
-                                    const std::vector<unsigned int> &r) : SparseMatrix<T>(nr, nc, d, c), rows_idx(r) {};
+template <typename T, typename I, typename P>
+SparseMatrixCSR<T,I,P>::SparseMatrixCSR(const unsigned int &nr,
+                                        const unsigned int &nc,
+                                        const std::vector<T> &d,
+                                        const std::vector<I> &c,
+                                        const std::vector<P> &r) :
+    SparseFormat<SparseMatrixCSR<T,I,P>, T, I>(nr, nc, d, c), rows_idx(r) {
+    // Check that the vectors are consistent, then make sure that the columns of each row are sorted
+    assert(!rows_idx.empty() && rows_idx.back()==this->values.size() && this->cols.size()==this->values.size());
+    // Check that the index types can hold the columns and the number of nonzeros of the matrix
+    assert(nc==0 || nc-1<=std::numeric_limits<I>::max());
+    assert(d.size()<=std::numeric_limits<P>::max());
+    sortRows();
+};
 
 // SparseMatrixCSR copy constructor
-template <typename T>
-SparseMatrixCSR<T>::SparseMatrixCSR(const SparseMatrixCSR<T> &other)
-    :SparseMatrix<T>(other), rows_idx(other.rows_idx) {};
+template <typename T, typename I, typename P>
+SparseMatrixCSR<T,I,P>::SparseMatrixCSR(const SparseMatrixCSR<T,I,P> &other)
+    :SparseFormat<SparseMatrixCSR<T,I,P>, T, I>(other), rows_idx(other.rows_idx) {};
 
 // SparseMatrixCSR assignment operator
-template <typename T>
-SparseMatrixCSR<T> & SparseMatrixCSR<T>::operator =(const SparseMatrixCSR<T> &other){
+template <typename T, typename I, typename P>
+SparseMatrixCSR<T,I,P> & SparseMatrixCSR<T,I,P>::operator =(const SparseMatrixCSR<T,I,P> &other){
     if(this != &other){
         this->n_rows= other.n_rows;
         this->n_cols= other.n_cols;
         this->values= other.values;
         this->cols= other.cols;
         this->rows_idx= other.rows_idx;
+        this->n_threads= other.n_threads;
         return (*this);
     }
     return (*this);
 }
 
 // Method to print information about a SparseMatrixCSR
-template <typename T>
-void SparseMatrixCSR<T>::get_info() const{
+template <typename T, typename I, typename P>
+void SparseMatrixCSR<T,I,P>::get_info() const{
     std::cout<<std::endl;
     std::cout<<"Number of nonzero elements: "<<this-> get_nzeros()<<std::endl;
 
@@ -160,15 +232,15 @@ void SparseMatrixCSR<T>::get_info() const{
     print_vector<T>(this->values); 
 
     std::cout<<"Columns: ";
-    print_vector<unsigned int>(this->cols);
+    print_vector<I>(this->cols);
 
     std::cout<<"Rows_idx: ";
-    print_vector<unsigned int>(this->rows_idx);  
+    print_vector<P>(this->rows_idx);  
 }
 
 // Method to print a SparseMatrixCSR  
-template <typename T>                
-void SparseMatrixCSR<T>::print(){
+template <typename T, typename I, typename P>
+void SparseMatrixCSR<T,I,P>::print(){
     std::cout<<std::endl;
     // First we check matrix dimensions 
     // Case 1: both dimensions are <= 10 (we print the whole matrix)
@@ -191,7 +263,7 @@ void SparseMatrixCSR<T>::print(){
                     ~col_start will be rows_idx[i];
                     ~col_end will be rows_idx[i + 1];
             Iteration over "selected" columns */
-            for (unsigned int j = this->rows_idx[i]; j < this->rows_idx[i+1]; j++) {
+            for (P j = this->rows_idx[i]; j < this->rows_idx[i+1]; j++) {
                 // Print the value (i,j)
                 std::cout << "[" << i << "," << this->cols[j] << "] = " << this->values[j] << std::endl;
             }
@@ -200,77 +272,1956 @@ void SparseMatrixCSR<T>::print(){
     }
     
 }
-// Operator for CSR matrix-vector product
+// Method for CSR in-place matrix-vector product
+template <typename T, typename I, typename P>
+void SparseMatrixCSR<T,I,P>::multiply_add(const T alpha, const T *x, const T beta, T *y)const {
+    // Serial version: a single block containing all the rows (no allocation at all)
+    if(this->n_threads<=1 || this->n_rows<=1){
+        multiply_rows(0, this->n_rows, alpha, x, beta, y);
+        return;
+    }
+    /* Parallel version: rows are split in blocks with (roughly) the same number of nonzeros,
+       so that a few very dense rows do not end up all in the same thread.
+       Each thread writes a disjoint range of y, so no synchronization is needed and 
+       each entry is accumulated in the same order as in the serial version */
+    run_blocks(nnz_partition(this->rows_idx, this->n_threads), [&](const unsigned int first, const unsigned int last){
+        multiply_rows(first, last, alpha, x, beta, y);
+    });
+}
+
+// Method for CSR in-place transposed matrix-vector product
+template <typename T, typename I, typename P>
+void SparseMatrixCSR<T,I,P>::multiply_add_transposed(const T alpha, const T *x, const T beta, T *y)const {
+    /* The i-th row of A is the i-th column of A^T: we scatter alpha*x[i]*A(i,:) into y, without building
+       the transpose (in parallel each thread scatters a block of rows into its own copy of y) */
+    scatter_product(this->values, this->cols, rows_idx, this->n_cols, this->n_threads, alpha, x, beta, y);
+}
+
+// Method to multiply a SparseMatrixCSR by n_vec vectors at once
+template <typename T, typename I, typename P>
+std::vector<T> SparseMatrixCSR<T,I,P>::multiply_vectors(const std::vector<T> &X, const unsigned int n_vec)const {
+    /* X is the n_cols x n_vec (row-major) matrix whose columns are the vectors: the result is the n_rows x n_vec
+       (row-major) matrix whose columns are the products. Each row of the matrix is read once for all the vectors */
+    // Check if matrix and vectors dimensions are consistent 
+    assert(n_vec>0 && X.size()==(size_t)this->n_cols*n_vec);
+    // (beta=0, so the result does not need to be initialized by the kernel)
+    std::vector<T> result((size_t)this->n_rows*n_vec);
+    multiply_vectors(T(1), X.data(), T(0), result.data(), n_vec);
+    return result;
+}
+
+// Method for CSR in-place product by n_vec vectors at once
+template <typename T, typename I, typename P>
+void SparseMatrixCSR<T,I,P>::multiply_vectors(const T alpha, const std::vector<T> &X, const T beta,
+                                              std::vector<T> &Y, const unsigned int n_vec)const {
+    // Check if matrix and vectors dimensions are consistent (and that Y is not X)
+    assert(n_vec>0 && X.size()==(size_t)this->n_cols*n_vec && Y.size()==(size_t)this->n_rows*n_vec && &X!=&Y);
+    multiply_vectors(alpha, X.data(), beta, Y.data(), n_vec);
+}
+
+// Method for CSR in-place product by n_vec vectors at once (raw buffers)
+template <typename T, typename I, typename P>
+void SparseMatrixCSR<T,I,P>::multiply_vectors(const T alpha, const T *X, const T beta, T *Y,
+                                              const unsigned int n_vec)const {
+    // The loop is in "simd.hpp" (the n_vec columns are processed by SIMD lanes for double and float)
+    if(this->n_threads<=1 || this->n_rows<=1){
+        csr_multiply_vectors(this->values.data(), this->cols.data(), rows_idx.data(), 0, this->n_rows, n_vec,
+                             alpha, X, beta, Y);
+        return;
+    }
+    // Parallel version: rows are split in blocks with (roughly) the same number of nonzeros
+    run_blocks(nnz_partition(rows_idx, this->n_threads), [&](const unsigned int first, const unsigned int last){
+        csr_multiply_vectors(this->values.data(), this->cols.data(), rows_idx.data(), first, last, n_vec,
+                             alpha, X, beta, Y);
+    });
+}
+
+// Accumulator used by the CSR matrix-matrix product to merge the (scaled) rows of the second matrix
+/* It keeps the (column, value) pairs of the current row of the result. To find the pair of a column we use
+   a dense array of positions (one per column) for rows with a lot of products, and a small hash table
+   (open addressing, sized on the number of products) for the others, so that short rows of very wide
+   matrices do not need to touch (or clean) an array as large as the number of columns */
 template <typename T>
-const std::vector<T> SparseMatrixCSR<T>::operator*(const std::vector<T> &vec)const {
-    // Check if matrix and vector dimensions are consistent 
-    assert(vec.size()==this->n_cols);
-    // Result vector of length=n_rows (initialized with zeros)
-    std::vector<T> result(this->n_rows, 0.0);    
-    /*This is a simplified version of the classic matrix-vector product which consider just nonzero values!
-      As seen in print function, to get nonzero values coordinates we just need to:
-        - iterate over rows;
-        - for each row, consider the column "range" [ rows_idx[i] , rows_idx[i+1] ] */
-    for(unsigned int i=0; i<this->n_rows; i++){
-        for (unsigned int j=this->rows_idx[i]; j<this->rows_idx[i+1]; j++){
-            int col_idx= this->cols[j];
-            result[i] += this->values[j] * vec[col_idx];
+class RowAccumulator{
+public:
+    RowAccumulator(const unsigned int nc): n_cols(nc) {}
+    // Method to prepare the accumulator for a new row with (at most) n_products products
+    void reset(const unsigned long long n_products){
+        entries.clear();
+        use_dense = (n_products*16 >= n_cols);
+        if(use_dense){
+            // The dense array is allocated just once (and cleaned by flush)
+            if(dense_pos.empty()){
+                dense_pos.assign(n_cols, EMPTY);
+            }
+        }
+        else{
+            unsigned int size=16;
+            hash_shift=28;
+            while(size < 2*n_products){
+                size*=2;
+                hash_shift--;
+            }
+            hash_keys.assign(size, EMPTY);
+            hash_pos.resize(size);
+        }
+    }
+    // Method to add value to the entry of column col
+    void add(const unsigned int col, const T value){
+        unsigned int &pos = use_dense ? dense_pos[col] : hash_find(col);
+        if(pos==EMPTY){
+            pos = entries.size();
+            entries.emplace_back(col, value);
+        }
+        else{
+            entries[pos].second += value;
+        }
+    }
+    // Method to get the number of (distinct) columns of the current row
+    unsigned int size()const{return entries.size();}
+    // Method to write the entries of the current row (sorted by column) and to clean the accumulator
+    template <typename I>
+    void flush(I *cols, T *values){
+        std::sort(entries.begin(), entries.end(),
+                  [](const std::pair<unsigned int,T> &a, const std::pair<unsigned int,T> &b){return a.first<b.first;});
+        for(unsigned int k=0; k<entries.size(); k++){
+            cols[k] = entries[k].first;
+            values[k] = entries[k].second;
+        }
+        clear();
+    }
+    // Method to clean the accumulator (without writing anything)
+    void clear(){
+        if(use_dense){
+            for(const std::pair<unsigned int,T> &e : entries){
+                dense_pos[e.first] = EMPTY;
+            }
         }
+        entries.clear();
     }
+private:
+    // Helper function to find the slot of column col in the hash table (linear probing)
+    /* (Fibonacci hashing: the slot is given by the high bits of the product, since its low bits only depend on the
+        low bits of col, and columns with the same low bits, e.g. multiples of 64, would all get the same slot) */
+    unsigned int &hash_find(const unsigned int col){
+        unsigned int mask = hash_keys.size()-1;
+        unsigned int h = (col*2654435761u) >> hash_shift;
+        while(hash_keys[h]!=EMPTY && hash_keys[h]!=col){
+            h = (h+1) & mask;
+        }
+        if(hash_keys[h]==EMPTY){
+            hash_keys[h] = col;
+            hash_pos[h] = EMPTY;
+        }
+        return hash_pos[h];
+    }
+
+    static constexpr unsigned int EMPTY = UINT_MAX;
+    unsigned int n_cols;
+    bool use_dense = false;
+    unsigned int hash_shift = 28;                     // 32 - log2 of the size of the hash table
+    std::vector<std::pair<unsigned int,T>> entries;   // (column, value) pairs of the current row
+    std::vector<unsigned int> dense_pos;              // position in entries of each column (dense version)
+    std::vector<unsigned int> hash_keys;              // columns in the hash table
+    std::vector<unsigned int> hash_pos;               // position in entries of each column in the hash table
+};
+
+// Operator for CSR matrix-matrix product (SpGEMM)
+template <typename T, typename I, typename P>
+SparseMatrixCSR<T,I,P> SparseMatrixCSR<T,I,P>::operator*(const SparseMatrixCSR<T,I,P> &other)const {
+    // Check if matrices dimensions are consistent 
+    assert(this->n_cols==other.n_rows);
+    /* Row-wise (Gustavson) algorithm: the i-th row of the result is the sum of the rows k of other,
+       scaled by the nonzeros (i,k) of this matrix. We proceed in two passes:
+        1) symbolic: we count the nonzeros of each row of the result, so rows_idx (and then values and cols)
+           can be allocated with their exact size;
+        2) numeric: we compute the values and we write each row (sorted by column) in its final position.
+       Rows are split among threads with (roughly) the same number of products, each thread with its own accumulator */
+    const unsigned int n_rows = this->n_rows;
+    // Number of products of each row (cumulative, to be used as the work of each row)
+    std::vector<unsigned long long> products(n_rows+1, 0);
+    for(unsigned int i=0; i<n_rows; i++){
+        products[i+1] = products[i];
+        for(P k=rows_idx[i]; k<rows_idx[i+1]; k++){
+            products[i+1] += other.rows_idx[this->cols[k]+1] - other.rows_idx[this->cols[k]];
+        }
+    }
+    const unsigned int n_threads = std::max(1u, std::min(this->n_threads, n_rows));
+    std::vector<unsigned int> bounds = nnz_partition(products, n_threads);
+    // Helper lambda to run a pass on each block of rows (in parallel if we have more than one thread)
+    auto run = [&](auto pass){
+        if(n_threads==1){
+            pass(0, n_rows);
+            return;
+        }
+        std::vector<std::thread> workers;
+        for(unsigned int t=0; t<n_threads; t++){
+            if(bounds[t]<bounds[t+1]){
+                workers.emplace_back(pass, bounds[t], bounds[t+1]);
+            }
+        }
+        for(std::thread &w : workers){
+            w.join();
+        }
+    };
+    // Helper lambda to accumulate the i-th row of the result (in the symbolic pass values are not computed)
+    auto accumulate_row = [&](RowAccumulator<T> &acc, const unsigned int i, const bool symbolic){
+        acc.reset(products[i+1]-products[i]);
+        for(P k=rows_idx[i]; k<rows_idx[i+1]; k++){
+            const unsigned int row = this->cols[k];
+            for(P l=other.rows_idx[row]; l<other.rows_idx[row+1]; l++){
+                acc.add(other.cols[l], symbolic ? T(0) : this->values[k]*other.values[l]);
+            }
+        }
+    };
+
+    // (1) Symbolic pass (new_rows_idx[i+1] is the number of nonzeros of the i-th row)
+    std::vector<P> new_rows_idx(n_rows+1, 0);
+    run([&](const unsigned int first, const unsigned int last){
+        RowAccumulator<T> acc(other.n_cols);
+        for(unsigned int i=first; i<last; i++){
+            accumulate_row(acc, i, true);
+            new_rows_idx[i+1] = acc.size();
+            acc.clear();
+        }
+    });
+    unsigned long long total=0;
+    for(unsigned int i=0; i<n_rows; i++){
+        total += new_rows_idx[i+1];
+        new_rows_idx[i+1] = new_rows_idx[i] + new_rows_idx[i+1];
+    }
+    // rows_idx must be representable with the row pointer type
+    assert(total<=std::numeric_limits<P>::max());
+
+    // (2) Numeric pass (each row is written directly in its final position)
+    std::vector<I> new_cols(total);
+    std::vector<T> new_values(total);
+    run([&](const unsigned int first, const unsigned int last){
+        RowAccumulator<T> acc(other.n_cols);
+        for(unsigned int i=first; i<last; i++){
+            accumulate_row(acc, i, false);
+            acc.flush(new_cols.data()+new_rows_idx[i], new_values.data()+new_rows_idx[i]);
+        }
+    });
+
+    SparseMatrixCSR<T,I,P> result{n_rows, other.n_cols, new_values, new_cols, new_rows_idx};
+    result.set_threads(this->n_threads);
     return result;
 }
+
 //---------------------------------------------------------------------------------------------------------------------
-// Functions for conversions
+// (4) SparseMatrixSELL definitions
+// SparseMatrixSELL class constructor (from the CSR vectors of the matrix)
 template <typename T>
-SparseMatrixCSR<T>* COO_to_CSR(SparseMatrixCOO<T> *matrix){
-    // Vectors attributes for the new matrix
-    std::vector<unsigned int> new_cols;
-    std::vector<T> new_values;
-    std::vector<unsigned int> rows_idx;
-    // CONVENTION: first element of rows_idx is always 0
-    rows_idx.push_back(0);
-    // Counter for the cumulative number of nonzero elements
-    unsigned int counter=0;
-    // Iteration over rows of the COO matrix
-    for(unsigned int row=0; row < matrix->get_nrows(); row++) {
-        // Iteration over nonzero values of the COO matrix
-        for (unsigned int i = 0; i < matrix->get_nzeros(); i++) {
-            // If the row of the current nonzero is equal to the current row (of the external loop)
-            if (matrix->get_rows()[i] == row){
-                new_cols.push_back(matrix->get_cols()[i]);
-                new_values.push_back(matrix->get_values()[i]);
-                counter++;
+SparseMatrixSELL<T>::SparseMatrixSELL(const unsigned int &nr,
+                                      const unsigned int &nc,
+                                      const std::vector<T> &d,
+                                      const std::vector<unsigned int> &c,
+                                      const std::vector<unsigned int> &r,
+                                      const unsigned int &chunk,
+                                      const unsigned int &window) :
+    SparseFormat<SparseMatrixSELL<T>, T>(nr, nc, std::vector<T>{}, std::vector<unsigned int>{}),
+    chunk_size(chunk), sigma(window), nnz(d.size()) {
+    // Check if the input is consistent
+    assert(chunk>0 && window>0 && r.size()==nr+1 && r[nr]==d.size() && c.size()==d.size());
+    // (1) Sort the rows by decreasing length inside each window of sigma rows
+    perm.resize(nr);
+    for(unsigned int i=0; i<nr; i++){
+        perm[i]=i;
+    }
+    for(unsigned int w=0; w<nr; w+=sigma){
+        std::stable_sort(perm.begin()+w, perm.begin()+std::min(w+sigma, nr),
+                         [&r](unsigned int a, unsigned int b){return r[a+1]-r[a] > r[b+1]-r[b];});
+    }
+    perm_inv.resize(nr);
+    for(unsigned int p=0; p<nr; p++){
+        perm_inv[perm[p]]=p;
+    }
+    // (2) Group the sorted rows in chunks of C rows (the last chunk may contain "empty" rows, of length 0)
+    unsigned int n_chunks = (nr+chunk_size-1)/chunk_size;
+    rows_len.assign(n_chunks*chunk_size, 0);
+    chunks_len.assign(n_chunks, 0);
+    chunks_idx.assign(n_chunks+1, 0);
+    for(unsigned int p=0; p<nr; p++){
+        rows_len[p] = r[perm[p]+1]-r[perm[p]];
+        chunks_len[p/chunk_size] = std::max(chunks_len[p/chunk_size], rows_len[p]);
+    }
+    for(unsigned int k=0; k<n_chunks; k++){
+        chunks_idx[k+1] = chunks_idx[k] + chunks_len[k]*chunk_size;
+    }
+    // (3) Fill each chunk column-major: the s-th element of the row in position p is at chunks_idx[k]+s*C+lane
+    /* Padding elements are zeros: as column we repeat the last column of the row, so that they do not
+       load new entries of the vector in the product */
+    this->values.assign(chunks_idx[n_chunks], 0);
+    this->cols.assign(chunks_idx[n_chunks], 0);
+    for(unsigned int p=0; p<nr; p++){
+        unsigned int k=p/chunk_size, lane=p%chunk_size;
+        unsigned int last_col=0;
+        for(unsigned int s=0; s<chunks_len[k]; s++){
+            unsigned int index = chunks_idx[k]+s*chunk_size+lane;
+            if(s<rows_len[p]){
+                this->values[index] = d[r[perm[p]]+s];
+                last_col = c[r[perm[p]]+s];
             }
+            this->cols[index] = last_col;
         }
-        rows_idx.push_back(counter);
     }
+}
 
-    // Now we can define the CSR version of the input matrix
-    SparseMatrixCSR<T>* converted_matrix = new SparseMatrixCSR<T>{matrix->get_nrows(), matrix->get_ncols(), new_values, new_cols, rows_idx};
-    /* Before returning the converted matrix(CSR), it makes sense to delete the initial COO version 
-       Since we passed the input as a pointer, we can easily deallocate it with "delete" */
-    delete matrix;
-    return converted_matrix;
+// SparseMatrixSELL copy constructor
+template <typename T>
+SparseMatrixSELL<T>::SparseMatrixSELL(const SparseMatrixSELL<T> &other)
+    :SparseFormat<SparseMatrixSELL<T>, T>(other), chunk_size(other.chunk_size), sigma(other.sigma), nnz(other.nnz),
+     chunks_idx(other.chunks_idx), chunks_len(other.chunks_len), rows_len(other.rows_len),
+     perm(other.perm), perm_inv(other.perm_inv) {};
+
+// SparseMatrixSELL assignment operator
+template <typename T>
+SparseMatrixSELL<T> & SparseMatrixSELL<T>::operator =(const SparseMatrixSELL<T> &other){
+    if(this != &other){
+        this->n_rows= other.n_rows;
+        this->n_cols= other.n_cols;
+        this->values= other.values;
+        this->cols= other.cols;
+        this->n_threads= other.n_threads;
+        chunk_size= other.chunk_size;
+        sigma= other.sigma;
+        nnz= other.nnz;
+        chunks_idx= other.chunks_idx;
+        chunks_len= other.chunks_len;
+        rows_len= other.rows_len;
+        perm= other.perm;
+        perm_inv= other.perm_inv;
+        return (*this);
+    }
+    return (*this);
 }
 
+// Method to print information about a SparseMatrixSELL
 template <typename T>
-SparseMatrixCOO<T>* CSR_to_COO(SparseMatrixCSR<T> *matrix){
-    // Vectors attributes for the new matrix
-    std::vector<unsigned int> cols=matrix->get_cols();
-    std::vector<T> values=matrix->get_values();
-    std::vector<unsigned int> rows;
-    // For each row of the matrix
-    for(unsigned i=0; i < matrix->get_nrows();i++){
-        /* matrix->get_rows_idx()[i+1]-matrix->get_rows_idx()[i] is the number of non-zero elements in the i-th row,
-           so we repeat its index in the rows vector such number of times */
-        for(unsigned int rep=1;rep<=matrix->get_rows_idx()[i+1]-matrix->get_rows_idx()[i];rep++){
-            rows.push_back(i);
+void SparseMatrixSELL<T>::get_info() const{
+    std::cout<<std::endl;
+    std::cout<<"Number of nonzero elements: "<<this->get_nzeros()<<std::endl;
+    std::cout<<"Chunk size (C): "<<chunk_size<<", sorting window (sigma): "<<sigma<<std::endl;
+
+    std::cout<<"Values (with padding): ";
+    print_vector<T>(this->values);
+
+    std::cout<<"Columns (with padding): ";
+    print_vector<unsigned int>(this->cols);
+
+    std::cout<<"Chunks_idx: ";
+    print_vector<unsigned int>(chunks_idx);
+
+    std::cout<<"Chunks_len: ";
+    print_vector<unsigned int>(chunks_len);
+
+    std::cout<<"Rows permutation: ";
+    print_vector<unsigned int>(perm);
+}
+
+// Method to print a SparseMatrixSELL
+template <typename T>
+void SparseMatrixSELL<T>::print(){
+    std::cout<<std::endl;
+    // First we check matrix dimensions 
+    // Case 1: both dimensions are <= 10 (we print the whole matrix)
+    if(this->n_rows<=10 && this->n_cols<=10){
+        // We can simply iterate over rows and columns and use the access operator for each (i,j) entry
+        for (unsigned int i = 0; i < this->n_rows; i++) {
+            std::cout<< "|  ";
+            for (unsigned int j = 0; j < this->n_cols; j++) {
+                std::cout<<(*this)(i,j)<< "  ";
+            }
+            std::cout<< "|" <<std::endl;
         }
     }
-    
-    // Now we can define the COO version of the input matrix
-    SparseMatrixCOO<T>* converted_matrix = new SparseMatrixCOO<T>{matrix->get_nrows(), matrix->get_ncols(), values, cols, rows};
-    /* Before returning the converted matrix(COO), it makes sense to delete the initial CSR version 
+    // Case 2: at least one dimension exceeds 10 (we print just the sparse values)
+    else{
+        std::cout<<"Matrix too large: only sparse values will be printed!"<<std::endl;
+        // For each (original) row we look for its sorted position and we skip the padding
+        for(unsigned int i = 0; i < this->n_rows; i++) {
+            unsigned int p=perm_inv[i];
+            for (unsigned int s = 0; s < rows_len[p]; s++) {
+                unsigned int index = chunks_idx[p/chunk_size]+s*chunk_size+p%chunk_size;
+                std::cout << "[" << i << "," << this->cols[index] << "] = " << this->values[index] << std::endl;
+            }
+        }
+        std::cout<<std::endl;
+    }
+}
+
+// Method for SELL in-place matrix-vector product
+template <typename T>
+void SparseMatrixSELL<T>::multiply_add(const T alpha, const T *x, const T beta, T *y)const {
+    /* The loop over the chunks is in "simd.hpp": the C rows of each chunk are processed together
+       (by SIMD lanes for double and float) and the results are written back in the original row order */
+    const unsigned int n_chunks = chunks_len.size();
+    if(this->n_threads<=1 || n_chunks<=1){
+        sell_multiply_chunks(this->values.data(), this->cols.data(), chunks_idx.data(), chunks_len.data(), perm.data(),
+                             chunk_size, this->n_rows, 0, n_chunks, this->n_cols, alpha, x, beta, y);
+        return;
+    }
+    // Parallel version: chunks_idx is cumulative (like rows_idx), so we can split chunks with the same amount of work
+    run_blocks(nnz_partition(chunks_idx, this->n_threads), [&](const unsigned int first, const unsigned int last){
+        sell_multiply_chunks(this->values.data(), this->cols.data(), chunks_idx.data(), chunks_len.data(),
+                             perm.data(), chunk_size, this->n_rows, first, last, this->n_cols, alpha, x, beta, y);
+    });
+}
+
+// Method for SELL in-place transposed matrix-vector product
+template <typename T>
+void SparseMatrixSELL<T>::multiply_add_transposed(const T alpha, const T *x, const T beta, T *y)const {
+    // Same scatter as CSR: the s-th element of the row in the sorted position p is at chunks_idx[p/C]+s*C+p%C
+    scale_vector(y, this->n_cols, beta);
+    for(unsigned int p=0; p<this->n_rows; p++){
+        const T xi = alpha*x[perm[p]];
+        const unsigned int first = chunks_idx[p/chunk_size] + p%chunk_size;
+        for(unsigned int s=0; s<rows_len[p]; s++){
+            y[this->cols[first+s*chunk_size]] += this->values[first+s*chunk_size]*xi;
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// (5) SparseMatrixBSR definitions
+// SparseMatrixBSR class constructor
+template <typename T, unsigned int R, unsigned int C>
+SparseMatrixBSR<T,R,C>::SparseMatrixBSR(const unsigned int &nr,
+                                        const unsigned int &nc,
+                                        const std::vector<T> &d,
+                                        const std::vector<unsigned int> &c,
+                                        const std::vector<unsigned int> &r) :
+    SparseFormat<SparseMatrixBSR<T,R,C>, T>(nr, nc, d, c), blocks_idx(r) {
+    // The blocks must cover the matrix exactly (checked also without asserts, since the products would be wrong)
+    if(nr%R!=0 || nc%C!=0){
+        throw std::invalid_argument("SparseMatrixBSR: the dimensions are not multiples of the block size");
+    }
+    // Check if the input is consistent
+    assert(r.size()==nr/R+1 && r[nr/R]==c.size() && d.size()==c.size()*R*C);
+};
+
+// SparseMatrixBSR copy constructor
+template <typename T, unsigned int R, unsigned int C>
+SparseMatrixBSR<T,R,C>::SparseMatrixBSR(const SparseMatrixBSR<T,R,C> &other)
+    :SparseFormat<SparseMatrixBSR<T,R,C>, T>(other), blocks_idx(other.blocks_idx) {};
+
+// SparseMatrixBSR assignment operator
+template <typename T, unsigned int R, unsigned int C>
+SparseMatrixBSR<T,R,C> & SparseMatrixBSR<T,R,C>::operator =(const SparseMatrixBSR<T,R,C> &other){
+    if(this != &other){
+        this->n_rows= other.n_rows;
+        this->n_cols= other.n_cols;
+        this->values= other.values;
+        this->cols= other.cols;
+        this->blocks_idx= other.blocks_idx;
+        this->n_threads= other.n_threads;
+        return (*this);
+    }
+    return (*this);
+}
+
+// Method to get the number of nonzero values of a SparseMatrixBSR
+template <typename T, unsigned int R, unsigned int C>
+unsigned long long SparseMatrixBSR<T,R,C>::get_nzeros() const{
+    // Blocks may contain some zeros, which we do not count
+    return std::count_if(this->values.begin(), this->values.end(), [](const T &v){return v!=T(0);});
+}
+
+// Method to print information about a SparseMatrixBSR
+template <typename T, unsigned int R, unsigned int C>
+void SparseMatrixBSR<T,R,C>::get_info() const{
+    std::cout<<std::endl;
+    std::cout<<"Number of nonzero elements: "<<this->get_nzeros()<<std::endl;
+    std::cout<<"Number of "<<R<<"x"<<C<<" blocks: "<<get_nblocks()<<std::endl;
+
+    std::cout<<"Values (block by block): ";
+    print_vector<T>(this->values);
+
+    std::cout<<"Block columns: ";
+    print_vector<unsigned int>(this->cols);
+
+    std::cout<<"Blocks_idx: ";
+    print_vector<unsigned int>(blocks_idx);
+}
+
+// Method to print a SparseMatrixBSR
+template <typename T, unsigned int R, unsigned int C>
+void SparseMatrixBSR<T,R,C>::print(){
+    std::cout<<std::endl;
+    // First we check matrix dimensions 
+    // Case 1: both dimensions are <= 10 (we print the whole matrix)
+    if(this->n_rows<=10 && this->n_cols<=10){
+        // We can simply iterate over rows and columns and use the access operator for each (i,j) entry
+        for (unsigned int i = 0; i < this->n_rows; i++) {
+            std::cout<< "|  ";
+            for (unsigned int j = 0; j < this->n_cols; j++) {
+                std::cout<<(*this)(i,j)<< "  ";
+            }
+            std::cout<< "|" <<std::endl;
+        }
+    }
+    // Case 2: at least one dimension exceeds 10 (we print just the sparse values)
+    else{
+        std::cout<<"Matrix too large: only sparse values will be printed!"<<std::endl;
+        // For each row of the matrix, we iterate over the blocks of its block row (skipping zeros inside the blocks)
+        for(unsigned int i = 0; i < this->n_rows; i++) {
+            for (unsigned int k = blocks_idx[i/R]; k < blocks_idx[i/R+1]; k++) {
+                for (unsigned int c = 0; c < C; c++) {
+                    T value = this->values[k*R*C+(i%R)*C+c];
+                    if(value!=T(0)){
+                        std::cout << "[" << i << "," << this->cols[k]*C+c << "] = " << value << std::endl;
+                    }
+                }
+            }
+        }
+        std::cout<<std::endl;
+    }
+}
+
+// Method for BSR in-place matrix-vector product
+template <typename T, unsigned int R, unsigned int C>
+void SparseMatrixBSR<T,R,C>::multiply_add(const T alpha, const T *x, const T beta, T *y)const {
+    const unsigned int n_block_rows = this->n_rows/R;
+    // Serial version: a single block containing all the block rows
+    if(this->n_threads<=1 || n_block_rows<=1){
+        multiply_block_rows(0, n_block_rows, alpha, x, beta, y);
+        return;
+    }
+    // Parallel version: blocks_idx is cumulative (like rows_idx), so block rows are split with the same number of blocks
+    run_blocks(nnz_partition(blocks_idx, this->n_threads), [&](const unsigned int first, const unsigned int last){
+        multiply_block_rows(first, last, alpha, x, beta, y);
+    });
+}
+
+// Method for BSR in-place transposed matrix-vector product
+template <typename T, unsigned int R, unsigned int C>
+void SparseMatrixBSR<T,R,C>::multiply_add_transposed(const T alpha, const T *x, const T beta, T *y)const {
+    // Each RxC block (bi, cols[k]) is scattered as its transpose, i.e. y[cols[k]*C + c] += sum_r block[r*C+c]*x[bi*R+r]
+    scale_vector(y, this->n_cols, beta);
+    for(unsigned int bi=0; bi<this->n_rows/R; bi++){
+        T xr[R];
+        for(unsigned int r=0; r<R; r++){
+            xr[r] = alpha*x[bi*R+r];
+        }
+        for(unsigned int k=blocks_idx[bi]; k<blocks_idx[bi+1]; k++){
+            const T *block = this->values.data() + k*R*C;
+            T *yc = y + this->cols[k]*C;
+            #pragma GCC unroll 8
+            for(unsigned int r=0; r<R; r++){
+                #pragma GCC unroll 8
+                for(unsigned int c=0; c<C; c++){
+                    yc[c] += block[r*C+c] * xr[r];
+                }
+            }
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// (6) SparseMatrixCSC definitions
+// SparseMatrixCSC class constructor
+template <typename T>
+SparseMatrixCSC<T>::SparseMatrixCSC(const unsigned int &nr,
+                                    const unsigned int &nc,
+                                    const std::vector<T> &d,
+                                    const std::vector<unsigned int> &r,
+                                    const std::vector<unsigned int> &c) :
+    SparseFormat<SparseMatrixCSC<T>, T>(nr, nc, d, {}), rows(r), cols_idx(c) {
+    // Check that the vectors are consistent (as for the rows_idx of CSR, cols_idx is cumulative)
+    assert(cols_idx.size()==nc+1 && cols_idx.front()==0 && cols_idx.back()==d.size() && rows.size()==d.size());
+    assert(std::is_sorted(cols_idx.begin(), cols_idx.end()));
+};
+
+// SparseMatrixCSC copy constructor
+template <typename T>
+SparseMatrixCSC<T>::SparseMatrixCSC(const SparseMatrixCSC<T> &other)
+    :SparseFormat<SparseMatrixCSC<T>, T>(other), rows(other.rows), cols_idx(other.cols_idx) {};
+
+// SparseMatrixCSC assignment operator
+template <typename T>
+SparseMatrixCSC<T> & SparseMatrixCSC<T>::operator =(const SparseMatrixCSC<T> &other){
+    if(this != &other){
+        this->n_rows= other.n_rows;
+        this->n_cols= other.n_cols;
+        this->values= other.values;
+        this->rows= other.rows;
+        this->cols_idx= other.cols_idx;
+        this->n_threads= other.n_threads;
+        return (*this);
+    }
+    return (*this);
+}
+
+// Method to print information about a SparseMatrixCSC
+template <typename T>
+void SparseMatrixCSC<T>::get_info() const{
+    std::cout<<std::endl;
+    std::cout<<"Number of nonzero elements: "<<this-> get_nzeros()<<std::endl;
+
+    std::cout<<"Nonzero values: ";
+    print_vector<T>(this->values); 
+
+    std::cout<<"Rows: ";
+    print_vector<unsigned int>(rows);
+
+    std::cout<<"Cols_idx: ";
+    print_vector<unsigned int>(cols_idx);
+}
+
+// Method to print a SparseMatrixCSC
+template <typename T>                
+void SparseMatrixCSC<T>::print(){
+    std::cout<<std::endl;
+    // Case 1: both dimensions are <= 10 (we print the whole matrix)
+    if(this->n_rows<=10 && this->n_cols<=10){
+        for (unsigned int i = 0; i < this->n_rows; i++) {
+            std::cout<< "|  ";
+            for (unsigned int j = 0; j < this->n_cols; j++) {
+                std::cout<<(*this)(i,j)<< "  ";
+            }
+            std::cout<< "|" <<std::endl;
+        }
+    }
+    // Case 2: at least one dimension exceeds 10 (we print just the sparse values, column by column)
+    else{
+        std::cout<<"Matrix too large: only sparse values will be printed!"<<std::endl;
+        for(unsigned int j = 0; j < this->n_cols; j++) {
+            for (unsigned int k = cols_idx[j]; k < cols_idx[j+1]; k++) {
+                std::cout << "[" << rows[k] << "," << j << "] = " << this->values[k] << std::endl;
+            }
+        }
+        std::cout<<std::endl;
+    }
+}
+
+// Method for CSC in-place matrix-vector product
+template <typename T>
+void SparseMatrixCSC<T>::multiply_add(const T alpha, const T *x, const T beta, T *y)const {
+    /* The CSC vectors of A are the CSR vectors of A^T, so A*x = (A^T)^T*x is the scatter of the CSR transposed product
+       (the private copies of y are allocated by each product, so a const matrix can be used by many threads at once) */
+    scatter_product(this->values, rows, cols_idx, this->n_rows, this->n_threads, alpha, x, beta, y);
+}
+
+// Method for CSC in-place transposed matrix-vector product
+template <typename T>
+void SparseMatrixCSC<T>::multiply_add_transposed(const T alpha, const T *x, const T beta, T *y)const {
+    /* A^T*x is the CSR product of A^T: each column of A is a row of A^T, so it is computed with the same
+       (vectorized) kernel, and columns are split among threads with (roughly) the same number of nonzeros */
+    if(this->n_threads<=1 || this->n_cols<=1){
+        csr_multiply_rows(this->values.data(), rows.data(), cols_idx.data(), 0, this->n_cols, this->n_rows,
+                          alpha, x, beta, y);
+        return;
+    }
+    run_blocks(nnz_partition(cols_idx, this->n_threads), [&](const unsigned int first, const unsigned int last){
+        csr_multiply_rows(this->values.data(), rows.data(), cols_idx.data(), first, last, this->n_rows,
+                          alpha, x, beta, y);
+    });
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// (7) SparseMatrixDynamic definitions
+// SparseMatrixDynamic class constructor
+template <typename T>
+SparseMatrixDynamic<T>::SparseMatrixDynamic(const unsigned int &nr,
+                                            const unsigned int &nc) :
+    SparseFormat<SparseMatrixDynamic<T>, T>(nr, nc, {}, {}), row_cols(nr), row_values(nr) {};
+
+// SparseMatrixDynamic copy constructor
+template <typename T>
+SparseMatrixDynamic<T>::SparseMatrixDynamic(const SparseMatrixDynamic<T> &other)
+    :SparseFormat<SparseMatrixDynamic<T>, T>(other), row_cols(other.row_cols), row_values(other.row_values),
+    nnz(other.nnz) {};
+
+// SparseMatrixDynamic assignment operator
+template <typename T>
+SparseMatrixDynamic<T> & SparseMatrixDynamic<T>::operator =(const SparseMatrixDynamic<T> &other){
+    if(this != &other){
+        this->n_rows= other.n_rows;
+        this->n_cols= other.n_cols;
+        this->row_cols= other.row_cols;
+        this->row_values= other.row_values;
+        this->nnz= other.nnz;
+        this->n_threads= other.n_threads;
+        return (*this);
+    }
+    return (*this);
+}
+
+// Method to print information about a SparseMatrixDynamic
+template <typename T>
+void SparseMatrixDynamic<T>::get_info() const{
+    std::cout<<std::endl;
+    std::cout<<"Number of nonzero elements: "<<nnz<<std::endl;
+    for(unsigned int i=0; i<this->n_rows && i<10; i++){
+        std::cout<<"Row "<<i<<" columns: ";
+        print_vector<unsigned int>(row_cols[i]);
+        std::cout<<"Row "<<i<<" values: ";
+        print_vector<T>(row_values[i]);
+    }
+}
+
+// Method to print a SparseMatrixDynamic
+template <typename T>
+void SparseMatrixDynamic<T>::print(){
+    std::cout<<std::endl;
+    // Case 1: both dimensions are <= 10 (we print the whole matrix)
+    if(this->n_rows<=10 && this->n_cols<=10){
+        for (unsigned int i = 0; i < this->n_rows; i++) {
+            std::cout<< "|  ";
+            for (unsigned int j = 0; j < this->n_cols; j++) {
+                std::cout<<(*this)(i,j)<< "  ";
+            }
+            std::cout<< "|" <<std::endl;
+        }
+    }
+    // Case 2: at least one dimension exceeds 10 (we print just the sparse values)
+    else{
+        std::cout<<"Matrix too large: only sparse values will be printed!"<<std::endl;
+        for(unsigned int i = 0; i < this->n_rows; i++) {
+            for (unsigned int k = 0; k < row_cols[i].size(); k++) {
+                std::cout << "[" << i << "," << row_cols[i][k] << "] = " << row_values[i][k] << std::endl;
+            }
+        }
+        std::cout<<std::endl;
+    }
+}
+
+// Method to build the compact CSR version of a SparseMatrixDynamic
+template <typename T>
+SparseMatrixCSR<T>* SparseMatrixDynamic<T>::freeze() const{
+    // Rows are already sorted: we just copy them one after the other (O(nnz))
+    std::vector<unsigned int> rows_idx(this->n_rows+1, 0);
+    for(unsigned int i=0; i<this->n_rows; i++){
+        rows_idx[i+1] = rows_idx[i] + row_cols[i].size();
+    }
+    std::vector<T> values;
+    std::vector<unsigned int> cols;
+    values.reserve(nnz);
+    cols.reserve(nnz);
+    for(unsigned int i=0; i<this->n_rows; i++){
+        values.insert(values.end(), row_values[i].begin(), row_values[i].end());
+        cols.insert(cols.end(), row_cols[i].begin(), row_cols[i].end());
+    }
+    SparseMatrixCSR<T>* frozen = new SparseMatrixCSR<T>{this->n_rows, this->n_cols, values, cols, rows_idx};
+    frozen->set_threads(this->n_threads);
+    return frozen;
+}
+
+// Method for SparseMatrixDynamic in-place matrix-vector product
+template <typename T>
+void SparseMatrixDynamic<T>::multiply_add(const T alpha, const T *x, const T beta, T *y)const {
+    // Each row is a short CSR row: we use the same kernel on its vectors (rows_idx of the row is just {0, size})
+    auto multiply_rows = [&](const unsigned int first, const unsigned int last){
+        for(unsigned int i=first; i<last; i++){
+            const unsigned int row_idx[2] = {0, (unsigned int)row_cols[i].size()};
+            csr_multiply_rows(row_values[i].data(), row_cols[i].data(), row_idx, 0, 1, this->n_cols,
+                              alpha, x, beta, y+i);
+        }
+    };
+    if(this->n_threads<=1 || this->n_rows<=1){
+        multiply_rows(0, this->n_rows);
+        return;
+    }
+    // Parallel version: rows split among threads with (roughly) the same number of nonzeros
+    std::vector<unsigned int> rows_idx(this->n_rows+1, 0);
+    for(unsigned int i=0; i<this->n_rows; i++){
+        rows_idx[i+1] = rows_idx[i] + row_cols[i].size();
+    }
+    run_blocks(nnz_partition(rows_idx, this->n_threads), multiply_rows);
+}
+
+// Method for SparseMatrixDynamic in-place transposed matrix-vector product
+template <typename T>
+void SparseMatrixDynamic<T>::multiply_add_transposed(const T alpha, const T *x, const T beta, T *y)const {
+    // Serial scatter of each row (for repeated transposed products, freeze the matrix first)
+    scale_vector(y, this->n_cols, beta);
+    for(unsigned int i=0; i<this->n_rows; i++){
+        const unsigned int row_idx[2] = {0, (unsigned int)row_cols[i].size()};
+        csr_scatter_rows(row_values[i].data(), row_cols[i].data(), row_idx, 0, 1, alpha, x+i, y);
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// (8) SparseMatrixSymmetric definitions
+// SparseMatrixSymmetric class constructor
+template <typename T>
+SparseMatrixSymmetric<T>::SparseMatrixSymmetric(const unsigned int &n,
+                                                const std::vector<T> &d,
+                                                const std::vector<unsigned int> &c,
+                                                const std::vector<unsigned int> &r) :
+    SparseFormat<SparseMatrixSymmetric<T>, T>(n, n, d, c), rows_idx(r) {
+    // Check that the vectors are consistent and that each row only has (sorted) elements of the upper triangle
+    assert(rows_idx.size()==n+1 && rows_idx.back()==this->values.size() && this->cols.size()==this->values.size());
+    for(unsigned int i=0; i<n; i++){
+        for(unsigned int k=rows_idx[i]; k<rows_idx[i+1]; k++){
+            assert(this->cols[k]>=i && this->cols[k]<n && (k==rows_idx[i] || this->cols[k-1]<this->cols[k]));
+        }
+        if(rows_idx[i]<rows_idx[i+1] && this->cols[rows_idx[i]]==i){
+            n_diag++;
+        }
+    }
+};
+
+// SparseMatrixSymmetric copy constructor
+template <typename T>
+SparseMatrixSymmetric<T>::SparseMatrixSymmetric(const SparseMatrixSymmetric<T> &other)
+    :SparseFormat<SparseMatrixSymmetric<T>, T>(other), rows_idx(other.rows_idx), n_diag(other.n_diag) {};
+
+// SparseMatrixSymmetric assignment operator
+template <typename T>
+SparseMatrixSymmetric<T> & SparseMatrixSymmetric<T>::operator =(const SparseMatrixSymmetric<T> &other){
+    if(this != &other){
+        this->n_rows= other.n_rows;
+        this->n_cols= other.n_cols;
+        this->values= other.values;
+        this->cols= other.cols;
+        this->rows_idx= other.rows_idx;
+        this->n_diag= other.n_diag;
+        this->n_threads= other.n_threads;
+        return (*this);
+    }
+    return (*this);
+}
+
+// Method to print information about a SparseMatrixSymmetric
+template <typename T>
+void SparseMatrixSymmetric<T>::get_info() const{
+    std::cout<<std::endl;
+    std::cout<<"Number of nonzero elements: "<<this->get_nzeros()<<" (stored: "<<get_nstored()<<")"<<std::endl;
+
+    std::cout<<"Nonzero values (upper triangle): ";
+    print_vector<T>(this->values); 
+
+    std::cout<<"Columns: ";
+    print_vector<unsigned int>(this->cols);
+
+    std::cout<<"Rows_idx: ";
+    print_vector<unsigned int>(rows_idx);  
+}
+
+// Method to print a SparseMatrixSymmetric
+template <typename T>                
+void SparseMatrixSymmetric<T>::print(){
+    std::cout<<std::endl;
+    // Case 1: the matrix is at most 10x10 (we print the whole matrix, both triangles)
+    if(this->n_rows<=10){
+        for (unsigned int i = 0; i < this->n_rows; i++) {
+            std::cout<< "|  ";
+            for (unsigned int j = 0; j < this->n_cols; j++) {
+                std::cout<<(*this)(i,j)<< "  ";
+            }
+            std::cout<< "|" <<std::endl;
+        }
+    }
+    // Case 2: the matrix is larger (we print just the stored values, i.e. the upper triangle)
+    else{
+        std::cout<<"Matrix too large: only sparse values (upper triangle) will be printed!"<<std::endl;
+        for(unsigned int i = 0; i < this->n_rows; i++) {
+            for (unsigned int k = rows_idx[i]; k < rows_idx[i+1]; k++) {
+                std::cout << "[" << i << "," << this->cols[k] << "] = " << this->values[k] << std::endl;
+            }
+        }
+        std::cout<<std::endl;
+    }
+}
+
+// Method for SparseMatrixSymmetric in-place matrix-vector product
+template <typename T>
+void SparseMatrixSymmetric<T>::multiply_add(const T alpha, const T *x, const T beta, T *y)const {
+    // Serial version: a single block, so every transposed contribution goes straight into y
+    if(this->n_threads<=1 || this->n_rows<=1){
+        multiply_rows(0, this->n_rows, alpha, x, beta, y, nullptr);
+        return;
+    }
+    /* Parallel version, in two phases (each one writes disjoint ranges of y, so there are no races):
+        1) each thread computes its block of rows [first,last) and the transposed contributions to its own rows;
+           the ones to the rows after the block (j>=last: the upper triangle never goes back) are accumulated in
+           a private spill vector, which only covers the rows [last, last column of the block];
+        2) each block adds to its rows the overlapping part of the spill vectors of the blocks before it.
+       For banded (e.g. reordered, see Reordering.hpp) matrices spill vectors are as short as the bandwidth */
+    const std::vector<unsigned int> bounds = nnz_partition(rows_idx, this->n_threads);
+    const unsigned int n_blocks = bounds.size()-1;
+    std::vector<std::vector<T>> spills(n_blocks);
+    run_blocks(bounds, [&](const unsigned int first, const unsigned int last){
+        const unsigned int t = std::upper_bound(bounds.begin(), bounds.end(), first)-bounds.begin()-1;
+        unsigned int last_col = last;
+        for(unsigned int i=first; i<last; i++){
+            if(rows_idx[i]<rows_idx[i+1]){
+                last_col = std::max(last_col, this->cols[rows_idx[i+1]-1]+1);
+            }
+        }
+        spills[t].assign(last_col-last, T(0));
+        multiply_rows(first, last, alpha, x, beta, y, spills[t].data());
+    });
+    run_blocks(bounds, [&](const unsigned int first, const unsigned int last){
+        const unsigned int s = std::upper_bound(bounds.begin(), bounds.end(), first)-bounds.begin()-1;
+        for(unsigned int t=0; t<s; t++){
+            // The spill vector of the block t covers the rows [bounds[t+1], bounds[t+1]+spills[t].size())
+            const unsigned int start = bounds[t+1];
+            const unsigned int end = std::min<unsigned int>(last, start+spills[t].size());
+            for(unsigned int j=std::max(first, start); j<end; j++){
+                y[j] += spills[t][j-start];
+            }
+        }
+    });
+}
+
+// Method for SparseMatrixSymmetric in-place transposed matrix-vector product
+template <typename T>
+void SparseMatrixSymmetric<T>::multiply_add_transposed(const T alpha, const T *x, const T beta, T *y)const {
+    // The matrix is symmetric: A^T*x = A*x
+    multiply_add(alpha, x, beta, y);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// (9) SparseMatrixMixed definitions
+// SparseMatrixMixed class constructor
+template <typename T, typename S>
+SparseMatrixMixed<T,S>::SparseMatrixMixed(const unsigned int &nr,
+                                          const unsigned int &nc,
+                                          const std::vector<S> &d,
+                                          const std::vector<unsigned int> &c,
+                                          const std::vector<unsigned int> &r) :
+    SparseFormat<SparseMatrixMixed<T,S>, T>(nr, nc, {}, c), low_values(d), rows_idx(r) {
+    // Check that the vectors are consistent (the columns of each row must be sorted, as in CSR)
+    assert(rows_idx.size()==nr+1 && rows_idx.back()==low_values.size() && this->cols.size()==low_values.size());
+};
+
+// SparseMatrixMixed copy constructor
+template <typename T, typename S>
+SparseMatrixMixed<T,S>::SparseMatrixMixed(const SparseMatrixMixed<T,S> &other)
+    :SparseFormat<SparseMatrixMixed<T,S>, T>(other), low_values(other.low_values), rows_idx(other.rows_idx) {};
+
+// SparseMatrixMixed assignment operator
+template <typename T, typename S>
+SparseMatrixMixed<T,S> & SparseMatrixMixed<T,S>::operator =(const SparseMatrixMixed<T,S> &other){
+    if(this != &other){
+        this->n_rows= other.n_rows;
+        this->n_cols= other.n_cols;
+        this->cols= other.cols;
+        this->low_values= other.low_values;
+        this->rows_idx= other.rows_idx;
+        this->n_threads= other.n_threads;
+        return (*this);
+    }
+    return (*this);
+}
+
+// Method to print information about a SparseMatrixMixed
+template <typename T, typename S>
+void SparseMatrixMixed<T,S>::get_info() const{
+    std::cout<<std::endl;
+    std::cout<<"Number of nonzero elements: "<<this->get_nzeros()<<" ("<<sizeof(S)<<" bytes per value)"<<std::endl;
+
+    std::cout<<"Nonzero values: ";
+    print_vector<S>(low_values); 
+
+    std::cout<<"Columns: ";
+    print_vector<unsigned int>(this->cols);
+
+    std::cout<<"Rows_idx: ";
+    print_vector<unsigned int>(rows_idx);  
+}
+
+// Method to print a SparseMatrixMixed
+template <typename T, typename S>                
+void SparseMatrixMixed<T,S>::print(){
+    std::cout<<std::endl;
+    // Case 1: both dimensions are <= 10 (we print the whole matrix)
+    if(this->n_rows<=10 && this->n_cols<=10){
+        for (unsigned int i = 0; i < this->n_rows; i++) {
+            std::cout<< "|  ";
+            for (unsigned int j = 0; j < this->n_cols; j++) {
+                std::cout<<(*this)(i,j)<< "  ";
+            }
+            std::cout<< "|" <<std::endl;
+        }
+    }
+    // Case 2: at least one dimension exceeds 10 (we print just the sparse values)
+    else{
+        std::cout<<"Matrix too large: only sparse values will be printed!"<<std::endl;
+        for(unsigned int i = 0; i < this->n_rows; i++) {
+            for (unsigned int k = rows_idx[i]; k < rows_idx[i+1]; k++) {
+                std::cout << "[" << i << "," << this->cols[k] << "] = " << low_values[k] << std::endl;
+            }
+        }
+        std::cout<<std::endl;
+    }
+}
+
+// Method for SparseMatrixMixed in-place matrix-vector product
+template <typename T, typename S>
+void SparseMatrixMixed<T,S>::multiply_add(const T alpha, const T *x, const T beta, T *y)const {
+    // Same structure of the CSR product (serial, or blocks of rows with the same number of nonzeros)
+    auto multiply_rows = [&](const unsigned int first, const unsigned int last){
+        csr_mixed_rows(low_values.data(), this->cols.data(), rows_idx.data(), first, last, this->n_cols,
+                       alpha, x, beta, y);
+    };
+    if(this->n_threads<=1 || this->n_rows<=1){
+        multiply_rows(0, this->n_rows);
+        return;
+    }
+    run_blocks(nnz_partition(rows_idx, this->n_threads), multiply_rows);
+}
+
+// Method for SparseMatrixMixed in-place transposed matrix-vector product
+template <typename T, typename S>
+void SparseMatrixMixed<T,S>::multiply_add_transposed(const T alpha, const T *x, const T beta, T *y)const {
+    // Same scatter of the CSR transposed product (values converted to T as they are loaded, private copies of y in T)
+    scatter_product(low_values, this->cols, rows_idx, this->n_cols, this->n_threads, alpha, x, beta, y);
+}
+
+// Method to print a PrecisionReport
+inline void PrecisionReport::print() const{
+    const std::ios_base::fmtflags flags = std::cout.flags();
+    const std::streamsize precision = std::cout.precision(3);
+    std::cout<<std::scientific;
+    std::cout<<"Unit roundoff of the storage type: "<<unit_roundoff<<std::endl;
+    std::cout<<"Maximum relative error of the stored values: "<<max_value_error<<std::endl;
+    std::cout<<"Maximum absolute error of the product: "<<max_abs_error<<std::endl;
+    std::cout<<"Relative error of the product (2-norm): "<<relative_error<<std::endl;
+    std::cout.flags(flags);
+    std::cout<<"Bytes of the matrix: "<<100.*bytes_ratio<<"% of the full precision one"<<std::endl;
+    std::cout.precision(precision);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// (10) SparseMatrixTiled definitions
+// SparseMatrixTiled class constructor
+template <typename T>
+SparseMatrixTiled<T>::SparseMatrixTiled(const unsigned int &nr,
+                                        const unsigned int &nc,
+                                        const std::vector<T> &d,
+                                        const std::vector<unsigned int> &c,
+                                        const std::vector<unsigned int> &r,
+                                        const unsigned int &width,
+                                        const unsigned int &n_threads) :
+    SparseFormat<SparseMatrixTiled<T>, T>(nr, nc, {}, {}), rows_idx(r) {
+    // Check that the vectors are consistent (the columns of each row must be sorted, as in CSR)
+    assert(rows_idx.size()==nr+1 && rows_idx.back()==d.size() && c.size()==d.size());
+    // The threads are set first, so the auto-tuning times the products that the matrix will actually run
+    this->set_threads(n_threads);
+    if(width>0 || nc<=cache_columns()){
+        buildTiles(width>0 ? width : std::max(1u, nc), d, c, r);
+        return;
+    }
+    /* Auto-tuning: the best width depends on the cache and on how many nonzeros each tile has (a narrow tile keeps
+       its slice of x in the cache, but it stores more rows, each one with fewer nonzeros), so we time the product
+       with a few widths around the size of the L2 cache, and without tiles, and we keep the fastest one */
+    std::vector<unsigned int> candidates;
+    for(const unsigned int factor : {1u, 2u, 8u, 32u}){
+        const unsigned long long candidate = (unsigned long long)cache_columns()*factor/2;
+        if(candidate<nc){
+            candidates.push_back(candidate);
+        }
+    }
+    candidates.push_back(nc);
+    std::vector<T> x(nc, T(1)), y(nr);
+    unsigned int best_width = nc;
+    double best_time = std::numeric_limits<double>::max();
+    for(const unsigned int candidate : candidates){
+        buildTiles(candidate, d, c, r);
+        double time = std::numeric_limits<double>::max();
+        for(unsigned int rep=0; rep<3; rep++){
+            auto start = std::chrono::steady_clock::now();
+            multiply_add(T(1), x.data(), T(0), y.data());
+            time = std::min(time, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()-start).count());
+        }
+        tuning.push_back({candidate, time});
+        if(time<best_time){
+            best_time = time;
+            best_width = candidate;
+        }
+    }
+    if(best_width!=candidates.back()){
+        buildTiles(best_width, d, c, r);
+    }
+};
+
+// SparseMatrixTiled copy constructor
+template <typename T>
+SparseMatrixTiled<T>::SparseMatrixTiled(const SparseMatrixTiled<T> &other)
+    :SparseFormat<SparseMatrixTiled<T>, T>(other), tile_width(other.tile_width), tiles_idx(other.tiles_idx),
+    tile_rows(other.tile_rows), row_ptr(other.row_ptr), rows_idx(other.rows_idx), tuning(other.tuning) {};
+
+// SparseMatrixTiled assignment operator
+template <typename T>
+SparseMatrixTiled<T> & SparseMatrixTiled<T>::operator =(const SparseMatrixTiled<T> &other){
+    if(this != &other){
+        this->n_rows= other.n_rows;
+        this->n_cols= other.n_cols;
+        this->values= other.values;
+        this->cols= other.cols;
+        this->tile_width= other.tile_width;
+        this->tiles_idx= other.tiles_idx;
+        this->tile_rows= other.tile_rows;
+        this->row_ptr= other.row_ptr;
+        this->rows_idx= other.rows_idx;
+        this->tuning= other.tuning;
+        this->n_threads= other.n_threads;
+        return (*this);
+    }
+    return (*this);
+}
+
+// Method to get the number of columns that fill half of the L2 cache
+template <typename T>
+unsigned int SparseMatrixTiled<T>::cache_columns(){
+    // The other half of the cache is left to the matrix itself and to y (a power of two, at least 1024 columns)
+    long cache = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    if(cache<=0){
+        cache = 1<<20;
+    }
+    unsigned int columns = 1024;
+    while(2ull*columns*sizeof(T)<=(unsigned long long)cache/2){
+        columns *= 2;
+    }
+    return columns;
+}
+
+// Method to print information about a SparseMatrixTiled
+template <typename T>
+void SparseMatrixTiled<T>::get_info() const{
+    std::cout<<std::endl;
+    std::cout<<"Number of nonzero elements: "<<this->get_nzeros()<<std::endl;
+    std::cout<<"Tile width: "<<tile_width<<" ("<<get_ntiles()<<" tiles, "<<tile_rows.size()<<" stored rows)"<<std::endl;
+    if(!tuning.empty()){
+        std::cout<<"Auto-tuning (width: ms per product): ";
+        for(const std::pair<unsigned int, double> &candidate : tuning){
+            std::cout<<candidate.first<<": "<<candidate.second<<"  ";
+        }
+        std::cout<<std::endl;
+    }
+}
+
+// Method to print a SparseMatrixTiled
+template <typename T>                
+void SparseMatrixTiled<T>::print(){
+    std::cout<<std::endl;
+    // Case 1: both dimensions are <= 10 (we print the whole matrix)
+    if(this->n_rows<=10 && this->n_cols<=10){
+        for (unsigned int i = 0; i < this->n_rows; i++) {
+            std::cout<< "|  ";
+            for (unsigned int j = 0; j < this->n_cols; j++) {
+                std::cout<<(*this)(i,j)<< "  ";
+            }
+            std::cout<< "|" <<std::endl;
+        }
+    }
+    // Case 2: at least one dimension exceeds 10 (we print just the sparse values, tile by tile)
+    else{
+        std::cout<<"Matrix too large: only sparse values will be printed!"<<std::endl;
+        for(unsigned int t = 0; t < get_ntiles(); t++) {
+            for(unsigned int r = tiles_idx[t]; r < tiles_idx[t+1]; r++) {
+                for (unsigned int k = row_ptr[r]; k < row_ptr[r+1]; k++) {
+                    std::cout << "[" << tile_rows[r] << "," << t*tile_width+this->cols[k] << "] = "
+                              << this->values[k] << std::endl;
+                }
+            }
+        }
+        std::cout<<std::endl;
+    }
+}
+
+// Method for SparseMatrixTiled in-place matrix-vector product
+template <typename T>
+void SparseMatrixTiled<T>::multiply_add(const T alpha, const T *x, const T beta, T *y)const {
+    // Serial version: all the rows, tile by tile
+    if(this->n_threads<=1 || this->n_rows<=1){
+        multiply_rows(0, this->n_rows, alpha, x, beta, y);
+        return;
+    }
+    /* Parallel version: rows are split in blocks with (roughly) the same number of nonzeros, and each thread goes
+       through all the tiles with its own rows (so each thread writes a disjoint range of y) */
+    run_blocks(nnz_partition(rows_idx, this->n_threads), [&](const unsigned int first, const unsigned int last){
+        multiply_rows(first, last, alpha, x, beta, y);
+    });
+}
+
+// Method for SparseMatrixTiled in-place transposed matrix-vector product
+template <typename T>
+void SparseMatrixTiled<T>::multiply_add_transposed(const T alpha, const T *x, const T beta, T *y)const {
+    // Serial scatter tile by tile (so the scatter only writes in the slice of y of the current tile)
+    scale_vector(y, this->n_cols, beta);
+    for(unsigned int t=0; t<get_ntiles(); t++){
+        T *y_tile = y + t*tile_width;
+        for(unsigned int r=tiles_idx[t]; r<tiles_idx[t+1]; r++){
+            const T xi = alpha*x[tile_rows[r]];
+            for(unsigned int k=row_ptr[r]; k<row_ptr[r+1]; k++){
+                y_tile[this->cols[k]] += this->values[k]*xi;
+            }
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// (11) SparseMatrixHYB definitions
+// SparseMatrixHYB class constructor
+template <typename T>
+SparseMatrixHYB<T>::SparseMatrixHYB(const unsigned int &nr,
+                                    const unsigned int &nc,
+                                    const std::vector<T> &d,
+                                    const std::vector<unsigned int> &c,
+                                    const std::vector<unsigned int> &r,
+                                    const unsigned int &width) :
+    SparseFormat<SparseMatrixHYB<T>, T>(nr, nc, {}, {}), ell_width(width>0 ? width : chooseWidth(r)),
+    ell_len(nr, 0), tail(nr, nc, tailEntries(d, r, ell_width), tailEntries(c, r, ell_width), tailRows(r, ell_width)) {
+    // Check that the vectors are consistent (the columns of each row must be sorted, as in CSR)
+    assert(r.size()==nr+1 && r.back()==d.size() && c.size()==d.size());
+    assert((unsigned long long)nr*ell_width<=std::numeric_limits<unsigned int>::max());
+    // The slab is column-major: the s-th element of the row i is at s*n_rows+i (padding: value 0 in column 0)
+    this->values.assign((size_t)nr*ell_width, T(0));
+    this->cols.assign((size_t)nr*ell_width, 0);
+    for(unsigned int i=0; i<nr; i++){
+        ell_len[i] = std::min(ell_width, r[i+1]-r[i]);
+        for(unsigned int s=0; s<ell_len[i]; s++){
+            this->values[(size_t)s*nr+i] = d[r[i]+s];
+            this->cols[(size_t)s*nr+i] = c[r[i]+s];
+        }
+        ell_nnz += ell_len[i];
+    }
+};
+
+// SparseMatrixHYB copy constructor
+template <typename T>
+SparseMatrixHYB<T>::SparseMatrixHYB(const SparseMatrixHYB<T> &other)
+    :SparseFormat<SparseMatrixHYB<T>, T>(other), ell_width(other.ell_width), ell_nnz(other.ell_nnz),
+    ell_len(other.ell_len), tail(other.tail) {};
+
+// SparseMatrixHYB assignment operator
+template <typename T>
+SparseMatrixHYB<T> & SparseMatrixHYB<T>::operator =(const SparseMatrixHYB<T> &other){
+    if(this != &other){
+        this->n_rows= other.n_rows;
+        this->n_cols= other.n_cols;
+        this->values= other.values;
+        this->cols= other.cols;
+        this->ell_width= other.ell_width;
+        this->ell_nnz= other.ell_nnz;
+        this->ell_len= other.ell_len;
+        this->tail= other.tail;
+        this->n_threads= other.n_threads;
+        return (*this);
+    }
+    return (*this);
+}
+
+// Method to print information about a SparseMatrixHYB
+template <typename T>
+void SparseMatrixHYB<T>::get_info() const{
+    std::cout<<std::endl;
+    std::cout<<"Number of nonzero elements: "<<this->get_nzeros()<<std::endl;
+    std::cout<<"ELL slab: width "<<ell_width<<", "<<ell_nnz<<" nonzeros and "
+             <<this->values.size()-ell_nnz<<" padding elements"<<std::endl;
+    std::cout<<"COO tail: "<<tail.get_nzeros()<<" nonzeros"<<std::endl;
+}
+
+// Method to print a SparseMatrixHYB
+template <typename T>                
+void SparseMatrixHYB<T>::print(){
+    std::cout<<std::endl;
+    // Case 1: both dimensions are <= 10 (we print the whole matrix)
+    if(this->n_rows<=10 && this->n_cols<=10){
+        for (unsigned int i = 0; i < this->n_rows; i++) {
+            std::cout<< "|  ";
+            for (unsigned int j = 0; j < this->n_cols; j++) {
+                std::cout<<(*this)(i,j)<< "  ";
+            }
+            std::cout<< "|" <<std::endl;
+        }
+    }
+    // Case 2: at least one dimension exceeds 10 (we print just the sparse values, the slab and then the tail)
+    else{
+        std::cout<<"Matrix too large: only sparse values will be printed!"<<std::endl;
+        for (unsigned int i = 0; i < this->n_rows; i++) {
+            for (unsigned int s = 0; s < ell_len[i]; s++) {
+                std::cout << "[" << i << "," << this->cols[(size_t)s*this->n_rows+i] << "] = "
+                          << this->values[(size_t)s*this->n_rows+i] << std::endl;
+            }
+        }
+        for (unsigned int k = 0; k < tail.get_nzeros(); k++) {
+            std::cout << "[" << tail.get_rows()[k] << "," << tail.get_cols()[k] << "] = "
+                      << tail.get_values()[k] << std::endl;
+        }
+        std::cout<<std::endl;
+    }
+}
+
+// Method for SparseMatrixHYB in-place matrix-vector product
+template <typename T>
+void SparseMatrixHYB<T>::multiply_add(const T alpha, const T *x, const T beta, T *y)const {
+    const std::vector<T> &t_values = tail.get_values();
+    const std::vector<unsigned int> &t_cols = tail.get_cols(), &t_rows = tail.get_rows();
+    const unsigned int t_nnz = t_values.size();
+    // Serial version: the slab, then the tail (in "simd.hpp")
+    if(this->n_threads<=1){
+        multiply_ell(0, this->n_rows, alpha, x, beta, y);
+        coo_multiply(t_values.data(), t_cols.data(), t_rows.data(), t_nnz, alpha, x, y);
+        return;
+    }
+    /* Parallel version, in two phases. (1) Slab: all the rows have the same work, so they are split in blocks
+       with the same number of rows */
+    const unsigned int n_threads = this->n_threads;
+    std::vector<unsigned int> bounds(n_threads+1);
+    for(unsigned int t=0; t<=n_threads; t++){
+        bounds[t] = (unsigned long long)this->n_rows*t/n_threads;
+    }
+    run_blocks(bounds, [&](const unsigned int first, const unsigned int last){
+        multiply_ell(first, last, alpha, x, beta, y);
+    });
+    /* (2) Tail: its nonzeros are split in blocks of the same size, whatever the rows they belong to. A row can cross
+       the boundary between two blocks: since the tail is sorted by row, only the first row of each block can be shared
+       with the blocks before it, so its sum is kept aside (carry) and added to y after the threads have joined,
+       while all the other rows of the block are only written by its thread */
+    for(unsigned int t=0; t<=n_threads; t++){
+        bounds[t] = (unsigned long long)t_nnz*t/n_threads;
+    }
+    std::vector<T> carry(n_threads, T(0));
+    std::vector<unsigned int> carry_row(n_threads, 0);
+    run_blocks(bounds, [&](const unsigned int first, const unsigned int last){
+        const unsigned int t = std::upper_bound(bounds.begin(), bounds.end(), first) - bounds.begin() - 1;
+        unsigned int k = first;
+        T sum = T(0);
+        for(; k<last && t_rows[k]==t_rows[first]; k++){
+            sum += t_values[k]*x[t_cols[k]];
+        }
+        carry[t] = sum;
+        carry_row[t] = t_rows[first];
+        coo_multiply(t_values.data()+k, t_cols.data()+k, t_rows.data()+k, last-k, alpha, x, y);
+    });
+    for(unsigned int t=0; t<n_threads; t++){
+        if(bounds[t]<bounds[t+1]){
+            y[carry_row[t]] += alpha*carry[t];
+        }
+    }
+}
+
+// Method for SparseMatrixHYB in-place transposed matrix-vector product
+template <typename T>
+void SparseMatrixHYB<T>::multiply_add_transposed(const T alpha, const T *x, const T beta, T *y)const {
+    // Same scatter as CSR for the slab, then the tail with the roles of rows and cols swapped
+    scale_vector(y, this->n_cols, beta);
+    for(unsigned int i=0; i<this->n_rows; i++){
+        const T xi = alpha*x[i];
+        for(unsigned int s=0; s<ell_len[i]; s++){
+            y[this->cols[(size_t)s*this->n_rows+i]] += this->values[(size_t)s*this->n_rows+i]*xi;
+        }
+    }
+    coo_multiply(tail.get_values().data(), tail.get_rows().data(), tail.get_cols().data(), tail.get_nzeros(),
+                 alpha, x, y);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Functions for conversions
+template <typename T, typename I, typename P>
+SparseMatrixCSR<T,I,P>* COO_to_CSR(SparseMatrixCOO<T,I,P> *matrix){
+    /* We use a counting sort on the row indices, which is linear in the number of nonzeros:
+        1) count the nonzeros of each row (histogram);
+        2) the cumulative sum of the histogram is exactly rows_idx;
+        3) scatter each nonzero in the first free position of its row.
+       The sort is stable, so inside each row the nonzeros keep the same order as in the COO matrix
+       (then the CSR constructor sorts the columns of the rows that are not sorted) */
+    const unsigned int n_rows = matrix->get_nrows();
+    const P nnz = matrix->get_nzeros();
+    const std::vector<I> &rows = matrix->get_rows();
+    const std::vector<I> &cols = matrix->get_cols();
+    const std::vector<T> &values = matrix->get_values();
+    // Vectors attributes for the new matrix
+    std::vector<I> new_cols(nnz);
+    std::vector<T> new_values(nnz);
+    // CONVENTION: first element of rows_idx is always 0
+    std::vector<P> rows_idx(n_rows+1, 0);
+    // Number of threads (each of them gets a contiguous chunk of nonzeros)
+    const unsigned int n_threads = std::max(1ULL, std::min((unsigned long long)matrix->get_threads(),
+                                                           (unsigned long long)nnz));
+
+    if(n_threads==1){
+        // (1) Histogram of the rows (shifted by one, so that the cumulative sum gives rows_idx directly)
+        for(P k=0; k<nnz; k++){
+            rows_idx[rows[k]+1]++;
+        }
+        // (2) Cumulative sum
+        for(unsigned int i=0; i<n_rows; i++){
+            rows_idx[i+1] += rows_idx[i];
+        }
+        // (3) Scatter: next[i] is the first free position of the i-th row
+        std::vector<P> next(rows_idx.begin(), rows_idx.end()-1);
+        for(P k=0; k<nnz; k++){
+            P position = next[rows[k]]++;
+            new_cols[position] = cols[k];
+            new_values[position] = values[k];
+        }
+    }
+    else{
+        /* Parallel version: each thread builds the histogram of its own chunk of nonzeros.
+           The offset of thread t inside row i is rows_idx[i] plus the nonzeros of row i found by threads 0,...,t-1,
+           so chunks are scattered in order and the result is the same as in the serial version */
+        std::vector<P> chunks(n_threads+1);
+        for(unsigned int t=0; t<=n_threads; t++){
+            chunks[t] = (unsigned long long)nnz*t/n_threads;
+        }
+        std::vector<std::vector<P>> hist(n_threads);
+        std::vector<std::thread> workers;
+        // (1) Per-thread histograms
+        for(unsigned int t=0; t<n_threads; t++){
+            workers.emplace_back([&, t](){
+                hist[t].assign(n_rows, 0);
+                for(P k=chunks[t]; k<chunks[t+1]; k++){
+                    hist[t][rows[k]]++;
+                }
+            });
+        }
+        for(std::thread &w : workers){
+            w.join();
+        }
+        workers.clear();
+        // (2) Cumulative sum: rows_idx and, in place of the histograms, the offset of each thread inside each row
+        for(unsigned int i=0; i<n_rows; i++){
+            P offset = rows_idx[i];
+            for(unsigned int t=0; t<n_threads; t++){
+                P count = hist[t][i];
+                hist[t][i] = offset;
+                offset += count;
+            }
+            rows_idx[i+1] = offset;
+        }
+        // (3) Per-thread scatter (threads write disjoint positions)
+        for(unsigned int t=0; t<n_threads; t++){
+            workers.emplace_back([&, t](){
+                std::vector<P> &next = hist[t];
+                for(P k=chunks[t]; k<chunks[t+1]; k++){
+                    P position = next[rows[k]]++;
+                    new_cols[position] = cols[k];
+                    new_values[position] = values[k];
+                }
+            });
+        }
+        for(std::thread &w : workers){
+            w.join();
+        }
+    }
+
+    // Now we can define the CSR version of the input matrix
+    SparseMatrixCSR<T,I,P>* converted_matrix = new SparseMatrixCSR<T,I,P>{n_rows, matrix->get_ncols(), new_values, new_cols,
+                                                                          rows_idx};
+    converted_matrix->set_threads(matrix->get_threads());
+    /* Before returning the converted matrix(CSR), it makes sense to delete the initial COO version 
+       Since we passed the input as a pointer, we can easily deallocate it with "delete" */
+    delete matrix;
+    return converted_matrix;
+}
+
+template <typename T, typename I, typename P>
+SparseMatrixCOO<T,I,P>* CSR_to_COO(SparseMatrixCSR<T,I,P> *matrix){
+    // Vectors attributes for the new matrix
+    std::vector<I> cols=matrix->get_cols();
+    std::vector<T> values=matrix->get_values();
+    std::vector<I> rows;
+    // For each row of the matrix
+    for(unsigned i=0; i < matrix->get_nrows();i++){
+        /* matrix->get_rows_idx()[i+1]-matrix->get_rows_idx()[i] is the number of non-zero elements in the i-th row,
+           so we repeat its index in the rows vector such number of times */
+        for(P rep=1;rep<=matrix->get_rows_idx()[i+1]-matrix->get_rows_idx()[i];rep++){
+            rows.push_back(i);
+        }
+    }
+    
+    // Now we can define the COO version of the input matrix
+    SparseMatrixCOO<T,I,P>* converted_matrix = new SparseMatrixCOO<T,I,P>{matrix->get_nrows(), matrix->get_ncols(),
+                                                                          values, cols, rows};
+    converted_matrix->set_threads(matrix->get_threads());
+    /* Before returning the converted matrix(COO), it makes sense to delete the initial CSR version 
+       Since we passed the input as a pointer, we can easily deallocate it with "delete" */
+    delete matrix;
+    return converted_matrix;
+}
+
+template <typename I2, typename P2, typename T, typename I, typename P>
+SparseMatrixCSR<T,I2,P2>* CSR_to_CSR(SparseMatrixCSR<T,I,P> *matrix){
+    // Same vectors, with the indices converted to the new types (the columns of each row are already sorted)
+    const std::vector<I> &cols = matrix->get_cols();
+    const std::vector<P> &rows_idx = matrix->get_rows_idx();
+    assert(matrix->get_ncols()==0 || matrix->get_ncols()-1<=std::numeric_limits<I2>::max());
+    assert(rows_idx.back()<=std::numeric_limits<P2>::max());
+    std::vector<I2> new_cols(cols.begin(), cols.end());
+    std::vector<P2> new_rows_idx(rows_idx.begin(), rows_idx.end());
+    SparseMatrixCSR<T,I2,P2>* converted_matrix = new SparseMatrixCSR<T,I2,P2>{matrix->get_nrows(), matrix->get_ncols(),
+                                                                              matrix->get_values(), new_cols,
+                                                                              new_rows_idx};
+    converted_matrix->set_threads(matrix->get_threads());
+    delete matrix;
+    return converted_matrix;
+}
+
+template <typename T>
+SparseMatrixSELL<T>* CSR_to_SELL(SparseMatrixCSR<T> *matrix, const unsigned int chunk, const unsigned int window){
+    // The SELL constructor takes directly the CSR vectors
+    SparseMatrixSELL<T>* converted_matrix = new SparseMatrixSELL<T>{matrix->get_nrows(), matrix->get_ncols(),
+                                                                    matrix->get_values(), matrix->get_cols(),
+                                                                    matrix->get_rows_idx(), chunk, window};
+    converted_matrix->set_threads(matrix->get_threads());
+    /* Before returning the converted matrix(SELL), it makes sense to delete the initial CSR version 
+       Since we passed the input as a pointer, we can easily deallocate it with "delete" */
+    delete matrix;
+    return converted_matrix;
+}
+
+template <typename T>
+SparseMatrixCSR<T>* SELL_to_CSR(SparseMatrixSELL<T> *matrix){
+    /* The row in the sorted position p is the original row perm[p]: its s-th element is at chunks_idx[k]+s*C+lane
+       (k=p/C, lane=p%C) for s<rows_len[p], the rest of the chunk is padding. We count the rows lengths first, so
+       each row is written directly in its place (the CSR constructor sorts the rows written by setValue) */
+    const unsigned int n = matrix->get_nrows(), C = matrix->get_chunk_size();
+    const std::vector<T> &values = matrix->get_values();
+    const std::vector<unsigned int> &cols = matrix->get_cols(), &chunks_idx = matrix->get_chunks_idx();
+    const std::vector<unsigned int> &perm = matrix->get_perm(), &rows_len = matrix->get_rows_len();
+    std::vector<unsigned int> new_rows_idx(n+1, 0);
+    for(unsigned int p=0; p<n; p++){
+        new_rows_idx[perm[p]+1] = rows_len[p];
+    }
+    for(unsigned int i=0; i<n; i++){
+        new_rows_idx[i+1] += new_rows_idx[i];
+    }
+    std::vector<T> new_values(new_rows_idx[n]);
+    std::vector<unsigned int> new_cols(new_rows_idx[n]);
+    for(unsigned int p=0; p<n; p++){
+        const unsigned int first = chunks_idx[p/C] + p%C;
+        for(unsigned int s=0; s<rows_len[p]; s++){
+            new_values[new_rows_idx[perm[p]]+s] = values[first+s*C];
+            new_cols[new_rows_idx[perm[p]]+s] = cols[first+s*C];
+        }
+    }
+    SparseMatrixCSR<T>* converted_matrix = new SparseMatrixCSR<T>{n, matrix->get_ncols(), new_values, new_cols,
+                                                                  new_rows_idx};
+    converted_matrix->set_threads(matrix->get_threads());
+    /* Before returning the converted matrix(CSR), it makes sense to delete the initial SELL version 
+       Since we passed the input as a pointer, we can easily deallocate it with "delete" */
+    delete matrix;
+    return converted_matrix;
+}
+
+template <typename T>
+unsigned int detect_block_size(const SparseMatrixCSR<T> &matrix, const double max_fill, double *density){
+    /* For each candidate size b (from the largest one) we count the bxb blocks touched by the nonzeros:
+       the "fill" (stored elements over nonzeros) is 1 if the matrix is exactly made of dense blocks */
+    const std::vector<unsigned int> &rows_idx = matrix.get_rows_idx();
+    const std::vector<unsigned int> &cols = matrix.get_cols();
+    const unsigned int nnz = matrix.get_nzeros();
+    for(unsigned int b=8; b>1; b--){
+        if(matrix.get_nrows()%b!=0 || matrix.get_ncols()%b!=0 || nnz==0){
+            continue;
+        }
+        // last_seen[bj] is the last block row in which we found the block column bj (+1, so that 0 means "never")
+        std::vector<unsigned int> last_seen(matrix.get_ncols()/b, 0);
+        unsigned long long n_blocks=0;
+        for(unsigned int i=0; i<matrix.get_nrows(); i++){
+            for(unsigned int k=rows_idx[i]; k<rows_idx[i+1]; k++){
+                if(last_seen[cols[k]/b]!=i/b+1){
+                    last_seen[cols[k]/b]=i/b+1;
+                    n_blocks++;
+                }
+            }
+        }
+        if((double)(n_blocks*b*b) <= max_fill*nnz){
+            if(density!=nullptr){
+                *density = (double)nnz/(n_blocks*b*b);
+            }
+            return b;
+        }
+    }
+    if(density!=nullptr){
+        *density = 1.;
+    }
+    return 1;
+}
+
+template <unsigned int R, unsigned int C, typename T>
+SparseMatrixBSR<T,R,C>* CSR_to_BSR(SparseMatrixCSR<T> *matrix){
+    // A matrix that is not made of whole blocks is rejected before anything is done (the input is not deleted)
+    if(matrix->get_nrows()%R!=0 || matrix->get_ncols()%C!=0){
+        throw std::invalid_argument("CSR_to_BSR: the dimensions are not multiples of the block size");
+    }
+    const unsigned int n_block_rows = matrix->get_nrows()/R;
+    const std::vector<unsigned int> &rows_idx = matrix->get_rows_idx();
+    const std::vector<unsigned int> &cols = matrix->get_cols();
+    const std::vector<T> &values = matrix->get_values();
+    // Vectors attributes for the new matrix
+    std::vector<T> new_values;
+    std::vector<unsigned int> new_cols;
+    // CONVENTION: first element of blocks_idx is always 0
+    std::vector<unsigned int> blocks_idx{0};
+    // position[bj] is the index of the block (bi,bj) in the current block row (-1 if not there yet)
+    std::vector<int> position(matrix->get_ncols()/C, -1);
+    for(unsigned int bi=0; bi<n_block_rows; bi++){
+        // (1) Find the (sorted) block columns touched by the rows of the block row
+        unsigned int first_block = new_cols.size();
+        for(unsigned int i=bi*R; i<(bi+1)*R; i++){
+            for(unsigned int k=rows_idx[i]; k<rows_idx[i+1]; k++){
+                if(position[cols[k]/C]==-1){
+                    position[cols[k]/C]=0;
+                    new_cols.push_back(cols[k]/C);
+                }
+            }
+        }
+        std::sort(new_cols.begin()+first_block, new_cols.end());
+        for(unsigned int k=first_block; k<new_cols.size(); k++){
+            position[new_cols[k]]=k;
+        }
+        // (2) Copy the values in their blocks (the other elements of the blocks are zeros)
+        new_values.resize(new_cols.size()*R*C, 0);
+        for(unsigned int i=bi*R; i<(bi+1)*R; i++){
+            for(unsigned int k=rows_idx[i]; k<rows_idx[i+1]; k++){
+                new_values[position[cols[k]/C]*R*C+(i%R)*C+cols[k]%C] = values[k];
+            }
+        }
+        // (3) Reset the positions for the next block row
+        for(unsigned int k=first_block; k<new_cols.size(); k++){
+            position[new_cols[k]]=-1;
+        }
+        blocks_idx.push_back(new_cols.size());
+    }
+
+    // Now we can define the BSR version of the input matrix
+    SparseMatrixBSR<T,R,C>* converted_matrix = new SparseMatrixBSR<T,R,C>{matrix->get_nrows(), matrix->get_ncols(),
+                                                                          new_values, new_cols, blocks_idx};
+    converted_matrix->set_threads(matrix->get_threads());
+    /* Before returning the converted matrix(BSR), it makes sense to delete the initial CSR version 
+       Since we passed the input as a pointer, we can easily deallocate it with "delete" */
+    delete matrix;
+    return converted_matrix;
+}
+
+template <typename T, unsigned int R, unsigned int C>
+SparseMatrixCSR<T>* BSR_to_CSR(SparseMatrixBSR<T,R,C> *matrix){
+    /* The r-th row of the block row br is the r-th row of each of its blocks (row-major, so the row of a block is
+       contiguous), one block after the other: the blocks of a block row are sorted by block column, so the rows come
+       out sorted. Only the nonzeros are kept, as get_nzeros() does */
+    const unsigned int n = matrix->get_nrows();
+    const std::vector<T> &values = matrix->get_values();
+    const std::vector<unsigned int> &cols = matrix->get_cols(), &blocks_idx = matrix->get_blocks_idx();
+    std::vector<T> new_values;
+    std::vector<unsigned int> new_cols, new_rows_idx(n+1, 0);
+    new_values.reserve(matrix->get_nzeros());
+    new_cols.reserve(matrix->get_nzeros());
+    for(unsigned int i=0; i<n; i++){
+        const unsigned int br = i/R, r = i%R;
+        for(unsigned int b=blocks_idx[br]; b<blocks_idx[br+1]; b++){
+            for(unsigned int c=0; c<C; c++){
+                const T value = values[(size_t)b*R*C+r*C+c];
+                if(value!=T(0)){
+                    new_values.push_back(value);
+                    new_cols.push_back(cols[b]*C+c);
+                }
+            }
+        }
+        new_rows_idx[i+1] = new_values.size();
+    }
+    SparseMatrixCSR<T>* converted_matrix = new SparseMatrixCSR<T>{n, matrix->get_ncols(), new_values, new_cols,
+                                                                  new_rows_idx};
+    converted_matrix->set_threads(matrix->get_threads());
+    /* Before returning the converted matrix(CSR), it makes sense to delete the initial BSR version 
+       Since we passed the input as a pointer, we can easily deallocate it with "delete" */
+    delete matrix;
+    return converted_matrix;
+}
+
+template <typename T>
+SparseMatrixCSC<T>* CSR_to_CSC(SparseMatrixCSR<T> *matrix){
+    // The CSC vectors of the matrix are the CSR vectors of its transpose
+    std::vector<T> values;
+    std::vector<unsigned int> rows, cols_idx;
+    transpose_vectors(matrix->get_ncols(), matrix->get_values(), matrix->get_cols(), matrix->get_rows_idx(),
+                      values, rows, cols_idx);
+    SparseMatrixCSC<T>* converted_matrix = new SparseMatrixCSC<T>{matrix->get_nrows(), matrix->get_ncols(),
+                                                                  values, rows, cols_idx};
+    converted_matrix->set_threads(matrix->get_threads());
+    /* Before returning the converted matrix(CSC), it makes sense to delete the initial CSR version 
+       Since we passed the input as a pointer, we can easily deallocate it with "delete" */
+    delete matrix;
+    return converted_matrix;
+}
+
+template <typename T>
+SparseMatrixCSR<T>* CSC_to_CSR(SparseMatrixCSC<T> *matrix){
+    // Same as CSR_to_CSC, the other way around (the CSR vectors of the matrix are the CSC vectors of its transpose)
+    std::vector<T> values;
+    std::vector<unsigned int> cols, rows_idx;
+    transpose_vectors(matrix->get_nrows(), matrix->get_values(), matrix->get_rows(), matrix->get_cols_idx(),
+                      values, cols, rows_idx);
+    SparseMatrixCSR<T>* converted_matrix = new SparseMatrixCSR<T>{matrix->get_nrows(), matrix->get_ncols(),
+                                                                  values, cols, rows_idx};
+    converted_matrix->set_threads(matrix->get_threads());
+    /* Before returning the converted matrix(CSR), it makes sense to delete the initial CSC version 
+       Since we passed the input as a pointer, we can easily deallocate it with "delete" */
+    delete matrix;
+    return converted_matrix;
+}
+
+template <typename T>
+SparseMatrixDynamic<T>* CSR_to_Dynamic(SparseMatrixCSR<T> *matrix){
+    // Each row of the CSR matrix (already sorted) becomes the vectors of a row of the dynamic matrix
+    SparseMatrixDynamic<T>* converted_matrix = new SparseMatrixDynamic<T>{matrix->get_nrows(), matrix->get_ncols()};
+    converted_matrix->set_threads(matrix->get_threads());
+    const std::vector<unsigned int> &rows_idx = matrix->get_rows_idx();
+    for(unsigned int i=0; i<matrix->get_nrows(); i++){
+        for(unsigned int k=rows_idx[i]; k<rows_idx[i+1]; k++){
+            (*converted_matrix)(i, matrix->get_cols()[k]) = matrix->get_values()[k];
+        }
+    }
+    /* Before returning the converted matrix(Dynamic), it makes sense to delete the initial CSR version 
+       Since we passed the input as a pointer, we can easily deallocate it with "delete" */
+    delete matrix;
+    return converted_matrix;
+}
+
+// Function to convert a SparseMatrixCSR into a SparseMatrixSymmetric
+template <typename T>
+SparseMatrixSymmetric<T>* CSR_to_Symmetric(SparseMatrixCSR<T> *matrix){
+    /* We keep the elements with j>=i of each (sorted) row. The lower triangle is dropped, so the matrix must be
+       symmetric: each dropped a_ij must be equal to the stored a_ji (binary search in the row j), and the two
+       triangles must have the same number of elements (so no a_ji of the upper one is left without its a_ij).
+       A matrix that is not symmetric is rejected before it is deleted */
+    if(matrix->get_nrows()!=matrix->get_ncols()){
+        throw std::invalid_argument("CSR_to_Symmetric: the matrix is not square");
+    }
+    const unsigned int n = matrix->get_nrows();
+    const std::vector<T> &values = matrix->get_values();
+    const std::vector<unsigned int> &cols = matrix->get_cols();
+    const std::vector<unsigned int> &rows_idx = matrix->get_rows_idx();
+    std::vector<T> new_values;
+    std::vector<unsigned int> new_cols, new_rows_idx(n+1, 0);
+    new_values.reserve(values.size()/2+n);
+    new_cols.reserve(values.size()/2+n);
+    unsigned long long n_lower=0, n_upper=0;
+    for(unsigned int i=0; i<n; i++){
+        for(unsigned int k=rows_idx[i]; k<rows_idx[i+1]; k++){
+            if(cols[k]>=i){
+                new_values.push_back(values[k]);
+                new_cols.push_back(cols[k]);
+                n_upper += (cols[k]>i);
+            }
+            else if(matrix->get(cols[k], i)!=values[k]){
+                throw std::invalid_argument("CSR_to_Symmetric: the matrix is not symmetric");
+            }
+            else{
+                n_lower++;
+            }
+        }
+        new_rows_idx[i+1] = new_values.size();
+    }
+    if(n_lower!=n_upper){
+        throw std::invalid_argument("CSR_to_Symmetric: the matrix is not symmetric");
+    }
+    SparseMatrixSymmetric<T>* converted_matrix = new SparseMatrixSymmetric<T>{n, new_values, new_cols, new_rows_idx};
+    converted_matrix->set_threads(matrix->get_threads());
+    /* Before returning the converted matrix(Symmetric), it makes sense to delete the initial CSR version 
+       Since we passed the input as a pointer, we can easily deallocate it with "delete" */
+    delete matrix;
+    return converted_matrix;
+}
+
+// Function to convert a SparseMatrixSymmetric into a SparseMatrixCSR
+template <typename T>
+SparseMatrixCSR<T>* Symmetric_to_CSR(SparseMatrixSymmetric<T> *matrix){
+    /* The transpose of the upper triangle is the lower triangle (diagonal included): the full row i is the row i
+       of the transpose without its last element, the diagonal, followed by the row i of the upper triangle.
+       Both parts are sorted and the first one has only columns < i, so the full row is sorted too */
+    const unsigned int n = matrix->get_nrows();
+    const std::vector<T> &values = matrix->get_values();
+    const std::vector<unsigned int> &cols = matrix->get_cols();
+    const std::vector<unsigned int> &rows_idx = matrix->get_rows_idx();
+    std::vector<T> t_values;
+    std::vector<unsigned int> t_cols, t_rows_idx;
+    transpose_vectors(n, values, cols, rows_idx, t_values, t_cols, t_rows_idx);
+    std::vector<T> new_values;
+    std::vector<unsigned int> new_cols, new_rows_idx(n+1, 0);
+    new_values.reserve(matrix->get_nzeros());
+    new_cols.reserve(matrix->get_nzeros());
+    for(unsigned int i=0; i<n; i++){
+        for(unsigned int k=t_rows_idx[i]; k<t_rows_idx[i+1] && t_cols[k]<i; k++){
+            new_values.push_back(t_values[k]);
+            new_cols.push_back(t_cols[k]);
+        }
+        new_values.insert(new_values.end(), values.begin()+rows_idx[i], values.begin()+rows_idx[i+1]);
+        new_cols.insert(new_cols.end(), cols.begin()+rows_idx[i], cols.begin()+rows_idx[i+1]);
+        new_rows_idx[i+1] = new_values.size();
+    }
+    SparseMatrixCSR<T>* converted_matrix = new SparseMatrixCSR<T>{n, n, new_values, new_cols, new_rows_idx};
+    converted_matrix->set_threads(matrix->get_threads());
+    /* Before returning the converted matrix(CSR), it makes sense to delete the initial Symmetric version 
+       Since we passed the input as a pointer, we can easily deallocate it with "delete" */
+    delete matrix;
+    return converted_matrix;
+}
+
+// Function to convert a SparseMatrixCSR into a SparseMatrixMixed
+template <typename S, typename T>
+SparseMatrixMixed<T,S>* CSR_to_Mixed(SparseMatrixCSR<T> *matrix){
+    // Same structure, each value is rounded to the storage type (a value may round to zero: it is kept anyway)
+    const std::vector<T> &values = matrix->get_values();
+    std::vector<S> low_values(values.size());
+    for(unsigned int k=0; k<values.size(); k++){
+        low_values[k] = static_cast<S>(values[k]);
+    }
+    SparseMatrixMixed<T,S>* converted_matrix = new SparseMatrixMixed<T,S>{matrix->get_nrows(), matrix->get_ncols(),
+        low_values, matrix->get_cols(), matrix->get_rows_idx()};
+    converted_matrix->set_threads(matrix->get_threads());
+    /* Before returning the converted matrix(Mixed), it makes sense to delete the initial CSR version 
+       Since we passed the input as a pointer, we can easily deallocate it with "delete" */
+    delete matrix;
+    return converted_matrix;
+}
+
+// Function to convert a SparseMatrixMixed into a SparseMatrixCSR
+template <typename T, typename S>
+SparseMatrixCSR<T>* Mixed_to_CSR(SparseMatrixMixed<T,S> *matrix){
+    // The values go back to T exactly (but the rounding done by CSR_to_Mixed is not undone)
+    const std::vector<S> &low_values = matrix->get_low_values();
+    std::vector<T> values(low_values.size());
+    for(unsigned int k=0; k<low_values.size(); k++){
+        values[k] = static_cast<T>(low_values[k]);
+    }
+    SparseMatrixCSR<T>* converted_matrix = new SparseMatrixCSR<T>{matrix->get_nrows(), matrix->get_ncols(),
+        values, matrix->get_cols(), matrix->get_rows_idx()};
+    converted_matrix->set_threads(matrix->get_threads());
+    /* Before returning the converted matrix(CSR), it makes sense to delete the initial Mixed version 
+       Since we passed the input as a pointer, we can easily deallocate it with "delete" */
+    delete matrix;
+    return converted_matrix;
+}
+
+// Function to compare a mixed precision matrix with the full precision one
+template <typename T, typename S>
+PrecisionReport precision_report(const SparseMatrixCSR<T> &full, const SparseMatrixMixed<T,S> &mixed,
+                                 const std::vector<T> &x){
+    // The mixed precision matrix must have the same structure (e.g. it was built by CSR_to_Mixed from a copy of full)
+    assert(full.get_nrows()==mixed.get_nrows() && full.get_ncols()==mixed.get_ncols());
+    assert(full.get_cols()==mixed.get_cols() && full.get_rows_idx()==mixed.get_rows_idx());
+    PrecisionReport report;
+    if constexpr(std::is_same_v<S, bfloat16>){
+        report.unit_roundoff = 1./256;
+    }
+    else if constexpr(std::is_floating_point_v<S>){
+        report.unit_roundoff = std::numeric_limits<S>::epsilon()/2;
+    }
+    // (1) Rounding of the stored values
+    const std::vector<T> &values = full.get_values();
+    const std::vector<S> &low_values = mixed.get_low_values();
+    for(unsigned int k=0; k<values.size(); k++){
+        if(values[k]!=T(0)){
+            const double error = std::abs((double)(static_cast<T>(low_values[k])-values[k])/(double)values[k]);
+            report.max_value_error = std::max(report.max_value_error, error);
+        }
+    }
+    // (2) Error of the product
+    std::vector<T> y(full.get_nrows()), y_mixed(full.get_nrows());
+    full.multiply(T(1), x, T(0), y);
+    mixed.multiply(T(1), x, T(0), y_mixed);
+    double error_norm=0., norm=0.;
+    for(unsigned int i=0; i<y.size(); i++){
+        const double error = std::abs((double)(y[i]-y_mixed[i]));
+        report.max_abs_error = std::max(report.max_abs_error, error);
+        error_norm += error*error;
+        norm += (double)y[i]*(double)y[i];
+    }
+    report.relative_error = (norm>0.) ? std::sqrt(error_norm/norm) : std::sqrt(error_norm);
+    // (3) Bytes of the two matrices (the indices are the same)
+    const double index_bytes = values.size()*sizeof(unsigned int) + (full.get_nrows()+1.)*sizeof(unsigned int);
+    report.bytes_ratio = (values.size()*sizeof(S)+index_bytes)/(values.size()*sizeof(T)+index_bytes);
+    return report;
+}
+
+// Function to convert a SparseMatrixCSR into a SparseMatrixTiled
+template <typename T>
+SparseMatrixTiled<T>* CSR_to_Tiled(SparseMatrixCSR<T> *matrix, const unsigned int tile_width){
+    // (the threads are passed to the constructor, since the auto-tuning depends on them)
+    SparseMatrixTiled<T>* converted_matrix = new SparseMatrixTiled<T>{matrix->get_nrows(), matrix->get_ncols(),
+        matrix->get_values(), matrix->get_cols(), matrix->get_rows_idx(), tile_width, matrix->get_threads()};
+    /* Before returning the converted matrix(Tiled), it makes sense to delete the initial CSR version 
+       Since we passed the input as a pointer, we can easily deallocate it with "delete" */
+    delete matrix;
+    return converted_matrix;
+}
+
+// Function to convert a SparseMatrixTiled into a SparseMatrixCSR
+template <typename T>
+SparseMatrixCSR<T>* Tiled_to_CSR(SparseMatrixTiled<T> *matrix){
+    /* Each row is the concatenation of its parts in the tiles, in the order of the tiles (so the columns, local column
+       plus the first column of the tile, come out sorted): we count the rows lengths, then we walk the tiles in order
+       appending each stored row to its row */
+    const unsigned int n = matrix->get_nrows(), width = matrix->get_tile_width();
+    const std::vector<T> &values = matrix->get_values();
+    const std::vector<unsigned int> &cols = matrix->get_cols(), &tiles_idx = matrix->get_tiles_idx();
+    const std::vector<unsigned int> &tile_rows = matrix->get_tile_rows(), &row_ptr = matrix->get_row_ptr();
+    std::vector<unsigned int> new_rows_idx(n+1, 0);
+    for(unsigned int p=0; p<tile_rows.size(); p++){
+        new_rows_idx[tile_rows[p]+1] += row_ptr[p+1]-row_ptr[p];
+    }
+    for(unsigned int i=0; i<n; i++){
+        new_rows_idx[i+1] += new_rows_idx[i];
+    }
+    std::vector<T> new_values(new_rows_idx[n]);
+    std::vector<unsigned int> new_cols(new_rows_idx[n]);
+    std::vector<unsigned int> next(new_rows_idx.begin(), new_rows_idx.end()-1);
+    for(unsigned int t=0; t+1<tiles_idx.size(); t++){
+        for(unsigned int p=tiles_idx[t]; p<tiles_idx[t+1]; p++){
+            for(unsigned int k=row_ptr[p]; k<row_ptr[p+1]; k++){
+                new_values[next[tile_rows[p]]] = values[k];
+                new_cols[next[tile_rows[p]]++] = t*width+cols[k];
+            }
+        }
+    }
+    SparseMatrixCSR<T>* converted_matrix = new SparseMatrixCSR<T>{n, matrix->get_ncols(), new_values, new_cols,
+                                                                  new_rows_idx};
+    converted_matrix->set_threads(matrix->get_threads());
+    /* Before returning the converted matrix(CSR), it makes sense to delete the initial Tiled version 
+       Since we passed the input as a pointer, we can easily deallocate it with "delete" */
+    delete matrix;
+    return converted_matrix;
+}
+
+// Function to convert a SparseMatrixCSR into a SparseMatrixHYB
+template <typename T>
+SparseMatrixHYB<T>* CSR_to_HYB(SparseMatrixCSR<T> *matrix, const unsigned int ell_width){
+    SparseMatrixHYB<T>* converted_matrix = new SparseMatrixHYB<T>{matrix->get_nrows(), matrix->get_ncols(),
+        matrix->get_values(), matrix->get_cols(), matrix->get_rows_idx(), ell_width};
+    converted_matrix->set_threads(matrix->get_threads());
+    /* Before returning the converted matrix(HYB), it makes sense to delete the initial CSR version 
+       Since we passed the input as a pointer, we can easily deallocate it with "delete" */
+    delete matrix;
+    return converted_matrix;
+}
+
+// Function to convert a SparseMatrixHYB into a SparseMatrixCSR
+template <typename T>
+SparseMatrixCSR<T>* HYB_to_CSR(SparseMatrixHYB<T> *matrix){
+    /* Each row is its part of the slab followed by its part of the tail (the tail is sorted by row, so we just walk
+       through it): both parts are sorted, the CSR constructor sorts the rows where they overlap */
+    const unsigned int n = matrix->get_nrows();
+    const std::vector<T> &values = matrix->get_values(), &t_values = matrix->get_tail().get_values();
+    const std::vector<unsigned int> &cols = matrix->get_cols(), &t_cols = matrix->get_tail().get_cols();
+    const std::vector<unsigned int> &t_rows = matrix->get_tail().get_rows(), &ell_len = matrix->get_ell_len();
+    std::vector<T> new_values;
+    std::vector<unsigned int> new_cols, new_rows_idx(n+1, 0);
+    new_values.reserve(matrix->get_nzeros());
+    new_cols.reserve(matrix->get_nzeros());
+    unsigned int k = 0;
+    for(unsigned int i=0; i<n; i++){
+        for(unsigned int s=0; s<ell_len[i]; s++){
+            new_values.push_back(values[(size_t)s*n+i]);
+            new_cols.push_back(cols[(size_t)s*n+i]);
+        }
+        for(; k<t_rows.size() && t_rows[k]==i; k++){
+            new_values.push_back(t_values[k]);
+            new_cols.push_back(t_cols[k]);
+        }
+        new_rows_idx[i+1] = new_values.size();
+    }
+    SparseMatrixCSR<T>* converted_matrix = new SparseMatrixCSR<T>{n, matrix->get_ncols(), new_values, new_cols,
+                                                                  new_rows_idx};
+    converted_matrix->set_threads(matrix->get_threads());
+    /* Before returning the converted matrix(CSR), it makes sense to delete the initial HYB version 
        Since we passed the input as a pointer, we can easily deallocate it with "delete" */
     delete matrix;
     return converted_matrix;
@@ -0,0 +1,103 @@
+// Header guards
+#ifndef SPARSEVECTOR_HPP_
+#define SPARSEVECTOR_HPP_
+//---------------------------------------------------------------------------------------------------------------------
+// Libraries
+#include<vector>
+#include<utility>
+#include<algorithm>
+#include<thread>
+#include "SparseMatrix.hpp"
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T> class SpMSpV;
+
+//---------------------------------------------------------------------------------------------------------------------
+// (1) SparseVector class declaration
+/* Vector of size n that only stores its nonzeros: the index and the value of each one, sorted by index. It is meant
+   for very sparse vectors (e.g. the frontier of a breadth-first search), whose products should cost as much as
+   the nonzeros they touch, not as much as n */
+template <typename T>
+class SparseVector{
+public:
+    // Constructor (a vector of size n without nonzeros)
+    SparseVector(const unsigned int &n=0) : n(n) {};
+    // Constructor from the indices and the values of the nonzeros (in any order, repeated indices are summed)
+    SparseVector(const unsigned int &n, const std::vector<unsigned int> &idx, const std::vector<T> &vals);
+    // Constructor from a dense vector (its nonzeros)
+    explicit SparseVector(const std::vector<T> &dense);
+
+    // Method to get the size of the vector
+    unsigned int get_size()const{return n;}
+    // Method to get the number of stored nonzeros
+    unsigned int get_nzeros()const{return indices.size();}
+    // Methods to get the indices and the values of the nonzeros
+    const std::vector<unsigned int> &get_indices()const{return indices;}
+    const std::vector<T> &get_values()const{return values;}
+    // Method to copy the vector in a dense vector
+    std::vector<T> to_dense()const;
+    // Method to print the vector (index and value of each nonzero)
+    void print()const;
+
+private:
+    // The product writes its result directly in the vectors
+    friend class SpMSpV<T>;
+
+    // Attributes of the class SparseVector
+    unsigned int n;
+    std::vector<unsigned int> indices;
+    std::vector<T> values;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// (2) SpMSpV class declaration
+/* Product of a sparse matrix by a sparse vector, y = A*x with A in CSC or y = A^T*x with A in CSR (in both cases the
+   product reads the compressed columns of the matrix selected by the nonzeros of x). The results of the touched
+   columns are merged with a sparse accumulator: a dense value per row (allocated once and never cleared: a row is
+   valid if its stamp is the one of the current product) and the list of the rows reached, which is then sorted.
+   So a product costs O(touched nonzeros + k log k), k the nonzeros of y, and nothing proportional to n_rows.
+   With more threads the nonzeros of x are split among them by work, each thread sends its products to buckets
+   (ranges of rows), then each bucket is merged by one thread: the buckets are in order, so y comes out sorted */
+template <typename T>
+class SpMSpV{
+public:
+    // Constructor (the workspace is allocated by the first product)
+    SpMSpV() {};
+    // Destructor
+    ~SpMSpV() {std::cout<<"Destructed SpMSpV"<<std::endl;}
+
+    // Method to compute y = A*x (A in CSC)
+    void multiply(const SparseMatrixCSC<T> &matrix, const SparseVector<T> &x, SparseVector<T> &y);
+    // Method to compute y = A^T*x (A in CSR)
+    void multiply_transposed(const SparseMatrixCSR<T> &matrix, const SparseVector<T> &x, SparseVector<T> &y);
+    // Method to get the number of nonzeros of the matrix touched by the last product
+    unsigned long long get_touched()const{return touched;}
+    // Methods to get and set the number of threads used by the products (1 = serial, 0 = all available cores)
+    unsigned int get_threads()const{return n_threads;}
+    void set_threads(const unsigned int &nt){
+        n_threads = (nt==0) ? std::max(1u, std::thread::hardware_concurrency()) : nt;
+    }
+
+private:
+    /* Some helper functions to make the class methods easier both to implement and understand */
+    // (I) Helper function to compute the product with the compressed columns (ptr, idx, vals) of a matrix
+    void product(const std::vector<unsigned int> &ptr, const std::vector<unsigned int> &idx, const std::vector<T> &vals,
+                 const unsigned int n_out, const SparseVector<T> &x, SparseVector<T> &y);
+    // (II) Helper function to start a new product (new stamp, workspace of at least n_out rows)
+    void newStamp(const unsigned int n_out);
+    // (III) Helper function to add a value to the row i of the accumulator (it returns true if i is new)
+    bool accumulate(const unsigned int i, const T value);
+
+    // Attributes of the class SpMSpV
+    std::vector<T> accumulator;              // value of each row reached by the current product
+    std::vector<unsigned int> stamp;         // stamp of the last product that reached each row
+    unsigned int current_stamp=0;
+    unsigned long long touched=0;
+    // Number of threads used by the products (by default we keep the serial version)
+    unsigned int n_threads=1;
+    // Products with less work per thread than this are computed serially
+    static constexpr unsigned int MIN_WORK_PER_THREAD = 4096;
+};
+//---------------------------------------------------------------------------------------------------------------------
+//Link to the definition file
+#include "SparseVector.tpl.hpp"
+#endif
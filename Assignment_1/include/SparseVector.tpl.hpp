@@ -0,0 +1,176 @@
+//---------------------------------------------------------------------------------------------------------------------
+// (1) SparseVector definitions
+// SparseVector constructor from indices and values
+template <typename T>
+SparseVector<T>::SparseVector(const unsigned int &n, const std::vector<unsigned int> &idx, const std::vector<T> &vals)
+    : n(n) {
+    assert(idx.size()==vals.size());
+    // Sort the nonzeros by index (through a permutation), then sum the repeated ones
+    std::vector<unsigned int> perm(idx.size());
+    for(unsigned int k=0; k<perm.size(); k++){
+        assert(idx[k]<n);
+        perm[k] = k;
+    }
+    std::stable_sort(perm.begin(), perm.end(), [&](const unsigned int a, const unsigned int b){return idx[a]<idx[b];});
+    for(const unsigned int k : perm){
+        if(!indices.empty() && indices.back()==idx[k]){
+            values.back() += vals[k];
+        }
+        else{
+            indices.push_back(idx[k]);
+            values.push_back(vals[k]);
+        }
+    }
+}
+
+// SparseVector constructor from a dense vector
+template <typename T>
+SparseVector<T>::SparseVector(const std::vector<T> &dense) : n(dense.size()) {
+    for(unsigned int i=0; i<n; i++){
+        if(dense[i]!=T(0)){
+            indices.push_back(i);
+            values.push_back(dense[i]);
+        }
+    }
+}
+
+// Method to copy a SparseVector in a dense vector
+template <typename T>
+std::vector<T> SparseVector<T>::to_dense()const{
+    std::vector<T> dense(n, T(0));
+    for(unsigned int k=0; k<indices.size(); k++){
+        dense[indices[k]] = values[k];
+    }
+    return dense;
+}
+
+// Method to print a SparseVector
+template <typename T>
+void SparseVector<T>::print()const{
+    std::cout<<"Sparse vector of size "<<n<<" with "<<indices.size()<<" nonzeros: ";
+    for(unsigned int k=0; k<indices.size(); k++){
+        std::cout<<"["<<indices[k]<<"] = "<<values[k]<<"  ";
+    }
+    std::cout<<std::endl;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// (2) SpMSpV definitions
+// Method to compute y = A*x with A in CSC
+template <typename T>
+void SpMSpV<T>::multiply(const SparseMatrixCSC<T> &matrix, const SparseVector<T> &x, SparseVector<T> &y){
+    assert(x.get_size()==matrix.get_ncols() && &x!=&y);
+    product(matrix.get_cols_idx(), matrix.get_rows(), matrix.get_values(), matrix.get_nrows(), x, y);
+}
+
+// Method to compute y = A^T*x with A in CSR
+template <typename T>
+void SpMSpV<T>::multiply_transposed(const SparseMatrixCSR<T> &matrix, const SparseVector<T> &x, SparseVector<T> &y){
+    // The rows of A are the columns of A^T
+    assert(x.get_size()==matrix.get_nrows() && &x!=&y);
+    product(matrix.get_rows_idx(), matrix.get_cols(), matrix.get_values(), matrix.get_ncols(), x, y);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// (I) SpMSpV Helper function to compute the product with the compressed columns of a matrix
+template <typename T>
+void SpMSpV<T>::product(const std::vector<unsigned int> &ptr, const std::vector<unsigned int> &idx,
+                        const std::vector<T> &vals, const unsigned int n_out, const SparseVector<T> &x,
+                        SparseVector<T> &y){
+    const std::vector<unsigned int> &x_indices = x.get_indices();
+    const std::vector<T> &x_values = x.get_values();
+    const unsigned int x_nnz = x_indices.size();
+    // Work of each nonzero of x (the length of its column), cumulative (as rows_idx)
+    std::vector<unsigned int> work(x_nnz+1, 0);
+    for(unsigned int k=0; k<x_nnz; k++){
+        work[k+1] = work[k] + ptr[x_indices[k]+1] - ptr[x_indices[k]];
+    }
+    touched = work[x_nnz];
+    newStamp(n_out);
+    y.n = n_out;
+    y.indices.clear();
+    y.values.clear();
+    if(n_threads<=1 || touched<(unsigned long long)n_threads*MIN_WORK_PER_THREAD){
+        // Serial version: all the products in the accumulator, then the rows reached are sorted
+        for(unsigned int k=0; k<x_nnz; k++){
+            const unsigned int j = x_indices[k];
+            for(unsigned int l=ptr[j]; l<ptr[j+1]; l++){
+                if(accumulate(idx[l], vals[l]*x_values[k])){
+                    y.indices.push_back(idx[l]);
+                }
+            }
+        }
+        std::sort(y.indices.begin(), y.indices.end());
+    }
+    else{
+        /* Parallel version. (1) Each thread takes a block of nonzeros of x with the same work and sends each
+           product (row, value) to the bucket of its row: the bucket b has the rows [n_out*b/B, n_out*(b+1)/B) */
+        const unsigned int n_buckets = n_threads;
+        std::vector<std::vector<std::pair<unsigned int, T>>> buckets((size_t)n_threads*n_buckets);
+        std::vector<unsigned int> bounds = nnz_partition(work, n_threads);
+        run_blocks(bounds, [&](const unsigned int first, const unsigned int last){
+            const unsigned int t = std::upper_bound(bounds.begin(), bounds.end(), first) - bounds.begin() - 1;
+            for(unsigned int k=first; k<last; k++){
+                const unsigned int j = x_indices[k];
+                for(unsigned int l=ptr[j]; l<ptr[j+1]; l++){
+                    const unsigned int b = (unsigned long long)idx[l]*n_buckets/n_out;
+                    buckets[(size_t)t*n_buckets+b].push_back({idx[l], vals[l]*x_values[k]});
+                }
+            }
+        });
+        /* (2) Each bucket is merged by one thread (the buckets have disjoint rows, so the threads share the
+           accumulator without conflicts), in the order of the blocks of x, as the serial version does */
+        std::vector<std::vector<unsigned int>> rows(n_buckets);
+        std::vector<unsigned int> all_buckets(n_buckets+1);
+        for(unsigned int b=0; b<=n_buckets; b++){
+            all_buckets[b] = b;
+        }
+        run_blocks(all_buckets, [&](const unsigned int b, const unsigned int){
+            for(unsigned int t=0; t<n_threads; t++){
+                for(const std::pair<unsigned int, T> &entry : buckets[(size_t)t*n_buckets+b]){
+                    if(accumulate(entry.first, entry.second)){
+                        rows[b].push_back(entry.first);
+                    }
+                }
+            }
+            std::sort(rows[b].begin(), rows[b].end());
+        });
+        for(unsigned int b=0; b<n_buckets; b++){
+            y.indices.insert(y.indices.end(), rows[b].begin(), rows[b].end());
+        }
+    }
+    y.values.resize(y.indices.size());
+    for(unsigned int k=0; k<y.indices.size(); k++){
+        y.values[k] = accumulator[y.indices[k]];
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// (II) SpMSpV Helper function to start a new product
+    /*The workspace only grows (its O(n_out) allocation is paid by the first product); when the stamps wrap around
+      they are cleared, so the stamp of the new product is not left by an old one*/
+template <typename T>
+void SpMSpV<T>::newStamp(const unsigned int n_out){
+    if(accumulator.size()<n_out){
+        accumulator.resize(n_out);
+        stamp.resize(n_out, 0);
+    }
+    current_stamp++;
+    if(current_stamp==0){
+        std::fill(stamp.begin(), stamp.end(), 0);
+        current_stamp = 1;
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// (III) SpMSpV Helper function to add a value to the row i of the accumulator
+template <typename T>
+bool SpMSpV<T>::accumulate(const unsigned int i, const T value){
+    if(stamp[i]!=current_stamp){
+        stamp[i] = current_stamp;
+        accumulator[i] = value;
+        return true;
+    }
+    accumulator[i] += value;
+    return false;
+}
@@ -0,0 +1,96 @@
+// Header guards
+#ifndef TRIANGULARSOLVE_HPP_
+#define TRIANGULARSOLVE_HPP_
+//---------------------------------------------------------------------------------------------------------------------
+// Libraries
+#include<vector>
+#include<atomic>
+#include<thread>
+#include<string>
+#include<stdexcept>
+#include "SparseMatrix.hpp"
+//---------------------------------------------------------------------------------------------------------------------
+// Triangle of the matrix used by the solve
+enum class Triangle {Lower, Upper};
+
+//---------------------------------------------------------------------------------------------------------------------
+// SpTRSV class declaration
+/* Sparse triangular solve T*x = b, where T is the lower (or upper) triangle of a square CSR matrix: the elements
+   outside the triangle are ignored, so the same matrix can hold both factors of an LU factorization, and with
+   unit_diagonal the diagonal is taken as 1 (not read). The constructor does the analysis: the level of each row
+   is 1 + the maximum level of the rows it depends on, so all the rows of a level only depend on earlier levels
+   and can be solved at the same time. The rows are then stored level by level (a CSR copy of the triangle, without
+   the diagonal, in the order of the levels), so each solve goes through the levels and splits the rows of each
+   (large enough) level among the threads, which are created once per solve and wait for each other between levels.
+   The analysis is done once: solve() can be called any number of times, and update() changes the values (same
+   pattern) without analyzing the matrix again. Without unit_diagonal, a diagonal element that is not stored (or
+   is zero) makes the constructor (or update) throw std::invalid_argument */
+template <typename T>
+class SpTRSV{
+public:
+    // Constructor (from a CSR matrix)
+    SpTRSV(const SparseMatrixCSR<T> &matrix,
+           const Triangle &triangle=Triangle::Lower,
+           const bool &unit_diagonal=false);
+    // Constructor (from the CSR vectors of a square matrix, with columns sorted inside each row)
+    SpTRSV(const unsigned int &n,
+           const std::vector<T> &d,
+           const std::vector<unsigned int> &c,
+           const std::vector<unsigned int> &r,
+           const Triangle &triangle=Triangle::Lower,
+           const bool &unit_diagonal=false);
+    // Destructor
+    ~SpTRSV() {std::cout<<"Destructed SpTRSV"<<std::endl;}
+
+    // Method to get the number of rows
+    unsigned int get_nrows()const{return n;}
+    // Method to get the number of levels
+    unsigned int get_nlevels()const{return levels_idx.size()-1;}
+    // Method to get the levels (the rows of the l-th level are order[levels_idx[l]:levels_idx[l+1]])
+    const std::vector<unsigned int> &get_levels_idx()const{return levels_idx;}
+    // Method to get the rows in the order of the levels
+    const std::vector<unsigned int> &get_order()const{return order;}
+    // Methods to get and set the number of threads used by the solve (1 = serial, 0 = all available cores)
+    unsigned int get_threads()const{return n_threads;}
+    void set_threads(const unsigned int &nt){
+        n_threads = (nt==0) ? std::max(1u, std::thread::hardware_concurrency()) : nt;
+    }
+    // Method to print information about the analysis (levels and rows per level)
+    void get_info() const;
+    // Method to solve T*x = b (x can be b itself: the solve is then in place)
+    void solve(const std::vector<T> &b, std::vector<T> &x) const;
+    // Same method on raw buffers (of length n)
+    void solve(const T *b, T *x) const;
+    // Method to change the values of the matrix (d must have the pattern of the vectors given to the constructor)
+    void update(const std::vector<T> &d);
+
+private:
+    /* Some helper functions to make the class methods easier both to implement and understand */
+    // (I) Helper function to compute the levels and to store the triangle in the order of the levels
+    void analyze(const std::vector<unsigned int> &c, const std::vector<unsigned int> &r);
+    // (II) Helper function to solve the rows in the positions [first,last) of the order of the levels
+    void solve_rows(const unsigned int first, const unsigned int last, const T *b, T *x) const;
+
+    // Attributes of the class SpTRSV
+    unsigned int n;
+    Triangle triangle;
+    bool unit_diagonal;
+    std::vector<unsigned int> levels_idx;    // position (in order) of the first row of each level
+    std::vector<unsigned int> order;         // row in each position (rows sorted by level)
+    // Triangle without the diagonal in the order of the levels (CSR), and inverse of the diagonal of each position
+    std::vector<T> values;
+    std::vector<unsigned int> cols;
+    std::vector<unsigned int> rows_idx;
+    std::vector<T> inv_diag;
+    // Position (in the vector of values given to the constructor) of each stored value and of each diagonal element
+    std::vector<unsigned int> source;
+    std::vector<unsigned int> diag_source;
+    // Number of threads used by the solve (by default we keep the serial version)
+    unsigned int n_threads=1;
+    // Levels with fewer rows per thread than this are solved by one thread (a barrier would cost more than its rows)
+    static constexpr unsigned int MIN_ROWS_PER_THREAD = 64;
+};
+//---------------------------------------------------------------------------------------------------------------------
+//Link to the definition file
+#include "TriangularSolve.tpl.hpp"
+#endif
@@ -0,0 +1,207 @@
+//---------------------------------------------------------------------------------------------------------------------
+// SpTRSV definitions
+// SpTRSV constructor (from a CSR matrix)
+template <typename T>
+SpTRSV<T>::SpTRSV(const SparseMatrixCSR<T> &matrix,
+                  const Triangle &triangle,
+                  const bool &unit_diagonal) :
+    SpTRSV(matrix.get_nrows(), matrix.get_values(), matrix.get_cols(), matrix.get_rows_idx(), triangle, unit_diagonal) {
+    // A triangular solve needs a square matrix
+    assert(matrix.get_nrows()==matrix.get_ncols());
+}
+
+// SpTRSV constructor (from the CSR vectors)
+template <typename T>
+SpTRSV<T>::SpTRSV(const unsigned int &n,
+                  const std::vector<T> &d,
+                  const std::vector<unsigned int> &c,
+                  const std::vector<unsigned int> &r,
+                  const Triangle &triangle,
+                  const bool &unit_diagonal) : n(n), triangle(triangle), unit_diagonal(unit_diagonal) {
+    assert(r.size()==n+1 && r.back()==d.size() && c.size()==d.size());
+    analyze(c, r);
+    update(d);
+}
+
+// Method to print information about the analysis of a SpTRSV
+template <typename T>
+void SpTRSV<T>::get_info() const{
+    std::cout<<std::endl;
+    std::cout<<(triangle==Triangle::Lower ? "Lower" : "Upper")<<" triangle"<<(unit_diagonal ? " (unit diagonal)" : "")
+             <<": "<<n<<" rows, "<<values.size()<<" nonzeros outside the diagonal"<<std::endl;
+    unsigned int largest = 0;
+    for(unsigned int l=0; l<get_nlevels(); l++){
+        largest = std::max(largest, levels_idx[l+1]-levels_idx[l]);
+    }
+    std::cout<<"Levels: "<<get_nlevels()<<" (rows per level: mean "
+             <<(get_nlevels()>0 ? (double)n/get_nlevels() : 0.)<<", maximum "<<largest<<")"<<std::endl;
+}
+
+// Method to solve T*x = b
+template <typename T>
+void SpTRSV<T>::solve(const std::vector<T> &b, std::vector<T> &x) const{
+    assert(b.size()==n && x.size()==n);
+    solve(b.data(), x.data());
+}
+
+// Method to solve T*x = b on raw buffers
+template <typename T>
+void SpTRSV<T>::solve(const T *b, T *x) const{
+    if(n_threads<=1){
+        solve_rows(0, n, b, x);
+        return;
+    }
+    /* The rows of a level only read the solution of earlier levels, so the levels are solved one after the other
+       and the rows of each level are split among the threads. Creating the threads for each level would cost more
+       than most levels, so the threads are created once and wait for each other (barrier) at the end of each
+       stage: a large level, or a group of consecutive small levels that the first thread solves alone */
+    std::vector<unsigned int> stages{0};
+    std::vector<bool> parallel;
+    for(unsigned int l=0; l<get_nlevels(); l++){
+        const unsigned int first = levels_idx[l], last = levels_idx[l+1];
+        if(last-first >= n_threads*MIN_ROWS_PER_THREAD){
+            if(stages.back()<first){
+                stages.push_back(first);
+                parallel.push_back(false);
+            }
+            stages.push_back(last);
+            parallel.push_back(true);
+        }
+    }
+    if(stages.back()<n){
+        stages.push_back(n);
+        parallel.push_back(false);
+    }
+    if(stages.size()==2 && !parallel[0]){
+        solve_rows(0, n, b, x);
+        return;
+    }
+    std::atomic<unsigned int> arrived{0}, generation{0};
+    auto barrier = [&](){
+        const unsigned int current = generation.load();
+        if(arrived.fetch_add(1)+1==n_threads){
+            arrived.store(0);
+            generation.fetch_add(1);
+        }
+        else{
+            while(generation.load()==current){
+                std::this_thread::yield();
+            }
+        }
+    };
+    std::vector<unsigned int> threads(n_threads+1);
+    for(unsigned int t=0; t<=n_threads; t++){
+        threads[t] = t;
+    }
+    run_blocks(threads, [&](const unsigned int t, const unsigned int){
+        for(unsigned int s=0; s+1<stages.size(); s++){
+            const unsigned int first = stages[s], last = stages[s+1];
+            if(!parallel[s]){
+                if(t==0){
+                    solve_rows(first, last, b, x);
+                }
+            }
+            else{
+                solve_rows(first + (unsigned long long)(last-first)*t/n_threads,
+                           first + (unsigned long long)(last-first)*(t+1)/n_threads, b, x);
+            }
+            barrier();
+        }
+    });
+}
+
+// Method to change the values of the matrix of a SpTRSV
+template <typename T>
+void SpTRSV<T>::update(const std::vector<T> &d){
+    // The analysis only depends on the pattern: we just copy each value in its place
+    for(unsigned int k=0; k<values.size(); k++){
+        values[k] = d[source[k]];
+    }
+    for(unsigned int p=0; p<n; p++){
+        if(unit_diagonal){
+            inv_diag[p] = T(1);
+        }
+        else{
+            // The diagonal element is stored (checked by analyze) and it must be nonzero
+            if(d[diag_source[p]]==T(0)){
+                throw std::invalid_argument("SpTRSV: the diagonal element of row "+std::to_string(order[p])+" is zero");
+            }
+            inv_diag[p] = T(1)/d[diag_source[p]];
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// (I) SpTRSV Helper function to compute the levels
+    /*Lower triangle: the row i depends on the rows j<i of its nonzeros, so visiting the rows in increasing order the
+      levels of its dependencies are already known (level = 1 + their maximum, 0 without dependencies). Upper triangle:
+      the same in decreasing order. The rows are then sorted by level with a counting sort (stable, so inside
+      a level they keep their order) and the triangle is copied in that order*/
+template <typename T>
+void SpTRSV<T>::analyze(const std::vector<unsigned int> &c, const std::vector<unsigned int> &r){
+    const bool lower = (triangle==Triangle::Lower);
+    auto in_triangle = [&](const unsigned int i, const unsigned int j){return lower ? j<i : j>i;};
+    std::vector<unsigned int> level(n, 0);
+    unsigned int n_levels = (n>0) ? 1 : 0;
+    for(unsigned int step=0; step<n; step++){
+        const unsigned int i = lower ? step : n-1-step;
+        for(unsigned int k=r[i]; k<r[i+1]; k++){
+            if(in_triangle(i, c[k])){
+                level[i] = std::max(level[i], level[c[k]]+1);
+            }
+        }
+        n_levels = std::max(n_levels, level[i]+1);
+    }
+    // Counting sort of the rows by level (in the order of the solve, so each level is in the order of the rows)
+    levels_idx.assign(n_levels+1, 0);
+    for(unsigned int i=0; i<n; i++){
+        levels_idx[level[i]+1]++;
+    }
+    for(unsigned int l=0; l<n_levels; l++){
+        levels_idx[l+1] += levels_idx[l];
+    }
+    order.resize(n);
+    std::vector<unsigned int> next(levels_idx.begin(), levels_idx.end()-1);
+    for(unsigned int step=0; step<n; step++){
+        const unsigned int i = lower ? step : n-1-step;
+        order[next[level[i]]++] = i;
+    }
+    // Copy of the pattern of the triangle (diagonal apart) in the order of the levels
+    rows_idx.assign(n+1, 0);
+    cols.clear();
+    source.clear();
+    diag_source.assign(n, r.back());
+    for(unsigned int p=0; p<n; p++){
+        const unsigned int i = order[p];
+        for(unsigned int k=r[i]; k<r[i+1]; k++){
+            if(in_triangle(i, c[k])){
+                cols.push_back(c[k]);
+                source.push_back(k);
+            }
+            else if(c[k]==i){
+                diag_source[p] = k;
+            }
+        }
+        rows_idx[p+1] = cols.size();
+        // Without unit_diagonal every row needs its diagonal element (checked also without asserts)
+        if(!unit_diagonal && diag_source[p]==r.back()){
+            throw std::invalid_argument("SpTRSV: the diagonal element of row "+std::to_string(i)+" is not stored");
+        }
+    }
+    values.resize(cols.size());
+    inv_diag.resize(n);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// (II) SpTRSV Helper function to solve the rows in the positions [first,last)
+template <typename T>
+void SpTRSV<T>::solve_rows(const unsigned int first, const unsigned int last, const T *b, T *x) const{
+    for(unsigned int p=first; p<last; p++){
+        const unsigned int i = order[p];
+        T sum = b[i];
+        for(unsigned int k=rows_idx[p]; k<rows_idx[p+1]; k++){
+            sum -= values[k]*x[cols[k]];
+        }
+        x[i] = sum*inv_diag[p];
+    }
+}
@@ -0,0 +1,47 @@
+// Header guards
+#ifndef BFLOAT16_HPP_
+#define BFLOAT16_HPP_
+//---------------------------------------------------------------------------------------------------------------------
+// Libraries
+#include<cstdint>
+#include<cstring>
+#include<iostream>
+//---------------------------------------------------------------------------------------------------------------------
+// bfloat16 struct declaration
+/* 16-bit "brain" floating point: the upper half of a float (1 sign bit, the same 8 exponent bits, 7 mantissa bits),
+   so it has the range of float with about 3 significant digits. Converting to float is just a shift; converting
+   from float rounds to the nearest value (ties to even). It is only a storage type: arithmetic is done in float
+   (or double) after the conversion */
+struct bfloat16{
+    std::uint16_t bits=0;
+
+    // Constructors
+    bfloat16() = default;
+    explicit bfloat16(const float value){
+        std::uint32_t u;
+        std::memcpy(&u, &value, sizeof(u));
+        if((u & 0x7fffffffu) > 0x7f800000u){
+            // NaN: keep it a (quiet) NaN, rounding could turn it into infinity
+            bits = (u >> 16) | 0x0040u;
+        }
+        else{
+            bits = (u + 0x7fffu + ((u >> 16) & 1u)) >> 16;
+        }
+    }
+    explicit bfloat16(const double value) : bfloat16(static_cast<float>(value)) {};
+
+    // Conversion to float (exact)
+    operator float() const{
+        const std::uint32_t u = std::uint32_t(bits) << 16;
+        float value;
+        std::memcpy(&value, &u, sizeof(value));
+        return value;
+    }
+};
+
+// Output operator (the value, as a float)
+inline std::ostream &operator<<(std::ostream &os, const bfloat16 &value){
+    return os << static_cast<float>(value);
+}
+//---------------------------------------------------------------------------------------------------------------------
+#endif
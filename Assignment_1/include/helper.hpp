@@ -7,10 +7,15 @@
     /*We adopt the following convention:
         - if the element is non zero-->return its index in the values vector
         - if the element is zero (so it does not belong to the values vector)-->return -1
+      With the hash index we look for the key (i,j) in its slot (O(1) expected), otherwise we scan all the nonzeros
     */
-template <typename T>
-const int SparseMatrixCOO<T>::findIndex(const unsigned int i, const unsigned int j) const {
-        for (unsigned int k = 0; k < this->values.size(); k++) {
+template <typename T, typename I, typename P>
+const long long SparseMatrixCOO<T,I,P>::findIndex(const unsigned int i, const unsigned int j) const {
+        if (is_indexed()) {
+            std::size_t slot = findSlot(i, j);
+            return (index_keys[slot] == EMPTY_KEY) ? -1 : (long long)index_pos[slot];
+        }
+        for (P k = 0; k < this->values.size(); k++) {
             if (this->rows[k] == i && this->cols[k] == j) {
                 return k;
             }
@@ -19,9 +24,9 @@ const int SparseMatrixCOO<T>::findIndex(const unsigned int i, const unsigned int
     }
 //---------------------------------------------------------------------------------------------------------------------
 // (II) COO Helper function to get the value at position (i, j)
-template <typename T>
-const T SparseMatrixCOO<T>::getValue(const unsigned int i, const unsigned int j) const {
-        int index = findIndex(i, j);
+template <typename T, typename I, typename P>
+const T SparseMatrixCOO<T,I,P>::getValue(const unsigned int i, const unsigned int j) const {
+        long long index = findIndex(i, j);
         // Remember findIndex convention
         if (index != -1) { //if the value is nonzero
             return this->values[index];
@@ -30,13 +35,38 @@ const T SparseMatrixCOO<T>::getValue(const unsigned int i, const unsigned int j)
     }
 //---------------------------------------------------------------------------------------------------------------------
 // (III) COO Helper function to set the new value at position (i, j)
-template <typename T>
-void SparseMatrixCOO<T>::setValue(const unsigned int i, const unsigned int j, const T value) {
-    int index = findIndex(i, j);
+    /*With the hash index, the index is updated together with the vectors: a removed element is replaced by the
+      last one (so nothing is shifted and only the slot of the moved element changes), a new one is appended.
+      If the vectors had duplicates of (i,j), another occurrence takes the place of the removed one in the index,
+      as the linear search would find it*/
+template <typename T, typename I, typename P>
+void SparseMatrixCOO<T,I,P>::setValue(const unsigned int i, const unsigned int j, const T value) {
+    long long index = findIndex(i, j);
     // Basing on the value that we insert, there are 2 cases
     // Case 1: the value that we want to insert is 0
     if (value == 0) {
-        if (index != -1) {
+        if (index != -1 && is_indexed()) {
+            // Move the last element in the place of the removed one, then drop the last slot of the vectors
+            eraseSlot(findSlot(i, j));
+            P last = this->values.size() - 1;
+            if ((P)index != last) {
+                this->values[index] = this->values[last];
+                this->rows[index] = this->rows[last];
+                this->cols[index] = this->cols[last];
+                // The slot is updated only if the moved element is the indexed one (and not a duplicate)
+                std::size_t slot = findSlot(this->rows[index], this->cols[index]);
+                if (index_keys[slot] != EMPTY_KEY && index_pos[slot] == last) {
+                    index_pos[slot] = index;
+                }
+            }
+            this->values.pop_back();
+            this->rows.pop_back();
+            this->cols.pop_back();
+            if (index_duplicates > 0) {
+                reindexDuplicate(i, j);
+            }
+        }
+        else if (index != -1) {
             // If the value is 0 and the element to replace is nonzero, remove it from the values vector
             this->values.erase(this->values.begin() + index);
             this->rows.erase(this->rows.begin() + index);
@@ -55,25 +85,121 @@ void SparseMatrixCOO<T>::setValue(const unsigned int i, const unsigned int j, co
             this->values.push_back(value);
             this->rows.push_back(i);
             this->cols.push_back(j);
+            if (is_indexed()) {
+                // Keep the load factor below 1/2, otherwise the index is rebuilt with twice the slots
+                if (2*this->values.size() > index_keys.size()) {
+                    rebuildIndex(2*index_keys.size());
+                }
+                else {
+                    std::size_t slot = findSlot(i, j);
+                    index_keys[slot] = ((unsigned long long)i << 32) | j;
+                    index_pos[slot] = this->values.size() - 1;
+                }
+            }
         }
     }
 }
 //---------------------------------------------------------------------------------------------------------------------
-// (I) CSR Helper function to find the index of an element at position (i, j)
-template <typename T>
-const int SparseMatrixCSR<T>::findIndex(const unsigned int i, const unsigned int j) const {
-    for(unsigned int k=this->rows_idx[i]; k<this->rows_idx[i+1]; k++) {
-        if(this->cols[k] == j) {
-            return k;
+// (VI) COO Helper function to get the home slot of a key in the hash index
+    /*The packed key is mixed (splitmix64 finalizer, so that close rows/columns end up far apart)
+      and its lowest bits give the slot where the probe sequence starts*/
+template <typename T, typename I, typename P>
+std::size_t SparseMatrixCOO<T,I,P>::homeSlot(const unsigned long long key) const {
+    unsigned long long h = key;
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    h = h ^ (h >> 31);
+    return h & (index_keys.size() - 1);
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (VII) COO Helper function to find the slot of the key (i, j) in the hash index
+    /*Starting from the home slot, we move to the next slot until we find the key or an empty slot*/
+template <typename T, typename I, typename P>
+std::size_t SparseMatrixCOO<T,I,P>::findSlot(const unsigned int i, const unsigned int j) const {
+    const unsigned long long key = ((unsigned long long)i << 32) | j;
+    const std::size_t mask = index_keys.size() - 1;
+    std::size_t slot = homeSlot(key);
+    while (index_keys[slot] != EMPTY_KEY && index_keys[slot] != key) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (VIII) COO Helper function to rebuild the hash index
+    /*If the same (i,j) appears more than once in the vectors, the index points to its first occurrence
+      (the same element found by the linear search) and the other ones are counted in index_duplicates*/
+template <typename T, typename I, typename P>
+void SparseMatrixCOO<T,I,P>::rebuildIndex(const std::size_t n_slots) {
+    index_keys.assign(n_slots, EMPTY_KEY);
+    index_pos.assign(n_slots, 0);
+    index_duplicates = 0;
+    for (P k = 0; k < this->values.size(); k++) {
+        std::size_t slot = findSlot(this->rows[k], this->cols[k]);
+        if (index_keys[slot] == EMPTY_KEY) {
+            index_keys[slot] = ((unsigned long long)this->rows[k] << 32) | this->cols[k];
+            index_pos[slot] = k;
+        }
+        else {
+            index_duplicates++;
+        }
+    }
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (IX) COO Helper function to remove the key in a slot of the hash index
+    /*With linear probing we cannot just empty the slot: a later key of the same probe sequence would not be found
+      anymore. So we scan the following (non-empty) slots and we move back into the hole every key whose home slot
+      is not between the hole and its current slot (cyclically); the last hole is the one that becomes empty*/
+template <typename T, typename I, typename P>
+void SparseMatrixCOO<T,I,P>::eraseSlot(std::size_t slot) {
+    const std::size_t mask = index_keys.size() - 1;
+    std::size_t next = (slot + 1) & mask;
+    while (index_keys[next] != EMPTY_KEY) {
+        const std::size_t home = homeSlot(index_keys[next]);
+        if (((next - home) & mask) >= ((next - slot) & mask)) {
+            index_keys[slot] = index_keys[next];
+            index_pos[slot] = index_pos[next];
+            slot = next;
         }
+        next = (next + 1) & mask;
+    }
+    index_keys[slot] = EMPTY_KEY;
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (X) COO Helper function to index another occurrence of (i, j) after the indexed one was removed
+    /*Duplicates only come from the vectors given to the constructor (setValue never adds an (i,j) that is already
+      stored), so this O(nnz) scan runs only while some of them are left out of the index: once they are all
+      indexed (or removed) index_duplicates is 0 and removals go back to O(1)*/
+template <typename T, typename I, typename P>
+void SparseMatrixCOO<T,I,P>::reindexDuplicate(const unsigned int i, const unsigned int j) {
+    for (P k = 0; k < this->values.size(); k++) {
+        if (this->rows[k] == i && this->cols[k] == j) {
+            std::size_t slot = findSlot(i, j);
+            index_keys[slot] = ((unsigned long long)i << 32) | j;
+            index_pos[slot] = k;
+            index_duplicates--;
+            return;
+        }
+    }
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (I) CSR Helper function to find the index of an element at position (i, j)
+    /*Columns are sorted inside each row, so we look for the first column >= j of the row (binary search, or
+      vectorized counting for short rows, see "simd.hpp"): O(log row_nnz) instead of a scan of the whole row*/
+template <typename T, typename I, typename P>
+const long long SparseMatrixCSR<T,I,P>::findIndex(const unsigned int i, const unsigned int j) const {
+    const P first = this->rows_idx[i];
+    const unsigned int len = this->rows_idx[i+1] - first;
+    const unsigned int pos = sorted_lower_bound(this->cols.data() + first, len, (I)j);
+    if(pos < len && this->cols[first+pos] == j) {
+        return first + pos;
     }
     return -1;
 }
 //---------------------------------------------------------------------------------------------------------------------
 // (II) CSR Helper function to get the value at position (i, j)
-template <typename T>
-const T SparseMatrixCSR<T>::getValue(const unsigned int i, const unsigned int j) const {
-    int index = findIndex(i, j);
+template <typename T, typename I, typename P>
+const T SparseMatrixCSR<T,I,P>::getValue(const unsigned int i, const unsigned int j) const {
+    long long index = findIndex(i, j);
     if(index!= -1) {
         return this->values[index];
     }
@@ -81,9 +207,9 @@ const T SparseMatrixCSR<T>::getValue(const unsigned int i, const unsigned int j)
 }
 //---------------------------------------------------------------------------------------------------------------------
 // (III) CSR Helper function to set the new value at position (i, j)
-template <typename T>
-void SparseMatrixCSR<T>::setValue(const unsigned int i, const unsigned int j, const T value) {
-    int index = findIndex(i, j);
+template <typename T, typename I, typename P>
+void SparseMatrixCSR<T,I,P>::setValue(const unsigned int i, const unsigned int j, const T value) {
+    long long index = findIndex(i, j);
     // Basing on the value that we insert, there are 2 cases:
     // Case 1: the value that we want to insert is 0
     if(value == 0) {
@@ -106,10 +232,10 @@ void SparseMatrixCSR<T>::setValue(const unsigned int i, const unsigned int j, co
         }
         else {
             // If the value is non-zero and the element to replace was 0, we need to add it to the values vector
-            unsigned int position = this->rows_idx[i];
-            while(this->cols[position] < j) {
-                position++;
-            }
+            // (in its sorted position inside the row, so the columns of the row stay sorted)
+            P position = this->rows_idx[i] + sorted_lower_bound(this->cols.data() + this->rows_idx[i],
+                                                                (unsigned int)(this->rows_idx[i+1] - this->rows_idx[i]),
+                                                                (I)j);
             this->values.insert(this->values.begin() + position, value);
             this->cols.insert(this->cols.begin() + position, j);
             for (unsigned int k = i+1; k < this->rows_idx.size(); k++){
@@ -117,4 +243,925 @@ void SparseMatrixCSR<T>::setValue(const unsigned int i, const unsigned int j, co
             }
         }
     }
-}
\ No newline at end of file
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (VI) CSR Helper function to compute the matrix-vector product restricted to the rows [first,last)
+    /*This is a simplified version of the classic matrix-vector product which consider just nonzero values!
+      As seen in print function, to get nonzero values coordinates we just need to:
+        - iterate over rows;
+        - for each row, consider the column "range" [ rows_idx[i] , rows_idx[i+1] ]
+      The actual loop is in "simd.hpp": for double and float it is vectorized (if the CPU allows it) */
+template <typename T, typename I, typename P>
+void SparseMatrixCSR<T,I,P>::multiply_rows(const unsigned int first, const unsigned int last,
+                                       const T alpha, const T *x, const T beta, T *y) const {
+    csr_multiply_rows(this->values.data(), this->cols.data(), this->rows_idx.data(),
+                      first, last, this->n_cols, alpha, x, beta, y);
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (VII) CSR Helper function to sort the columns (and the values) of the rows that are not sorted
+    /*Checking a row is linear, so already sorted matrices (e.g. the result of SpGEMM or of a transposition)
+      cost just one pass; unsorted rows are sorted through a permutation (stable, so duplicates keep their order)*/
+template <typename T, typename I, typename P>
+void SparseMatrixCSR<T,I,P>::sortRows() {
+    std::vector<P> order;
+    std::vector<T> row_values;
+    std::vector<I> row_cols;
+    for(unsigned int i = 0; i + 1 < this->rows_idx.size(); i++) {
+        const P first = this->rows_idx[i], last = this->rows_idx[i+1];
+        if(std::is_sorted(this->cols.begin() + first, this->cols.begin() + last)) {
+            continue;
+        }
+        order.resize(last - first);
+        for(unsigned int k = 0; k < order.size(); k++) {
+            order[k] = first + k;
+        }
+        std::stable_sort(order.begin(), order.end(), [&](const P a, const P b){
+            return this->cols[a] < this->cols[b];
+        });
+        row_values.resize(order.size());
+        row_cols.resize(order.size());
+        for(unsigned int k = 0; k < order.size(); k++) {
+            row_values[k] = this->values[order[k]];
+            row_cols[k] = this->cols[order[k]];
+        }
+        std::copy(row_values.begin(), row_values.end(), this->values.begin() + first);
+        std::copy(row_cols.begin(), row_cols.end(), this->cols.begin() + first);
+    }
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (I) SELL Helper function to find the index of an element at position (i, j)
+    /*The row i is in the sorted position p=perm_inv[i], i.e. in the lane p%C of the chunk p/C:
+      its s-th element is at chunks_idx[p/C]+s*C+p%C (we just look at the first rows_len[p], the others are padding)*/
+template <typename T>
+const long long SparseMatrixSELL<T>::findIndex(const unsigned int i, const unsigned int j) const {
+    unsigned int p = perm_inv[i];
+    unsigned int first = chunks_idx[p/chunk_size] + p%chunk_size;
+    for(unsigned int s=0; s<rows_len[p]; s++) {
+        if(this->cols[first+s*chunk_size] == j) {
+            return first+s*chunk_size;
+        }
+    }
+    return -1;
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (II) SELL Helper function to get the value at position (i, j)
+template <typename T>
+const T SparseMatrixSELL<T>::getValue(const unsigned int i, const unsigned int j) const {
+    long long index = findIndex(i, j);
+    if(index!= -1) {
+        return this->values[index];
+    }
+    return 0;
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (III) SELL Helper function to set the new value at position (i, j)
+template <typename T>
+void SparseMatrixSELL<T>::setValue(const unsigned int i, const unsigned int j, const T value) {
+    long long index = findIndex(i, j);
+    unsigned int p = perm_inv[i];
+    unsigned int k = p/chunk_size;
+    unsigned int first = chunks_idx[k] + p%chunk_size;
+    // Basing on the value that we insert, there are 2 cases:
+    // Case 1: the value that we want to insert is 0
+    if(value == 0) {
+        if(index!= -1) {
+            // If the element to replace is nonzero, we shift the following elements of the row back by one slot
+            for(unsigned int pos=index; pos+chunk_size<first+rows_len[p]*chunk_size; pos+=chunk_size){
+                this->values[pos] = this->values[pos+chunk_size];
+                this->cols[pos] = this->cols[pos+chunk_size];
+            }
+            // The last slot of the row becomes padding (we keep its column, that is still a valid one)
+            this->values[first+(rows_len[p]-1)*chunk_size] = 0;
+            rows_len[p]--;
+            nnz--;
+        }
+        // No else because if the value is 0 and the element to replace is 0, we don't have to do anything
+    }
+    // Case 2: the value that we want to insert is non zero
+    else {
+        if(index!= -1) {
+            // If the element to replace is nonzero, just update its value
+            this->values[index] = value;
+        }
+        else {
+            // If the row has no padding left, we add a new slot (C elements) at the end of the chunk
+            if(rows_len[p]==chunks_len[k]){
+                this->values.insert(this->values.begin() + chunks_idx[k+1], chunk_size, 0);
+                this->cols.insert(this->cols.begin() + chunks_idx[k+1], chunk_size, 0);
+                chunks_len[k]++;
+                for(unsigned int q=k+1; q<chunks_idx.size(); q++){
+                    chunks_idx[q] += chunk_size;
+                }
+            }
+            // Now we can write the new element in the first padding slot of the row
+            this->values[first+rows_len[p]*chunk_size] = value;
+            this->cols[first+rows_len[p]*chunk_size] = j;
+            rows_len[p]++;
+            nnz++;
+        }
+    }
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (I) BSR Helper function to find the index of an element at position (i, j)
+    /*The element is in the block (i/R, j/C): if such block exists, the element is at position (i%R, j%C) inside it,
+      even if its value is 0 (explicit zeros inside the blocks are stored)*/
+template <typename T, unsigned int R, unsigned int C>
+const long long SparseMatrixBSR<T,R,C>::findIndex(const unsigned int i, const unsigned int j) const {
+    for(unsigned int k=blocks_idx[i/R]; k<blocks_idx[i/R+1]; k++) {
+        if(this->cols[k] == j/C) {
+            return k*R*C + (i%R)*C + j%C;
+        }
+    }
+    return -1;
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (II) BSR Helper function to get the value at position (i, j)
+template <typename T, unsigned int R, unsigned int C>
+const T SparseMatrixBSR<T,R,C>::getValue(const unsigned int i, const unsigned int j) const {
+    long long index = findIndex(i, j);
+    if(index!= -1) {
+        return this->values[index];
+    }
+    return 0;
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (III) BSR Helper function to set the new value at position (i, j)
+template <typename T, unsigned int R, unsigned int C>
+void SparseMatrixBSR<T,R,C>::setValue(const unsigned int i, const unsigned int j, const T value) {
+    long long index = findIndex(i, j);
+    // Case 1: the block (i/R, j/C) already exists, so we just write the value inside it
+    if(index!= -1) {
+        this->values[index] = value;
+        // If the whole block is now made of zeros, we remove it
+        unsigned int k = index/(R*C);
+        if(value == 0 && std::all_of(this->values.begin()+k*R*C, this->values.begin()+(k+1)*R*C,
+                                     [](const T &v){return v==T(0);})) {
+            this->values.erase(this->values.begin()+k*R*C, this->values.begin()+(k+1)*R*C);
+            this->cols.erase(this->cols.begin()+k);
+            for (unsigned int q = i/R+1; q < blocks_idx.size(); q++){
+                blocks_idx[q]--;
+            }
+        }
+    }
+    // Case 2: the block does not exist, we need to add it (only if the value is nonzero)
+    else if(value != 0) {
+        // Keep block columns sorted inside the block row
+        unsigned int k = blocks_idx[i/R];
+        while(k < blocks_idx[i/R+1] && this->cols[k] < j/C) {
+            k++;
+        }
+        this->values.insert(this->values.begin()+k*R*C, R*C, 0);
+        this->cols.insert(this->cols.begin()+k, j/C);
+        this->values[k*R*C + (i%R)*C + j%C] = value;
+        for (unsigned int q = i/R+1; q < blocks_idx.size(); q++){
+            blocks_idx[q]++;
+        }
+    }
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (VI) BSR Helper function to compute the matrix-vector product restricted to the block rows [first,last)
+    /*Same as CSR, but each "element" is a RxC block: since R and C are known at compile time,
+      the small dense product of each block is completely unrolled by the compiler*/
+template <typename T, unsigned int R, unsigned int C>
+void SparseMatrixBSR<T,R,C>::multiply_block_rows(const unsigned int first, const unsigned int last,
+                                                 const T alpha, const T *x, const T beta, T *y) const {
+    for(unsigned int bi=first; bi<last; bi++){
+        T acc[R]{};
+        for(unsigned int k=blocks_idx[bi]; k<blocks_idx[bi+1]; k++){
+            const T *block = this->values.data() + k*R*C;
+            const T *xc = x + this->cols[k]*C;
+            #pragma GCC unroll 8
+            for(unsigned int r=0; r<R; r++){
+                #pragma GCC unroll 8
+                for(unsigned int c=0; c<C; c++){
+                    acc[r] += block[r*C+c] * xc[c];
+                }
+            }
+        }
+        for(unsigned int r=0; r<R; r++){
+            store_result(y[bi*R+r], alpha, acc[r], beta);
+        }
+    }
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (I) CSC Helper function to find the index of an element at position (i, j)
+    /*Same as CSR, with rows and columns swapped: we look for the row i in the "range" of the j-th column*/
+template <typename T>
+const long long SparseMatrixCSC<T>::findIndex(const unsigned int i, const unsigned int j) const {
+    for(unsigned int k=cols_idx[j]; k<cols_idx[j+1]; k++) {
+        if(rows[k] == i) {
+            return k;
+        }
+    }
+    return -1;
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (II) CSC Helper function to get the value at position (i, j)
+template <typename T>
+const T SparseMatrixCSC<T>::getValue(const unsigned int i, const unsigned int j) const {
+    long long index = findIndex(i, j);
+    if(index!= -1) {
+        return this->values[index];
+    }
+    return 0;
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (III) CSC Helper function to set the new value at position (i, j)
+template <typename T>
+void SparseMatrixCSC<T>::setValue(const unsigned int i, const unsigned int j, const T value) {
+    long long index = findIndex(i, j);
+    // Case 1: the value that we want to insert is 0
+    if(value == 0) {
+        if(index!= -1) {
+            // If the element to replace is nonzero, remove it and update cumulative values in cols_idx
+            this->values.erase(this->values.begin() + index);
+            rows.erase(rows.begin() + index);
+            for (unsigned int k = j+1; k < cols_idx.size(); k++){
+                cols_idx[k]--;
+            }
+        }
+    }
+    // Case 2: the value that we want to insert is non zero
+    else {
+        if(index!= -1) {
+            // If the element to replace is nonzero, just update its value
+            this->values[index] = value;
+        }
+        else {
+            // Otherwise we insert it in the j-th column, keeping rows sorted
+            unsigned int position = cols_idx[j];
+            while(position < cols_idx[j+1] && rows[position] < i) {
+                position++;
+            }
+            this->values.insert(this->values.begin() + position, value);
+            rows.insert(rows.begin() + position, i);
+            for (unsigned int k = j+1; k < cols_idx.size(); k++){
+                cols_idx[k]++;
+            }
+        }
+    }
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (I) Dynamic Helper function to find the index of an element at position (i, j)
+    /*Here the index is the position of the element in the vectors of its row (columns are sorted, so we use the
+      same lower bound search of CSR)*/
+template <typename T>
+const long long SparseMatrixDynamic<T>::findIndex(const unsigned int i, const unsigned int j) const {
+    const unsigned int pos = sorted_lower_bound(row_cols[i].data(), row_cols[i].size(), j);
+    if(pos < row_cols[i].size() && row_cols[i][pos] == j) {
+        return pos;
+    }
+    return -1;
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (II) Dynamic Helper function to get the value at position (i, j)
+template <typename T>
+const T SparseMatrixDynamic<T>::getValue(const unsigned int i, const unsigned int j) const {
+    long long index = findIndex(i, j);
+    if(index!= -1) {
+        return row_values[i][index];
+    }
+    return 0;
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (III) Dynamic Helper function to set the new value at position (i, j)
+    /*Inserting or removing an element only shifts the following elements of its row: O(row_nnz)*/
+template <typename T>
+void SparseMatrixDynamic<T>::setValue(const unsigned int i, const unsigned int j, const T value) {
+    const unsigned int pos = sorted_lower_bound(row_cols[i].data(), row_cols[i].size(), j);
+    const bool found = pos < row_cols[i].size() && row_cols[i][pos] == j;
+    // Case 1: the value that we want to insert is 0 (if the element is nonzero we remove it)
+    if(value == 0) {
+        if(found) {
+            row_cols[i].erase(row_cols[i].begin() + pos);
+            row_values[i].erase(row_values[i].begin() + pos);
+            nnz--;
+        }
+    }
+    // Case 2: the value that we want to insert is non zero (we update it or we insert it in its sorted position)
+    else {
+        if(found) {
+            row_values[i][pos] = value;
+        }
+        else {
+            row_cols[i].insert(row_cols[i].begin() + pos, j);
+            row_values[i].insert(row_values[i].begin() + pos, value);
+            nnz++;
+        }
+    }
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (I) Symmetric Helper function to find the index of an element at position (i, j)
+    /*Only the upper triangle is stored, so (i,j) with i>j is looked for as (j,i), with the same search of CSR*/
+template <typename T>
+const long long SparseMatrixSymmetric<T>::findIndex(const unsigned int i, const unsigned int j) const {
+    const unsigned int row = std::min(i, j), col = std::max(i, j);
+    const unsigned int first = rows_idx[row];
+    const unsigned int len = rows_idx[row+1] - first;
+    const unsigned int pos = sorted_lower_bound(this->cols.data() + first, len, col);
+    if(pos < len && this->cols[first+pos] == col) {
+        return first + pos;
+    }
+    return -1;
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (II) Symmetric Helper function to get the value at position (i, j)
+template <typename T>
+const T SparseMatrixSymmetric<T>::getValue(const unsigned int i, const unsigned int j) const {
+    long long index = findIndex(i, j);
+    if(index!= -1) {
+        return this->values[index];
+    }
+    return 0;
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (III) Symmetric Helper function to set the new value at position (i, j)
+    /*Same as CSR on the stored element (min(i,j), max(i,j)): writing a_ij also writes a_ji*/
+template <typename T>
+void SparseMatrixSymmetric<T>::setValue(const unsigned int i, const unsigned int j, const T value) {
+    const unsigned int row = std::min(i, j), col = std::max(i, j);
+    long long index = findIndex(row, col);
+    // Case 1: the value that we want to insert is 0 (if the element is nonzero we remove it)
+    if(value == 0) {
+        if(index!= -1) {
+            this->values.erase(this->values.begin() + index);
+            this->cols.erase(this->cols.begin() + index);
+            for (unsigned int k = row+1; k < rows_idx.size(); k++){
+                rows_idx[k]--;
+            }
+            n_diag -= (row==col);
+        }
+    }
+    // Case 2: the value that we want to insert is non zero (we update it or we insert it in its sorted position)
+    else {
+        if(index!= -1) {
+            this->values[index] = value;
+        }
+        else {
+            unsigned int position = rows_idx[row] + sorted_lower_bound(this->cols.data() + rows_idx[row],
+                                                                       rows_idx[row+1] - rows_idx[row], col);
+            this->values.insert(this->values.begin() + position, value);
+            this->cols.insert(this->cols.begin() + position, col);
+            for (unsigned int k = row+1; k < rows_idx.size(); k++){
+                rows_idx[k]++;
+            }
+            n_diag += (row==col);
+        }
+    }
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (VI) Symmetric Helper function to compute the matrix-vector product restricted to the rows [first,last)
+    /*Each stored element a_ij (j>i) of the row i gives a_ij*x_j to y_i (gather, as in CSR) and a_ij*x_i to y_j
+      (scatter): y_j is in the block if j<last, otherwise it goes in spill[j-last]. The diagonal, if stored, is the
+      first element of the row (columns are sorted and >= i), so it is handled before the loop (no branch inside)*/
+template <typename T>
+void SparseMatrixSymmetric<T>::multiply_rows(const unsigned int first, const unsigned int last,
+                                             const T alpha, const T *x, const T beta, T *y, T *spill) const {
+    scale_vector(y+first, last-first, beta);
+    for(unsigned int i=first; i<last; i++){
+        unsigned int k = rows_idx[i];
+        T sum = T(0);
+        if(k<rows_idx[i+1] && this->cols[k]==i){
+            sum = this->values[k]*x[i];
+            k++;
+        }
+        const T alpha_x = alpha*x[i];
+        // Elements with j<last (in the block) and then the ones with j>=last (spill), columns are sorted
+        for(; k<rows_idx[i+1] && this->cols[k]<last; k++){
+            const unsigned int j = this->cols[k];
+            sum += this->values[k]*x[j];
+            y[j] += this->values[k]*alpha_x;
+        }
+        for(; k<rows_idx[i+1]; k++){
+            const unsigned int j = this->cols[k];
+            sum += this->values[k]*x[j];
+            spill[j-last] += this->values[k]*alpha_x;
+        }
+        y[i] += alpha*sum;
+    }
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (I) Mixed Helper function to find the index of an element at position (i, j)
+    /*Same search of CSR (columns are sorted inside each row)*/
+template <typename T, typename S>
+const long long SparseMatrixMixed<T,S>::findIndex(const unsigned int i, const unsigned int j) const {
+    const unsigned int first = rows_idx[i];
+    const unsigned int len = rows_idx[i+1] - first;
+    const unsigned int pos = sorted_lower_bound(this->cols.data() + first, len, j);
+    if(pos < len && this->cols[first+pos] == j) {
+        return first + pos;
+    }
+    return -1;
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (II) Mixed Helper function to get the value at position (i, j)
+template <typename T, typename S>
+const T SparseMatrixMixed<T,S>::getValue(const unsigned int i, const unsigned int j) const {
+    long long index = findIndex(i, j);
+    if(index!= -1) {
+        return static_cast<T>(low_values[index]);
+    }
+    return 0;
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (III) Mixed Helper function to set the new value at position (i, j)
+    /*Same as CSR, the value is rounded to the storage type (so reading it back may give a slightly different value)*/
+template <typename T, typename S>
+void SparseMatrixMixed<T,S>::setValue(const unsigned int i, const unsigned int j, const T value) {
+    long long index = findIndex(i, j);
+    // Case 1: the value that we want to insert is 0 (if the element is nonzero we remove it)
+    if(value == 0) {
+        if(index!= -1) {
+            low_values.erase(low_values.begin() + index);
+            this->cols.erase(this->cols.begin() + index);
+            for (unsigned int k = i+1; k < rows_idx.size(); k++){
+                rows_idx[k]--;
+            }
+        }
+    }
+    // Case 2: the value that we want to insert is non zero (we update it or we insert it in its sorted position)
+    else {
+        if(index!= -1) {
+            low_values[index] = static_cast<S>(value);
+        }
+        else {
+            unsigned int position = rows_idx[i] + sorted_lower_bound(this->cols.data() + rows_idx[i],
+                                                                     rows_idx[i+1] - rows_idx[i], j);
+            low_values.insert(low_values.begin() + position, static_cast<S>(value));
+            this->cols.insert(this->cols.begin() + position, j);
+            for (unsigned int k = i+1; k < rows_idx.size(); k++){
+                rows_idx[k]++;
+            }
+        }
+    }
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (VIII) Tiled Helper function to find the position (in tile_rows) of the first stored row >= i of the tile t
+template <typename T>
+unsigned int SparseMatrixTiled<T>::findTileRow(const unsigned int t, const unsigned int i) const {
+    return std::lower_bound(tile_rows.begin()+tiles_idx[t], tile_rows.begin()+tiles_idx[t+1], i) - tile_rows.begin();
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (I) Tiled Helper function to find the index of an element at position (i, j)
+    /*The column gives the tile, then we look for the row i among the stored rows of the tile and for the local
+      column in the range of the row (both sorted)*/
+template <typename T>
+const long long SparseMatrixTiled<T>::findIndex(const unsigned int i, const unsigned int j) const {
+    const unsigned int t = j/tile_width, local = j - t*tile_width;
+    const unsigned int r = findTileRow(t, i);
+    if(r == tiles_idx[t+1] || tile_rows[r] != i) {
+        return -1;
+    }
+    const unsigned int len = row_ptr[r+1] - row_ptr[r];
+    const unsigned int pos = sorted_lower_bound(this->cols.data() + row_ptr[r], len, local);
+    if(pos < len && this->cols[row_ptr[r]+pos] == local) {
+        return row_ptr[r] + pos;
+    }
+    return -1;
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (II) Tiled Helper function to get the value at position (i, j)
+template <typename T>
+const T SparseMatrixTiled<T>::getValue(const unsigned int i, const unsigned int j) const {
+    long long index = findIndex(i, j);
+    if(index!= -1) {
+        return this->values[index];
+    }
+    return 0;
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (III) Tiled Helper function to set the new value at position (i, j)
+    /*Same as CSR inside the tile of the column j. If the row i has no nonzeros in that tile yet, an (empty) stored
+      row is inserted first; a stored row that becomes empty is just left there*/
+template <typename T>
+void SparseMatrixTiled<T>::setValue(const unsigned int i, const unsigned int j, const T value) {
+    const unsigned int t = j/tile_width, local = j - t*tile_width;
+    long long index = findIndex(i, j);
+    // Case 1: the value that we want to insert is 0 (if the element is nonzero we remove it)
+    if(value == 0) {
+        if(index!= -1) {
+            this->values.erase(this->values.begin() + index);
+            this->cols.erase(this->cols.begin() + index);
+            for (unsigned int q = findTileRow(t, i)+1; q < row_ptr.size(); q++){
+                row_ptr[q]--;
+            }
+            for (unsigned int k = i+1; k < rows_idx.size(); k++){
+                rows_idx[k]--;
+            }
+        }
+    }
+    // Case 2: the value that we want to insert is non zero
+    else {
+        if(index!= -1) {
+            this->values[index] = value;
+        }
+        else {
+            const unsigned int r = findTileRow(t, i);
+            if(r == tiles_idx[t+1] || tile_rows[r] != i) {
+                // New (empty) stored row: it starts where the following one starts
+                tile_rows.insert(tile_rows.begin() + r, i);
+                row_ptr.insert(row_ptr.begin() + r, row_ptr[r]);
+                for (unsigned int q = t+1; q < tiles_idx.size(); q++){
+                    tiles_idx[q]++;
+                }
+            }
+            unsigned int position = row_ptr[r] + sorted_lower_bound(this->cols.data() + row_ptr[r],
+                                                                    row_ptr[r+1] - row_ptr[r], local);
+            this->values.insert(this->values.begin() + position, value);
+            this->cols.insert(this->cols.begin() + position, local);
+            for (unsigned int q = r+1; q < row_ptr.size(); q++){
+                row_ptr[q]++;
+            }
+            for (unsigned int k = i+1; k < rows_idx.size(); k++){
+                rows_idx[k]++;
+            }
+        }
+    }
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (VI) Tiled Helper function to compute the matrix-vector product restricted to the rows [first,last)
+    /*Tile by tile, the stored rows of the block are computed with the (vectorized) CSR kernel on the slice of x of
+      the tile, in batches of 256 rows whose sums go in a small buffer on the stack, then added to their rows of y*/
+template <typename T>
+void SparseMatrixTiled<T>::multiply_rows(const unsigned int first, const unsigned int last,
+                                         const T alpha, const T *x, const T beta, T *y) const {
+    constexpr unsigned int batch = 256;
+    T partial[batch];
+    scale_vector(y+first, last-first, beta);
+    for(unsigned int t=0; t<get_ntiles(); t++){
+        const unsigned int tile_start = t*tile_width;
+        const unsigned int width = std::min(tile_width, this->n_cols-tile_start);
+        const unsigned int r_first = (first==0) ? tiles_idx[t] : findTileRow(t, first);
+        const unsigned int r_last = (last==this->n_rows) ? tiles_idx[t+1] : findTileRow(t, last);
+        for(unsigned int b=r_first; b<r_last; b+=batch){
+            const unsigned int n_batch = std::min(batch, r_last-b);
+            csr_multiply_rows(this->values.data(), this->cols.data(), row_ptr.data()+b, 0, n_batch, width,
+                              T(1), x+tile_start, T(0), partial);
+            for(unsigned int q=0; q<n_batch; q++){
+                y[tile_rows[b+q]] += alpha*partial[q];
+            }
+        }
+    }
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (VII) Tiled Helper function to build the tiles of the given width from the CSR vectors of the matrix
+    /*Two passes on the (sorted) rows: the first one counts the stored rows and the nonzeros of each tile (a row is
+      stored in a tile if it has at least one nonzero there), the second one copies each piece of row in the first
+      free position of its tile. The tiles are filled in order of rows, so the stored rows of each tile are sorted*/
+template <typename T>
+void SparseMatrixTiled<T>::buildTiles(const unsigned int width, const std::vector<T> &d,
+                                      const std::vector<unsigned int> &c, const std::vector<unsigned int> &r) {
+    tile_width = width;
+    const unsigned int n_tiles = std::max(1u, (unsigned int)(((unsigned long long)this->n_cols+width-1)/width));
+    std::vector<unsigned int> tile_nnz(n_tiles+1, 0);
+    tiles_idx.assign(n_tiles+1, 0);
+    for(unsigned int i=0; i<this->n_rows; i++){
+        for(unsigned int k=r[i]; k<r[i+1]; k++){
+            const unsigned int t = c[k]/width;
+            tile_nnz[t+1]++;
+            if(k==r[i] || c[k-1]/width!=t){
+                tiles_idx[t+1]++;
+            }
+        }
+    }
+    for(unsigned int t=0; t<n_tiles; t++){
+        tile_nnz[t+1] += tile_nnz[t];
+        tiles_idx[t+1] += tiles_idx[t];
+    }
+    tile_rows.resize(tiles_idx[n_tiles]);
+    row_ptr.resize(tiles_idx[n_tiles]+1);
+    row_ptr[tiles_idx[n_tiles]] = d.size();
+    this->values.resize(d.size());
+    this->cols.resize(d.size());
+    std::vector<unsigned int> next_row(tiles_idx.begin(), tiles_idx.end()-1), next_nnz(tile_nnz.begin(), tile_nnz.end()-1);
+    for(unsigned int i=0; i<this->n_rows; i++){
+        for(unsigned int k=r[i]; k<r[i+1]; k++){
+            const unsigned int t = c[k]/width;
+            if(k==r[i] || c[k-1]/width!=t){
+                tile_rows[next_row[t]] = i;
+                row_ptr[next_row[t]++] = next_nnz[t];
+            }
+            this->values[next_nnz[t]] = d[k];
+            this->cols[next_nnz[t]++] = c[k]-t*width;
+        }
+    }
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (VII) HYB Helper function to find the first position of the row i in the tail (the tail is sorted by row)
+template <typename T>
+unsigned int SparseMatrixHYB<T>::findTailRow(const unsigned int i) const {
+    return std::lower_bound(tail.get_rows().begin(), tail.get_rows().end(), i) - tail.get_rows().begin();
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (I) HYB Helper function to find the index of an element at position (i, j)
+    /*The slab part of the row is short (at most ell_width elements), so we scan it; then we scan the row in the tail.
+      An element of the tail at position k has index values.size()+k (the positions after the slab)*/
+template <typename T>
+const long long SparseMatrixHYB<T>::findIndex(const unsigned int i, const unsigned int j) const {
+    for(unsigned int s = 0; s < ell_len[i]; s++) {
+        if(this->cols[(size_t)s*this->n_rows+i] == j) {
+            return (size_t)s*this->n_rows+i;
+        }
+    }
+    const std::vector<unsigned int> &t_rows = tail.get_rows(), &t_cols = tail.get_cols();
+    for(unsigned int k = findTailRow(i); k < t_rows.size() && t_rows[k] == i; k++) {
+        if(t_cols[k] == j) {
+            return this->values.size() + k;
+        }
+    }
+    return -1;
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (II) HYB Helper function to get the value at position (i, j)
+template <typename T>
+const T SparseMatrixHYB<T>::getValue(const unsigned int i, const unsigned int j) const {
+    long long index = findIndex(i, j);
+    if(index == -1) {
+        return 0;
+    }
+    return ((size_t)index < this->values.size()) ? this->values[index] : tail.get_values()[index-this->values.size()];
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (III) HYB Helper function to set the new value at position (i, j)
+    /*A new element goes in the slab if its row has a free slot there (the row stays sorted), otherwise in the tail.
+      The tail must stay sorted by row (the parallel product needs it): an element of the last row of the tail is
+      appended by the COO itself, otherwise the tail is rebuilt with the element in its place*/
+template <typename T>
+void SparseMatrixHYB<T>::setValue(const unsigned int i, const unsigned int j, const T value) {
+    const unsigned int n = this->n_rows;
+    long long index = findIndex(i, j);
+    const bool in_slab = index != -1 && (size_t)index < this->values.size();
+    // Case 1: the value that we want to insert is 0 (if the element is nonzero we remove it)
+    if(value == 0) {
+        if(in_slab) {
+            // The following elements of the row are shifted back and the last slot becomes padding
+            for(unsigned int s = index/n; s+1 < ell_len[i]; s++) {
+                this->values[(size_t)s*n+i] = this->values[(size_t)(s+1)*n+i];
+                this->cols[(size_t)s*n+i] = this->cols[(size_t)(s+1)*n+i];
+            }
+            ell_len[i]--;
+            ell_nnz--;
+            this->values[(size_t)ell_len[i]*n+i] = 0;
+            this->cols[(size_t)ell_len[i]*n+i] = 0;
+        }
+        else if(index != -1) {
+            tail.set(i, j, 0);
+        }
+    }
+    // Case 2: the value that we want to insert is non zero
+    else {
+        if(in_slab) {
+            this->values[index] = value;
+        }
+        else if(index != -1) {
+            tail.set(i, j, value);
+        }
+        else if(ell_len[i] < ell_width) {
+            // The greater columns of the row are shifted forward to make room for j
+            unsigned int s = ell_len[i];
+            for(; s > 0 && this->cols[(size_t)(s-1)*n+i] > j; s--) {
+                this->values[(size_t)s*n+i] = this->values[(size_t)(s-1)*n+i];
+                this->cols[(size_t)s*n+i] = this->cols[(size_t)(s-1)*n+i];
+            }
+            this->values[(size_t)s*n+i] = value;
+            this->cols[(size_t)s*n+i] = j;
+            ell_len[i]++;
+            ell_nnz++;
+        }
+        else if(tail.get_nzeros() == 0 || tail.get_rows().back() <= i) {
+            tail.set(i, j, value);
+        }
+        else {
+            std::vector<T> t_values = tail.get_values();
+            std::vector<unsigned int> t_cols = tail.get_cols(), t_rows = tail.get_rows();
+            const unsigned int position = findTailRow(i+1);
+            t_values.insert(t_values.begin()+position, value);
+            t_cols.insert(t_cols.begin()+position, j);
+            t_rows.insert(t_rows.begin()+position, i);
+            tail = SparseMatrixCOO<T>(n, this->n_cols, t_values, t_cols, t_rows);
+        }
+    }
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (VI) HYB Helper function to compute the product of the slab restricted to the rows [first,last)
+    /*The slab is column-major, so for each s the s-th elements of consecutive rows are contiguous: rows are processed
+      in batches of 256, whose sums stay in a small buffer on the stack while we go through the columns of the slab*/
+template <typename T>
+void SparseMatrixHYB<T>::multiply_ell(const unsigned int first, const unsigned int last,
+                                      const T alpha, const T *x, const T beta, T *y) const {
+    constexpr unsigned int batch = 256;
+    T partial[batch];
+    scale_vector(y+first, last-first, beta);
+    for(unsigned int b=first; b<last; b+=batch){
+        const unsigned int n_batch = std::min(batch, last-b);
+        std::fill(partial, partial+n_batch, T(0));
+        for(unsigned int s=0; s<ell_width; s++){
+            const T *v = this->values.data() + (size_t)s*this->n_rows + b;
+            const unsigned int *c = this->cols.data() + (size_t)s*this->n_rows + b;
+            for(unsigned int q=0; q<n_batch; q++){
+                partial[q] += v[q]*x[c[q]];
+            }
+        }
+        for(unsigned int q=0; q<n_batch; q++){
+            y[b+q] += alpha*partial[q];
+        }
+    }
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (VIII) HYB Helper function to choose the width of the slab
+    /*The largest width k such that at least a third of the rows have k nonzeros or more: the slab is then at most
+      two thirds padding in its last column, and the long rows go to the tail*/
+template <typename T>
+unsigned int SparseMatrixHYB<T>::chooseWidth(const std::vector<unsigned int> &r) {
+    const unsigned int n = r.size()-1;
+    unsigned int max_len = 0;
+    for(unsigned int i=0; i<n; i++){
+        max_len = std::max(max_len, r[i+1]-r[i]);
+    }
+    // count[k] = number of rows with exactly k nonzeros, then (going down) with k nonzeros or more
+    std::vector<unsigned int> count(max_len+2, 0);
+    for(unsigned int i=0; i<n; i++){
+        count[r[i+1]-r[i]]++;
+    }
+    unsigned int width = max_len;
+    for(; width>0; width--){
+        count[width] += count[width+1];
+        if(3ull*count[width] >= n){
+            break;
+        }
+    }
+    return width;
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (IX) HYB Helper function to get the elements of v (values or cols) after the first width ones of each row
+template <typename T>
+template <typename U>
+std::vector<U> SparseMatrixHYB<T>::tailEntries(const std::vector<U> &v, const std::vector<unsigned int> &r,
+                                               const unsigned int width) {
+    std::vector<U> entries;
+    for(unsigned int i=0; i+1<r.size(); i++){
+        if(r[i+1]-r[i] > width){
+            entries.insert(entries.end(), v.begin()+r[i]+width, v.begin()+r[i+1]);
+        }
+    }
+    return entries;
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (X) HYB Helper function to get the rows of the elements after the first width ones of each row
+template <typename T>
+std::vector<unsigned int> SparseMatrixHYB<T>::tailRows(const std::vector<unsigned int> &r, const unsigned int width) {
+    std::vector<unsigned int> rows;
+    for(unsigned int i=0; i+1<r.size(); i++){
+        if(r[i+1]-r[i] > width){
+            rows.insert(rows.end(), r[i+1]-r[i]-width, i);
+        }
+    }
+    return rows;
+}
+//---------------------------------------------------------------------------------------------------------------------
+// Helper function to split the rows of a CSR matrix in n_parts blocks with (roughly) the same number of nonzeros
+    /*We return the n_parts+1 boundaries of the blocks: block t contains the rows [bounds[t], bounds[t+1]).
+      Since rows_idx is sorted, the first row of block t is the first row whose rows_idx is >= t*nnz/n_parts,
+      which we find with a binary search */
+template <typename V>
+std::vector<unsigned int> nnz_partition(const V &rows_idx, const unsigned int n_parts){
+    typedef typename V::value_type I;
+    const unsigned int n_rows = rows_idx.size()-1;
+    const unsigned long long nnz = rows_idx.back();
+    std::vector<unsigned int> bounds(n_parts+1, n_rows);
+    bounds[0]=0;
+    for(unsigned int t=1; t<n_parts; t++){
+        const unsigned long long target = nnz*t/n_parts;
+        unsigned int row = std::lower_bound(rows_idx.begin(), rows_idx.end(), (I)target) - rows_idx.begin();
+        // Boundaries must be non-decreasing and must not exceed the number of rows
+        bounds[t] = std::min(std::max(row, bounds[t-1]), n_rows);
+    }
+    return bounds;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Helper function to run fn(first, last) on the blocks [bounds[t], bounds[t+1]), each one in its own thread
+    /*Empty blocks are skipped and, if there is only one block left, it is run in the calling thread
+      (so a parallel kernel on a tiny matrix does not pay for creating threads)*/
+template <typename F>
+void run_blocks(const std::vector<unsigned int> &bounds, F fn){
+    std::vector<std::thread> workers;
+    unsigned int last_block = 0, n_blocks = 0;
+    for(unsigned int t=0; t+1<bounds.size(); t++){
+        if(bounds[t]<bounds[t+1]){
+            last_block = t;
+            n_blocks++;
+        }
+    }
+    if(n_blocks<=1){
+        if(n_blocks==1){
+            fn(bounds[last_block], bounds[last_block+1]);
+        }
+        return;
+    }
+    for(unsigned int t=0; t+1<bounds.size(); t++){
+        if(bounds[t]<bounds[t+1]){
+            workers.emplace_back(fn, bounds[t], bounds[t+1]);
+        }
+    }
+    for(std::thread &w : workers){
+        w.join();
+    }
+}
+//---------------------------------------------------------------------------------------------------------------------
+// Helper function to scale a vector in place (used by the kernels that accumulate into y instead of overwriting it)
+template <typename T>
+void scale_vector(T *v, const unsigned int n, const T beta){
+    if(beta==T(0)){
+        std::fill(v, v+n, T(0));
+    }
+    else if(beta!=T(1)){
+        for(unsigned int i=0; i<n; i++){
+            v[i] *= beta;
+        }
+    }
+}
+//---------------------------------------------------------------------------------------------------------------------
+// Helper function to compute y = alpha*A^T*x + beta*y from the CSR vectors of A
+    /*Different rows scatter into the same entries of y, so threads cannot write y directly: rows are split in
+      nnz-balanced blocks, the first block is scattered into y and each other block into its own private copy of y
+      (privatization, instead of atomics that do not exist for a generic T). Then the copies are added to y,
+      splitting its entries among threads: each entry is always summed in the same order, so the result
+      does not change from run to run (it may differ from the serial one by rounding errors).
+      The private copies take (n_threads-1)*n_out elements, so this is worth only if x is not too short; with a
+      scratch vector they are allocated once (each thread zeroes its own copy before scattering into it)*/
+template <typename T, typename V, typename I, typename P>
+void scatter_product(const std::vector<V> &values, const std::vector<I> &cols,
+                     const std::vector<P> &rows_idx, const unsigned int n_out, const unsigned int n_threads,
+                     const T alpha, const T *x, const T beta, T *y, std::vector<T> *scratch){
+    const unsigned int n_rows = rows_idx.size()-1;
+    scale_vector(y, n_out, beta);
+    // Serial version: a single block containing all the rows (no allocation at all)
+    if(n_threads<=1 || n_rows<=1){
+        csr_scatter_rows(values.data(), cols.data(), rows_idx.data(), 0, n_rows, alpha, x, y);
+        return;
+    }
+    std::vector<unsigned int> bounds = nnz_partition(rows_idx, n_threads);
+    std::vector<T> local;
+    std::vector<T> &partial = (scratch!=nullptr) ? *scratch : local;
+    if(partial.size()<(size_t)(n_threads-1)*n_out){
+        partial.resize((size_t)(n_threads-1)*n_out);
+    }
+    // (1) Scatter: the block t is the one starting at first (blocks are non-empty, so bounds[t]==first<bounds[t+1])
+    run_blocks(bounds, [&](const unsigned int first, const unsigned int last){
+        const unsigned int t = std::upper_bound(bounds.begin(), bounds.end(), first) - bounds.begin() - 1;
+        T *out = y;
+        if(t>0){
+            out = partial.data() + (size_t)(t-1)*n_out;
+            std::fill(out, out+n_out, T(0));
+        }
+        csr_scatter_rows(values.data(), cols.data(), rows_idx.data(), first, last, alpha, x, out);
+    });
+    // (2) Reduction: the entries of y are split in n_threads (contiguous) ranges of the same length
+    std::vector<unsigned int> out_bounds(n_threads+1);
+    for(unsigned int t=0; t<=n_threads; t++){
+        out_bounds[t] = (unsigned long long)n_out*t/n_threads;
+    }
+    run_blocks(out_bounds, [&](const unsigned int first, const unsigned int last){
+        for(unsigned int t=1; t+1<bounds.size(); t++){
+            // (the copies of empty blocks were not written, nor zeroed)
+            if(bounds[t]==bounds[t+1]){
+                continue;
+            }
+            const T *copy = partial.data() + (size_t)(t-1)*n_out;
+            for(unsigned int j=first; j<last; j++){
+                y[j] += copy[j];
+            }
+        }
+    });
+}
+//---------------------------------------------------------------------------------------------------------------------
+// Helper function to transpose the CSR vectors of a matrix
+    /*It is the same counting sort of COO_to_CSR, on the columns: we count the nonzeros of each column,
+      we make the counts cumulative and then we move each nonzero in its position. Rows are visited in order,
+      so the (new) column indices of each (new) row come out sorted*/
+template <typename T, typename I, typename P>
+void transpose_vectors(const unsigned int n_cols, const std::vector<T> &values, const std::vector<I> &cols,
+                       const std::vector<P> &rows_idx, std::vector<T> &t_values,
+                       std::vector<I> &t_cols, std::vector<P> &t_rows_idx){
+    const unsigned int n_rows = rows_idx.size()-1;
+    const P nnz = rows_idx.back();
+    // The rows become the columns of the transpose, so their indices must fit in I
+    assert(n_rows==0 || n_rows-1<=std::numeric_limits<I>::max());
+    t_values.resize(nnz);
+    t_cols.resize(nnz);
+    t_rows_idx.assign(n_cols+1, 0);
+    for(P k=0; k<nnz; k++){
+        t_rows_idx[cols[k]+1]++;
+    }
+    for(unsigned int j=0; j<n_cols; j++){
+        t_rows_idx[j+1] += t_rows_idx[j];
+    }
+    std::vector<P> position(t_rows_idx.begin(), t_rows_idx.end()-1);
+    for(unsigned int i=0; i<n_rows; i++){
+        for(P k=rows_idx[i]; k<rows_idx[i+1]; k++){
+            t_values[position[cols[k]]] = values[k];
+            t_cols[position[cols[k]]++] = i;
+        }
+    }
+}
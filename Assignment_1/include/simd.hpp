@@ -0,0 +1,789 @@
+// Header guards
+#ifndef SIMD_HPP_
+#define SIMD_HPP_
+//---------------------------------------------------------------------------------------------------------------------
+/* Hand-vectorized kernels for the matrix-vector products (double and float only).
+   The kernels are compiled with the "target" attribute, so the whole program does not need -mavx2/-mavx512f:
+   the right kernel is chosen at runtime (CPUID) and other types/CPUs/compilers use the portable scalar version.
+   Defining SPARSE_NO_SIMD before including "SparseMatrix.hpp" disables the vectorized kernels.
+*/
+//---------------------------------------------------------------------------------------------------------------------
+// Libraries
+#include<climits>
+#include<algorithm>
+#include<type_traits>
+#include<atomic>
+#include<vector>
+#include "bfloat16.hpp"
+#if !defined(SPARSE_NO_SIMD) && defined(__GNUC__) && defined(__x86_64__)
+    #define SPARSE_SIMD_X86
+    #include<immintrin.h>
+#endif
+//---------------------------------------------------------------------------------------------------------------------
+// (1) Runtime CPU dispatch
+// Available instruction sets (ordered: a level includes all the previous ones)
+enum class SimdLevel {Scalar=0, AVX2=1, AVX512=2};
+
+// Function to detect the best instruction set supported by the CPU
+inline SimdLevel simd_detect(){
+#ifdef SPARSE_SIMD_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f")){
+        return SimdLevel::AVX512;
+    }
+    if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")){
+        return SimdLevel::AVX2;
+    }
+#endif
+    return SimdLevel::Scalar;
+}
+
+// Instruction set currently used by the kernels (detected once, at program start)
+/* (atomic, since set_simd_level can be called while other threads run the kernels; relaxed is enough because
+    no other data is published through it: a kernel just reads the level once and runs with it) */
+inline std::atomic<SimdLevel> current_simd_level{simd_detect()};
+
+// Function to get the instruction set used by the kernels
+inline SimdLevel simd_level(){return current_simd_level.load(std::memory_order_relaxed);}
+
+// Function to force a (lower) instruction set, e.g. to compare kernels (levels not supported by the CPU are ignored)
+inline void set_simd_level(const SimdLevel level){
+    current_simd_level.store(std::min(level, simd_detect()), std::memory_order_relaxed);
+}
+
+// Function to get the name of an instruction set
+inline const char* simd_name(const SimdLevel level){
+    switch(level){
+        case SimdLevel::AVX512: return "AVX-512";
+        case SimdLevel::AVX2:   return "AVX2";
+        default:                return "scalar";
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Helper function to write alpha*sum+beta*y in y (if beta is 0, y is just overwritten, so it may be uninitialized)
+template <typename T>
+inline void store_result(T &y, const T alpha, const T sum, const T beta){
+    y = (beta==T(0)) ? alpha*sum : alpha*sum + beta*y;
+}
+
+// Value types with vectorized kernels
+template <typename T>
+inline constexpr bool simd_value_v = std::is_same_v<T, double> || std::is_same_v<T, float>;
+
+// Index types that the vectorized kernels can gather on (64-bit indices use the scalar kernels)
+template <typename I>
+inline constexpr bool simd_index_v = std::is_same_v<I, unsigned int> || std::is_same_v<I, unsigned short>;
+
+//---------------------------------------------------------------------------------------------------------------------
+// (2) CSR kernels: y[i] = alpha*sum_k values[k]*x[cols[k]] + beta*y[i] for the rows [first,last)
+// Portable (scalar) version, used for any type
+template <typename T, typename I, typename P>
+void csr_multiply_rows_scalar(const T *values, const I *cols, const P *rows_idx,
+                              const unsigned int first, const unsigned int last,
+                              const T alpha, const T *x, const T beta, T *y){
+    for(unsigned int i=first; i<last; i++){
+        T sum=0;
+        for(P k=rows_idx[i]; k<rows_idx[i+1]; k++){
+            sum += values[k] * x[cols[k]];
+        }
+        store_result(y[i], alpha, sum, beta);
+    }
+}
+
+#ifdef SPARSE_SIMD_X86
+// Helper functions to load 4/8/16 column indices as 32-bit integers (16-bit indices are zero-extended)
+__attribute__((target("avx2")))
+inline __m128i load_idx4(const unsigned int *c){return _mm_loadu_si128(reinterpret_cast<const __m128i*>(c));}
+__attribute__((target("avx2")))
+inline __m128i load_idx4(const unsigned short *c){
+    return _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(c)));
+}
+__attribute__((target("avx2")))
+inline __m256i load_idx8(const unsigned int *c){return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c));}
+__attribute__((target("avx2")))
+inline __m256i load_idx8(const unsigned short *c){
+    return _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(c)));
+}
+__attribute__((target("avx512f")))
+inline __m512i load_idx16(const unsigned int *c){return _mm512_loadu_si512(c);}
+__attribute__((target("avx512f")))
+inline __m512i load_idx16(const unsigned short *c){
+    return _mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(c)));
+}
+
+// Helper functions to gather 4/8/16 elements of x and to reduce a vector of 8 doubles (or 16 floats)
+/* (GCC reports a false positive inside these intrinsics, which use "undefined" registers on purpose, so the
+    warning is disabled only around them) */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+__attribute__((target("avx2")))
+inline __m256d gather4(const double *x, const __m128i idx){return _mm256_i32gather_pd(x, idx, 8);}
+__attribute__((target("avx2")))
+inline __m256 gather8(const float *x, const __m256i idx){return _mm256_i32gather_ps(x, idx, 4);}
+__attribute__((target("avx512f")))
+inline __m512d gather8(const double *x, const __m256i idx){return _mm512_i32gather_pd(idx, x, 8);}
+__attribute__((target("avx512f")))
+inline __m512 gather16(const float *x, const __m512i idx){return _mm512_i32gather_ps(idx, x, 4);}
+__attribute__((target("avx512f")))
+inline double reduce_sum(const __m512d v){return _mm512_reduce_add_pd(v);}
+__attribute__((target("avx512f")))
+inline float reduce_sum(const __m512 v){return _mm512_reduce_add_ps(v);}
+#pragma GCC diagnostic pop
+
+/* Vectorized versions: each row is processed in blocks of 4/8/16 nonzeros, gathering x on the column indices
+   (gathers take signed 32-bit indices, so they are used only for 16/32-bit column indices and if n_cols<=INT_MAX),
+   then the partial sums of the row are reduced horizontally and the remaining nonzeros are added one by one */
+template <typename I, typename P>
+__attribute__((target("avx2,fma")))
+inline void csr_multiply_rows_avx2(const double *values, const I *cols, const P *rows_idx,
+                                   const unsigned int first, const unsigned int last,
+                                   const double alpha, const double *x, const double beta, double *y){
+    for(unsigned int i=first; i<last; i++){
+        P k=rows_idx[i];
+        const P end=rows_idx[i+1];
+        __m256d acc=_mm256_setzero_pd();
+        for(; k+4<=end; k+=4){
+            __m128i idx=load_idx4(cols+k);
+            __m256d xv=gather4(x, idx);
+            acc=_mm256_fmadd_pd(_mm256_loadu_pd(values+k), xv, acc);
+        }
+        __m128d half=_mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+        double sum=_mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+        for(; k<end; k++){
+            sum += values[k] * x[cols[k]];
+        }
+        store_result(y[i], alpha, sum, beta);
+    }
+}
+
+template <typename I, typename P>
+__attribute__((target("avx2,fma")))
+inline void csr_multiply_rows_avx2(const float *values, const I *cols, const P *rows_idx,
+                                   const unsigned int first, const unsigned int last,
+                                   const float alpha, const float *x, const float beta, float *y){
+    for(unsigned int i=first; i<last; i++){
+        P k=rows_idx[i];
+        const P end=rows_idx[i+1];
+        __m256 acc=_mm256_setzero_ps();
+        for(; k+8<=end; k+=8){
+            __m256i idx=load_idx8(cols+k);
+            __m256 xv=gather8(x, idx);
+            acc=_mm256_fmadd_ps(_mm256_loadu_ps(values+k), xv, acc);
+        }
+        __m128 quad=_mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+        quad=_mm_add_ps(quad, _mm_movehl_ps(quad, quad));
+        float sum=_mm_cvtss_f32(_mm_add_ss(quad, _mm_movehdup_ps(quad)));
+        for(; k<end; k++){
+            sum += values[k] * x[cols[k]];
+        }
+        store_result(y[i], alpha, sum, beta);
+    }
+}
+
+template <typename I, typename P>
+__attribute__((target("avx512f")))
+inline void csr_multiply_rows_avx512(const double *values, const I *cols, const P *rows_idx,
+                                     const unsigned int first, const unsigned int last,
+                                     const double alpha, const double *x, const double beta, double *y){
+    for(unsigned int i=first; i<last; i++){
+        P k=rows_idx[i];
+        const P end=rows_idx[i+1];
+        __m512d acc=_mm512_setzero_pd();
+        for(; k+8<=end; k+=8){
+            __m256i idx=load_idx8(cols+k);
+            __m512d xv=gather8(x, idx);
+            acc=_mm512_fmadd_pd(_mm512_loadu_pd(values+k), xv, acc);
+        }
+        double sum=reduce_sum(acc);
+        for(; k<end; k++){
+            sum += values[k] * x[cols[k]];
+        }
+        store_result(y[i], alpha, sum, beta);
+    }
+}
+
+template <typename I, typename P>
+__attribute__((target("avx512f")))
+inline void csr_multiply_rows_avx512(const float *values, const I *cols, const P *rows_idx,
+                                     const unsigned int first, const unsigned int last,
+                                     const float alpha, const float *x, const float beta, float *y){
+    for(unsigned int i=first; i<last; i++){
+        P k=rows_idx[i];
+        const P end=rows_idx[i+1];
+        __m512 acc=_mm512_setzero_ps();
+        for(; k+16<=end; k+=16){
+            __m512i idx=load_idx16(cols+k);
+            __m512 xv=gather16(x, idx);
+            acc=_mm512_fmadd_ps(_mm512_loadu_ps(values+k), xv, acc);
+        }
+        float sum=reduce_sum(acc);
+        for(; k<end; k++){
+            sum += values[k] * x[cols[k]];
+        }
+        store_result(y[i], alpha, sum, beta);
+    }
+}
+#endif
+
+// Dispatcher: vectorized version (chosen at runtime) for double and float, scalar version otherwise
+template <typename T, typename I, typename P>
+void csr_multiply_rows(const T *values, const I *cols, const P *rows_idx,
+                       const unsigned int first, const unsigned int last, const unsigned int n_cols,
+                       const T alpha, const T *x, const T beta, T *y){
+#ifdef SPARSE_SIMD_X86
+    if constexpr(simd_value_v<T> && simd_index_v<I>){
+        if(n_cols<=(unsigned int)INT_MAX){
+            switch(simd_level()){
+                case SimdLevel::AVX512: csr_multiply_rows_avx512(values, cols, rows_idx, first, last, alpha, x, beta, y); return;
+                case SimdLevel::AVX2:   csr_multiply_rows_avx2(values, cols, rows_idx, first, last, alpha, x, beta, y); return;
+                default: break;
+            }
+        }
+    }
+#endif
+    csr_multiply_rows_scalar(values, cols, rows_idx, first, last, alpha, x, beta, y);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// (3) COO kernel: y[rows[k]] += alpha*values[k]*x[cols[k]] for all the nonzeros
+/* Different nonzeros may belong to the same row, so the accumulation into y cannot be vectorized safely, and
+   vectorizing just the gathers and the products does not pay off: on a 200000x200000 matrix with 4M random
+   nonzeros (AVX-512 CPU) gathers + scalar scatter took 17-20 ms against 13 ms of this loop in double, and
+   13-15 ms against 8 ms in float (the scatter into y dominates and the gathers only add a pass through memory).
+   So the COO product always uses the scalar loop */
+template <typename T, typename I>
+void coo_multiply(const T *values, const I *cols, const I *rows,
+                  const unsigned long long nnz, const T alpha, const T *x, T *y){
+    for(unsigned long long k=0; k<nnz; k++){
+        y[rows[k]] += alpha * (values[k] * x[cols[k]]);
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// (4) SELL kernels: y[perm[p]] = alpha*sum_s values[idx]*x[cols[idx]] + beta*y[perm[p]] for the rows p of the chunks [first,last)
+/* In each chunk the s-th elements of the C rows are contiguous, so the C rows are processed together
+   (one row per lane), in groups of 16 (scalar), 4/8 (AVX2) or 8/16 (AVX-512) rows.
+   Sorted positions p>=n_rows are just padding of the last chunk, so they are not written back */
+template <typename T>
+void sell_multiply_chunks_scalar(const T *values, const unsigned int *cols, const unsigned int *chunks_idx,
+                                 const unsigned int *chunks_len, const unsigned int *perm, const unsigned int C,
+                                 const unsigned int n_rows, const unsigned int first, const unsigned int last,
+                                 const T alpha, const T *x, const T beta, T *y){
+    for(unsigned int k=first; k<last; k++){
+        for(unsigned int g=0; g<C; g+=16){
+            const unsigned int width = std::min(16u, C-g);
+            T acc[16]{};
+            for(unsigned int s=0; s<chunks_len[k]; s++){
+                const unsigned int base = chunks_idx[k]+s*C+g;
+                for(unsigned int l=0; l<width; l++){
+                    acc[l] += values[base+l] * x[cols[base+l]];
+                }
+            }
+            for(unsigned int l=0; l<width && k*C+g+l<n_rows; l++){
+                store_result(y[perm[k*C+g+l]], alpha, acc[l], beta);
+            }
+        }
+    }
+}
+
+#ifdef SPARSE_SIMD_X86
+__attribute__((target("avx2,fma")))
+inline void sell_multiply_chunks_avx2(const double *values, const unsigned int *cols, const unsigned int *chunks_idx,
+                                      const unsigned int *chunks_len, const unsigned int *perm, const unsigned int C,
+                                      const unsigned int n_rows, const unsigned int first, const unsigned int last,
+                                      const double alpha, const double *x, const double beta, double *y){
+    alignas(32) double acc_lanes[4];
+    for(unsigned int k=first; k<last; k++){
+        for(unsigned int g=0; g<C; g+=4){
+            __m256d acc=_mm256_setzero_pd();
+            for(unsigned int s=0; s<chunks_len[k]; s++){
+                const unsigned int base = chunks_idx[k]+s*C+g;
+                __m128i idx=_mm_loadu_si128(reinterpret_cast<const __m128i*>(cols+base));
+                acc=_mm256_fmadd_pd(_mm256_loadu_pd(values+base), gather4(x, idx), acc);
+            }
+            _mm256_store_pd(acc_lanes, acc);
+            for(unsigned int l=0; l<4 && k*C+g+l<n_rows; l++){
+                store_result(y[perm[k*C+g+l]], alpha, acc_lanes[l], beta);
+            }
+        }
+    }
+}
+
+__attribute__((target("avx2,fma")))
+inline void sell_multiply_chunks_avx2(const float *values, const unsigned int *cols, const unsigned int *chunks_idx,
+                                      const unsigned int *chunks_len, const unsigned int *perm, const unsigned int C,
+                                      const unsigned int n_rows, const unsigned int first, const unsigned int last,
+                                      const float alpha, const float *x, const float beta, float *y){
+    alignas(32) float acc_lanes[8];
+    for(unsigned int k=first; k<last; k++){
+        for(unsigned int g=0; g<C; g+=8){
+            __m256 acc=_mm256_setzero_ps();
+            for(unsigned int s=0; s<chunks_len[k]; s++){
+                const unsigned int base = chunks_idx[k]+s*C+g;
+                __m256i idx=_mm256_loadu_si256(reinterpret_cast<const __m256i*>(cols+base));
+                acc=_mm256_fmadd_ps(_mm256_loadu_ps(values+base), gather8(x, idx), acc);
+            }
+            _mm256_store_ps(acc_lanes, acc);
+            for(unsigned int l=0; l<8 && k*C+g+l<n_rows; l++){
+                store_result(y[perm[k*C+g+l]], alpha, acc_lanes[l], beta);
+            }
+        }
+    }
+}
+
+__attribute__((target("avx512f")))
+inline void sell_multiply_chunks_avx512(const double *values, const unsigned int *cols, const unsigned int *chunks_idx,
+                                        const unsigned int *chunks_len, const unsigned int *perm, const unsigned int C,
+                                        const unsigned int n_rows, const unsigned int first, const unsigned int last,
+                                        const double alpha, const double *x, const double beta, double *y){
+    alignas(64) double acc_lanes[8];
+    for(unsigned int k=first; k<last; k++){
+        for(unsigned int g=0; g<C; g+=8){
+            __m512d acc=_mm512_setzero_pd();
+            for(unsigned int s=0; s<chunks_len[k]; s++){
+                const unsigned int base = chunks_idx[k]+s*C+g;
+                __m256i idx=_mm256_loadu_si256(reinterpret_cast<const __m256i*>(cols+base));
+                acc=_mm512_fmadd_pd(_mm512_loadu_pd(values+base), gather8(x, idx), acc);
+            }
+            _mm512_store_pd(acc_lanes, acc);
+            for(unsigned int l=0; l<8 && k*C+g+l<n_rows; l++){
+                store_result(y[perm[k*C+g+l]], alpha, acc_lanes[l], beta);
+            }
+        }
+    }
+}
+
+__attribute__((target("avx512f")))
+inline void sell_multiply_chunks_avx512(const float *values, const unsigned int *cols, const unsigned int *chunks_idx,
+                                        const unsigned int *chunks_len, const unsigned int *perm, const unsigned int C,
+                                        const unsigned int n_rows, const unsigned int first, const unsigned int last,
+                                        const float alpha, const float *x, const float beta, float *y){
+    alignas(64) float acc_lanes[16];
+    for(unsigned int k=first; k<last; k++){
+        for(unsigned int g=0; g<C; g+=16){
+            __m512 acc=_mm512_setzero_ps();
+            for(unsigned int s=0; s<chunks_len[k]; s++){
+                const unsigned int base = chunks_idx[k]+s*C+g;
+                __m512i idx=_mm512_loadu_si512(cols+base);
+                acc=_mm512_fmadd_ps(_mm512_loadu_ps(values+base), gather16(x, idx), acc);
+            }
+            _mm512_store_ps(acc_lanes, acc);
+            for(unsigned int l=0; l<16 && k*C+g+l<n_rows; l++){
+                store_result(y[perm[k*C+g+l]], alpha, acc_lanes[l], beta);
+            }
+        }
+    }
+}
+#endif
+
+// Dispatcher: vectorized version (chosen at runtime) if C is a multiple of the SIMD width, scalar version otherwise
+template <typename T>
+void sell_multiply_chunks(const T *values, const unsigned int *cols, const unsigned int *chunks_idx,
+                          const unsigned int *chunks_len, const unsigned int *perm, const unsigned int C,
+                          const unsigned int n_rows, const unsigned int first, const unsigned int last,
+                          const unsigned int n_cols, const T alpha, const T *x, const T beta, T *y){
+#ifdef SPARSE_SIMD_X86
+    if constexpr(std::is_same_v<T, double> || std::is_same_v<T, float>){
+        // Number of elements of type T in a 256-bit register
+        constexpr unsigned int width = 32/sizeof(T);
+        if(n_cols<=(unsigned int)INT_MAX){
+            if(simd_level()>=SimdLevel::AVX512 && C%(2*width)==0){
+                sell_multiply_chunks_avx512(values, cols, chunks_idx, chunks_len, perm, C, n_rows, first, last, alpha, x, beta, y);
+                return;
+            }
+            if(simd_level()>=SimdLevel::AVX2 && C%width==0){
+                sell_multiply_chunks_avx2(values, cols, chunks_idx, chunks_len, perm, C, n_rows, first, last, alpha, x, beta, y);
+                return;
+            }
+        }
+    }
+#endif
+    sell_multiply_chunks_scalar(values, cols, chunks_idx, chunks_len, perm, C, n_rows, first, last, alpha, x, beta, y);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// (5) CSR multi-vector kernels: Y(i,:) = alpha*sum_k values[k]*X(cols[k],:) + beta*Y(i,:) for the rows [first,last)
+/* X (n_cols x n_vec) and Y (n_rows x n_vec) are dense and row-major, so each nonzero of the matrix scales a
+   contiguous row of X: the matrix is read just once per tile of columns of Y (instead of once per vector),
+   and the columns of the tile are processed by SIMD lanes (up to 4 registers, the last ones masked).
+   As for the other kernels, if beta is 0 Y is just overwritten (so it may be uninitialized) */
+template <typename T, typename I, typename P>
+void csr_multiply_vectors_scalar(const T *values, const I *cols, const P *rows_idx,
+                                 const unsigned int first, const unsigned int last, const unsigned int n_vec,
+                                 const T alpha, const T *X, const T beta, T *Y){
+    std::vector<T> sum(n_vec);
+    for(unsigned int i=first; i<last; i++){
+        std::fill(sum.begin(), sum.end(), T(0));
+        for(P k=rows_idx[i]; k<rows_idx[i+1]; k++){
+            const T *x = X + (size_t)cols[k]*n_vec;
+            for(unsigned int c=0; c<n_vec; c++){
+                sum[c] += values[k] * x[c];
+            }
+        }
+        T *y = Y + (size_t)i*n_vec;
+        for(unsigned int c=0; c<n_vec; c++){
+            store_result(y[c], alpha, sum[c], beta);
+        }
+    }
+}
+
+#ifdef SPARSE_SIMD_X86
+// Helper functions to write alpha*acc+beta*y in the lanes of y selected by the mask (if beta is 0, y is not read)
+__attribute__((target("avx2,fma")))
+inline void store_lanes(double *y, const __m256i mask, const __m256d acc, const double alpha, const double beta){
+    __m256d result=_mm256_mul_pd(_mm256_set1_pd(alpha), acc);
+    if(beta!=0.) result=_mm256_fmadd_pd(_mm256_set1_pd(beta), _mm256_maskload_pd(y, mask), result);
+    _mm256_maskstore_pd(y, mask, result);
+}
+__attribute__((target("avx2,fma")))
+inline void store_lanes(float *y, const __m256i mask, const __m256 acc, const float alpha, const float beta){
+    __m256 result=_mm256_mul_ps(_mm256_set1_ps(alpha), acc);
+    if(beta!=0.f) result=_mm256_fmadd_ps(_mm256_set1_ps(beta), _mm256_maskload_ps(y, mask), result);
+    _mm256_maskstore_ps(y, mask, result);
+}
+__attribute__((target("avx512f")))
+inline void store_lanes(double *y, const __mmask8 mask, const __m512d acc, const double alpha, const double beta){
+    __m512d result=_mm512_mul_pd(_mm512_set1_pd(alpha), acc);
+    if(beta!=0.) result=_mm512_fmadd_pd(_mm512_set1_pd(beta), _mm512_maskz_loadu_pd(mask, y), result);
+    _mm512_mask_storeu_pd(y, mask, result);
+}
+__attribute__((target("avx512f")))
+inline void store_lanes(float *y, const __mmask16 mask, const __m512 acc, const float alpha, const float beta){
+    __m512 result=_mm512_mul_ps(_mm512_set1_ps(alpha), acc);
+    if(beta!=0.f) result=_mm512_fmadd_ps(_mm512_set1_ps(beta), _mm512_maskz_loadu_ps(mask, y), result);
+    _mm512_mask_storeu_ps(y, mask, result);
+}
+
+template <typename I, typename P>
+__attribute__((target("avx2,fma")))
+inline void csr_multiply_vectors_avx2(const double *values, const I *cols, const P *rows_idx,
+                                      const unsigned int first, const unsigned int last, const unsigned int n_vec,
+                                      const double alpha, const double *X, const double beta, double *Y){
+    for(unsigned int c0=0; c0<n_vec; c0+=16){
+        // Masks of the 4 registers of the tile (lanes beyond n_vec are neither loaded nor stored)
+        const unsigned int width = std::min(16u, n_vec-c0);
+        const unsigned int n_reg = (width+3)/4;
+        __m256i mask[4];
+        for(unsigned int v=0; v<4; v++){
+            const int lanes = std::max(0, std::min(4, (int)width-(int)(4*v)));
+            mask[v] = _mm256_cmpgt_epi64(_mm256_set1_epi64x(lanes), _mm256_setr_epi64x(0,1,2,3));
+        }
+        for(unsigned int i=first; i<last; i++){
+            __m256d acc0=_mm256_setzero_pd(), acc1=_mm256_setzero_pd(), acc2=_mm256_setzero_pd(), acc3=_mm256_setzero_pd();
+            for(P k=rows_idx[i]; k<rows_idx[i+1]; k++){
+                const __m256d a=_mm256_set1_pd(values[k]);
+                const double *x = X + (size_t)cols[k]*n_vec + c0;
+                acc0=_mm256_fmadd_pd(a, _mm256_maskload_pd(x, mask[0]), acc0);
+                if(n_reg>1) acc1=_mm256_fmadd_pd(a, _mm256_maskload_pd(x+4, mask[1]), acc1);
+                if(n_reg>2) acc2=_mm256_fmadd_pd(a, _mm256_maskload_pd(x+8, mask[2]), acc2);
+                if(n_reg>3) acc3=_mm256_fmadd_pd(a, _mm256_maskload_pd(x+12, mask[3]), acc3);
+            }
+            double *y = Y + (size_t)i*n_vec + c0;
+            store_lanes(y, mask[0], acc0, alpha, beta);
+            if(n_reg>1) store_lanes(y+4, mask[1], acc1, alpha, beta);
+            if(n_reg>2) store_lanes(y+8, mask[2], acc2, alpha, beta);
+            if(n_reg>3) store_lanes(y+12, mask[3], acc3, alpha, beta);
+        }
+    }
+}
+
+template <typename I, typename P>
+__attribute__((target("avx2,fma")))
+inline void csr_multiply_vectors_avx2(const float *values, const I *cols, const P *rows_idx,
+                                      const unsigned int first, const unsigned int last, const unsigned int n_vec,
+                                      const float alpha, const float *X, const float beta, float *Y){
+    for(unsigned int c0=0; c0<n_vec; c0+=32){
+        // Masks of the 4 registers of the tile (lanes beyond n_vec are neither loaded nor stored)
+        const unsigned int width = std::min(32u, n_vec-c0);
+        const unsigned int n_reg = (width+7)/8;
+        __m256i mask[4];
+        for(unsigned int v=0; v<4; v++){
+            const int lanes = std::max(0, std::min(8, (int)width-(int)(8*v)));
+            mask[v] = _mm256_cmpgt_epi32(_mm256_set1_epi32(lanes), _mm256_setr_epi32(0,1,2,3,4,5,6,7));
+        }
+        for(unsigned int i=first; i<last; i++){
+            __m256 acc0=_mm256_setzero_ps(), acc1=_mm256_setzero_ps(), acc2=_mm256_setzero_ps(), acc3=_mm256_setzero_ps();
+            for(P k=rows_idx[i]; k<rows_idx[i+1]; k++){
+                const __m256 a=_mm256_set1_ps(values[k]);
+                const float *x = X + (size_t)cols[k]*n_vec + c0;
+                acc0=_mm256_fmadd_ps(a, _mm256_maskload_ps(x, mask[0]), acc0);
+                if(n_reg>1) acc1=_mm256_fmadd_ps(a, _mm256_maskload_ps(x+8, mask[1]), acc1);
+                if(n_reg>2) acc2=_mm256_fmadd_ps(a, _mm256_maskload_ps(x+16, mask[2]), acc2);
+                if(n_reg>3) acc3=_mm256_fmadd_ps(a, _mm256_maskload_ps(x+24, mask[3]), acc3);
+            }
+            float *y = Y + (size_t)i*n_vec + c0;
+            store_lanes(y, mask[0], acc0, alpha, beta);
+            if(n_reg>1) store_lanes(y+8, mask[1], acc1, alpha, beta);
+            if(n_reg>2) store_lanes(y+16, mask[2], acc2, alpha, beta);
+            if(n_reg>3) store_lanes(y+24, mask[3], acc3, alpha, beta);
+        }
+    }
+}
+
+template <typename I, typename P>
+__attribute__((target("avx512f")))
+inline void csr_multiply_vectors_avx512(const double *values, const I *cols, const P *rows_idx,
+                                        const unsigned int first, const unsigned int last, const unsigned int n_vec,
+                                        const double alpha, const double *X, const double beta, double *Y){
+    for(unsigned int c0=0; c0<n_vec; c0+=32){
+        // Masks of the 4 registers of the tile (lanes beyond n_vec are neither loaded nor stored)
+        const unsigned int width = std::min(32u, n_vec-c0);
+        const unsigned int n_reg = (width+7)/8;
+        __mmask8 mask[4];
+        for(unsigned int v=0; v<4; v++){
+            const int lanes = std::max(0, std::min(8, (int)width-(int)(8*v)));
+            mask[v] = (__mmask8)((1u<<lanes)-1);
+        }
+        for(unsigned int i=first; i<last; i++){
+            __m512d acc0=_mm512_setzero_pd(), acc1=_mm512_setzero_pd(), acc2=_mm512_setzero_pd(), acc3=_mm512_setzero_pd();
+            for(P k=rows_idx[i]; k<rows_idx[i+1]; k++){
+                const __m512d a=_mm512_set1_pd(values[k]);
+                const double *x = X + (size_t)cols[k]*n_vec + c0;
+                acc0=_mm512_fmadd_pd(a, _mm512_maskz_loadu_pd(mask[0], x), acc0);
+                if(n_reg>1) acc1=_mm512_fmadd_pd(a, _mm512_maskz_loadu_pd(mask[1], x+8), acc1);
+                if(n_reg>2) acc2=_mm512_fmadd_pd(a, _mm512_maskz_loadu_pd(mask[2], x+16), acc2);
+                if(n_reg>3) acc3=_mm512_fmadd_pd(a, _mm512_maskz_loadu_pd(mask[3], x+24), acc3);
+            }
+            double *y = Y + (size_t)i*n_vec + c0;
+            store_lanes(y, mask[0], acc0, alpha, beta);
+            if(n_reg>1) store_lanes(y+8, mask[1], acc1, alpha, beta);
+            if(n_reg>2) store_lanes(y+16, mask[2], acc2, alpha, beta);
+            if(n_reg>3) store_lanes(y+24, mask[3], acc3, alpha, beta);
+        }
+    }
+}
+
+template <typename I, typename P>
+__attribute__((target("avx512f")))
+inline void csr_multiply_vectors_avx512(const float *values, const I *cols, const P *rows_idx,
+                                        const unsigned int first, const unsigned int last, const unsigned int n_vec,
+                                        const float alpha, const float *X, const float beta, float *Y){
+    for(unsigned int c0=0; c0<n_vec; c0+=64){
+        // Masks of the 4 registers of the tile (lanes beyond n_vec are neither loaded nor stored)
+        const unsigned int width = std::min(64u, n_vec-c0);
+        const unsigned int n_reg = (width+15)/16;
+        __mmask16 mask[4];
+        for(unsigned int v=0; v<4; v++){
+            const int lanes = std::max(0, std::min(16, (int)width-(int)(16*v)));
+            mask[v] = (__mmask16)((1u<<lanes)-1);
+        }
+        for(unsigned int i=first; i<last; i++){
+            __m512 acc0=_mm512_setzero_ps(), acc1=_mm512_setzero_ps(), acc2=_mm512_setzero_ps(), acc3=_mm512_setzero_ps();
+            for(P k=rows_idx[i]; k<rows_idx[i+1]; k++){
+                const __m512 a=_mm512_set1_ps(values[k]);
+                const float *x = X + (size_t)cols[k]*n_vec + c0;
+                acc0=_mm512_fmadd_ps(a, _mm512_maskz_loadu_ps(mask[0], x), acc0);
+                if(n_reg>1) acc1=_mm512_fmadd_ps(a, _mm512_maskz_loadu_ps(mask[1], x+16), acc1);
+                if(n_reg>2) acc2=_mm512_fmadd_ps(a, _mm512_maskz_loadu_ps(mask[2], x+32), acc2);
+                if(n_reg>3) acc3=_mm512_fmadd_ps(a, _mm512_maskz_loadu_ps(mask[3], x+48), acc3);
+            }
+            float *y = Y + (size_t)i*n_vec + c0;
+            store_lanes(y, mask[0], acc0, alpha, beta);
+            if(n_reg>1) store_lanes(y+16, mask[1], acc1, alpha, beta);
+            if(n_reg>2) store_lanes(y+32, mask[2], acc2, alpha, beta);
+            if(n_reg>3) store_lanes(y+48, mask[3], acc3, alpha, beta);
+        }
+    }
+}
+#endif
+
+// Dispatcher: vectorized version (chosen at runtime) for double and float, scalar version otherwise
+template <typename T, typename I, typename P>
+void csr_multiply_vectors(const T *values, const I *cols, const P *rows_idx,
+                          const unsigned int first, const unsigned int last, const unsigned int n_vec,
+                          const T alpha, const T *X, const T beta, T *Y){
+#ifdef SPARSE_SIMD_X86
+    if constexpr(simd_value_v<T>){
+        switch(simd_level()){
+            case SimdLevel::AVX512: csr_multiply_vectors_avx512(values, cols, rows_idx, first, last, n_vec, alpha, X, beta, Y); return;
+            case SimdLevel::AVX2:   csr_multiply_vectors_avx2(values, cols, rows_idx, first, last, n_vec, alpha, X, beta, Y); return;
+            default: break;
+        }
+    }
+#endif
+    csr_multiply_vectors_scalar(values, cols, rows_idx, first, last, n_vec, alpha, X, beta, Y);
+}
+//---------------------------------------------------------------------------------------------------------------------
+// (6) Transposed CSR kernel: y[cols[k]] += alpha*x[i]*values[k] for the rows i in [first,last)
+/* The nonzeros of a row scatter into different entries of y, which may also be updated by other rows:
+   without conflict detection the accumulation cannot be vectorized safely, so there is just the scalar version.
+   The values may be stored in a narrower type V (as in the Mixed format): they are converted to T as they are loaded */
+template <typename T, typename V, typename I, typename P>
+void csr_scatter_rows(const V *values, const I *cols, const P *rows_idx,
+                      const unsigned int first, const unsigned int last, const T alpha, const T *x, T *y){
+    for(unsigned int i=first; i<last; i++){
+        const T xi = alpha*x[i];
+        for(P k=rows_idx[i]; k<rows_idx[i+1]; k++){
+            y[cols[k]] += static_cast<T>(values[k])*xi;
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// (7) Sorted search kernels: position of the first element >= key in a sorted array a of length n (lower bound)
+/* For short arrays we just count the elements < key (no branches, and with AVX2 8 comparisons at a time);
+   for longer ones we use a branchless binary search, whose halving step compiles to a conditional move */
+template <typename I>
+inline unsigned int sorted_count_less_scalar(const I *a, const unsigned int n, const I key){
+    unsigned int count=0;
+    for(unsigned int k=0; k<n; k++){
+        count += (a[k] < key);
+    }
+    return count;
+}
+
+#ifdef SPARSE_SIMD_X86
+__attribute__((target("avx2")))
+inline unsigned int sorted_count_less_avx2(const unsigned int *a, const unsigned int n, const unsigned int key){
+    // AVX2 has just signed comparisons: flipping the sign bit of both sides gives the unsigned order
+    const __m256i sign=_mm256_set1_epi32(INT_MIN);
+    const __m256i k=_mm256_xor_si256(_mm256_set1_epi32((int)key), sign);
+    unsigned int count=0, i=0;
+    for(; i+8<=n; i+=8){
+        __m256i v=_mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a+i)), sign);
+        count += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(k, v))));
+    }
+    return count + sorted_count_less_scalar(a+i, n-i, key);
+}
+#endif
+
+template <typename I>
+inline unsigned int sorted_lower_bound_scalar(const I *a, unsigned int n, const I key){
+    if(n==0){
+        return 0;
+    }
+    // The answer is always in [base, base+n]: each step halves n without branching on the comparison
+    const I *base=a;
+    while(n>1){
+        const unsigned int half=n/2;
+        base = (base[half] < key) ? base+half : base;
+        n -= half;
+    }
+    return (base-a) + (*base < key);
+}
+
+// Dispatcher: counting for short arrays (vectorized for 32-bit indices if the CPU allows it), binary search otherwise
+template <typename I>
+inline unsigned int sorted_lower_bound(const I *a, const unsigned int n, const I key){
+    if(n<=32){
+#ifdef SPARSE_SIMD_X86
+        if constexpr(std::is_same_v<I, unsigned int>){
+            if(simd_level()>=SimdLevel::AVX2){
+                return sorted_count_less_avx2(a, n, key);
+            }
+        }
+#endif
+        return sorted_count_less_scalar(a, n, key);
+    }
+    return sorted_lower_bound_scalar(a, n, key);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// (8) Mixed precision CSR kernels: y[i] = alpha*sum_k T(values[k])*x[cols[k]] + beta*y[i] for the rows [first,last)
+/* The values are stored in a narrower type S (float or bfloat16) and converted to T (double) as they are loaded,
+   so the products and the sums are done in T: only the rounding of the stored values changes the result */
+template <typename T, typename S, typename I, typename P>
+void csr_mixed_rows_scalar(const S *values, const I *cols, const P *rows_idx,
+                           const unsigned int first, const unsigned int last,
+                           const T alpha, const T *x, const T beta, T *y){
+    for(unsigned int i=first; i<last; i++){
+        T sum=0;
+        for(P k=rows_idx[i]; k<rows_idx[i+1]; k++){
+            sum += static_cast<T>(values[k]) * x[cols[k]];
+        }
+        store_result(y[i], alpha, sum, beta);
+    }
+}
+
+// Storage types with vectorized mixed precision kernels (with double accumulation)
+template <typename S>
+inline constexpr bool simd_low_v = std::is_same_v<S, float> || std::is_same_v<S, bfloat16>;
+
+#ifdef SPARSE_SIMD_X86
+// Helper functions to load 4/8 stored values as doubles (a bfloat16 is the upper half of a float)
+__attribute__((target("avx2")))
+inline __m256d load_low4(const float *v){return _mm256_cvtps_pd(_mm_loadu_ps(v));}
+__attribute__((target("avx2")))
+inline __m256d load_low4(const bfloat16 *v){
+    const __m128i halves=_mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(v)));
+    return _mm256_cvtps_pd(_mm_castsi128_ps(_mm_slli_epi32(halves, 16)));
+}
+// (same false positive of the gathers inside the conversion to 8 doubles)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+__attribute__((target("avx512f")))
+inline __m512d load_low8(const float *v){return _mm512_cvtps_pd(_mm256_loadu_ps(v));}
+__attribute__((target("avx512f")))
+inline __m512d load_low8(const bfloat16 *v){
+    const __m256i halves=_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(v)));
+    return _mm512_cvtps_pd(_mm256_castsi256_ps(_mm256_slli_epi32(halves, 16)));
+}
+#pragma GCC diagnostic pop
+
+// Vectorized versions (the same blocks of 4/8 nonzeros of the double CSR kernels)
+template <typename S, typename I, typename P>
+__attribute__((target("avx2,fma")))
+inline void csr_mixed_rows_avx2(const S *values, const I *cols, const P *rows_idx,
+                                const unsigned int first, const unsigned int last,
+                                const double alpha, const double *x, const double beta, double *y){
+    for(unsigned int i=first; i<last; i++){
+        P k=rows_idx[i];
+        const P end=rows_idx[i+1];
+        __m256d acc=_mm256_setzero_pd();
+        for(; k+4<=end; k+=4){
+            __m256d xv=gather4(x, load_idx4(cols+k));
+            acc=_mm256_fmadd_pd(load_low4(values+k), xv, acc);
+        }
+        __m128d half=_mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+        double sum=_mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+        for(; k<end; k++){
+            sum += static_cast<double>(values[k]) * x[cols[k]];
+        }
+        store_result(y[i], alpha, sum, beta);
+    }
+}
+
+template <typename S, typename I, typename P>
+__attribute__((target("avx512f")))
+inline void csr_mixed_rows_avx512(const S *values, const I *cols, const P *rows_idx,
+                                  const unsigned int first, const unsigned int last,
+                                  const double alpha, const double *x, const double beta, double *y){
+    for(unsigned int i=first; i<last; i++){
+        P k=rows_idx[i];
+        const P end=rows_idx[i+1];
+        __m512d acc=_mm512_setzero_pd();
+        for(; k+8<=end; k+=8){
+            __m512d xv=gather8(x, load_idx8(cols+k));
+            acc=_mm512_fmadd_pd(load_low8(values+k), xv, acc);
+        }
+        double sum=reduce_sum(acc);
+        for(; k<end; k++){
+            sum += static_cast<double>(values[k]) * x[cols[k]];
+        }
+        store_result(y[i], alpha, sum, beta);
+    }
+}
+#endif
+
+// Dispatcher: vectorized version (chosen at runtime) for float/bfloat16 values with double accumulation
+template <typename T, typename S, typename I, typename P>
+void csr_mixed_rows(const S *values, const I *cols, const P *rows_idx,
+                    const unsigned int first, const unsigned int last, const unsigned int n_cols,
+                    const T alpha, const T *x, const T beta, T *y){
+#ifdef SPARSE_SIMD_X86
+    if constexpr(std::is_same_v<T, double> && simd_low_v<S> && simd_index_v<I>){
+        if(n_cols<=(unsigned int)INT_MAX){
+            switch(simd_level()){
+                case SimdLevel::AVX512: csr_mixed_rows_avx512(values, cols, rows_idx, first, last, alpha, x, beta, y); return;
+                case SimdLevel::AVX2:   csr_mixed_rows_avx2(values, cols, rows_idx, first, last, alpha, x, beta, y); return;
+                default: break;
+            }
+        }
+    }
+#endif
+    csr_mixed_rows_scalar(values, cols, rows_idx, first, last, alpha, x, beta, y);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+#endif
@@ -4,7 +4,31 @@
 #include<vector>
 #include<cassert>
 #include<iomanip>
+#include<cmath>
+#include<string>
+#include<thread>
+#include<chrono>
+#include<random>
+#include<cstdio>
+#include<stdexcept>
 #include "include/SparseMatrix.hpp"
+#include "include/Solvers.hpp"
+#include "include/Assembler.hpp"
+#include "include/Reordering.hpp"
+#include "include/MatrixIO.hpp"
+#include "include/FormatSelector.hpp"
+#include "include/SparseVector.hpp"
+//---------------------------------------------------------------------------------------------------------------------
+// Function to measure the mean time (in milliseconds) of n_reps products y = A*x
+template <typename M>
+double time_products(M &matrix, const std::vector<double> &x, std::vector<double> &y, const unsigned int n_reps){
+    auto t0 = std::chrono::steady_clock::now();
+    for(unsigned int r=0; r<n_reps; r++){
+        matrix.multiply(1., x, 0., y);
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()-t0).count()/n_reps;
+}
+
 //---------------------------------------------------------------------------------------------------------------------
 int main(){
     //Set the precision to which i want to print doubles
@@ -121,6 +145,40 @@ int main(){
     INT_COO.get_info();
     std::cout<<std::endl;
 
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    std::cout<<  "                  COO HASH INDEX TEST                    "<<std::endl;
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    /*We assemble the same 300x300 tridiagonal matrix by writing one element at a time (then we remove the
+      upper diagonal), with and without the hash index: the results must be the same*/
+    SparseMatrixCOO<double> LIN_COO{300,300,{},{},{}};
+    SparseMatrixCOO<double> HASH_COO{300,300,{},{},{}};
+    HASH_COO.set_indexed(true);
+    for(SparseMatrixCOO<double> *matrix : {&LIN_COO, &HASH_COO}){
+        for(unsigned int i=0; i<300; i++){
+            for(unsigned int j=(i>0 ? i-1 : 0); j<std::min(i+2,300u); j++){
+                (*matrix)(i,j) = (i==j) ? 2. : -1.;
+            }
+        }
+        for(unsigned int i=0; i+1<300; i++){
+            (*matrix)(i,i+1) = 0;
+        }
+    }
+    bool same_elements = LIN_COO.get_nzeros()==HASH_COO.get_nzeros();
+    for(unsigned int i=0; i<300; i++){
+        for(unsigned int j=0; j<300; j++){
+            same_elements = same_elements && (double)LIN_COO(i,j)==(double)HASH_COO(i,j);
+        }
+    }
+    std::cout<<"HASH_COO indexed: "<<(HASH_COO.is_indexed() ? "yes" : "no")<<", "<<HASH_COO.get_nzeros()<<" nonzeros"<<std::endl;
+    std::cout<<"Same elements with and without the index: "<<(same_elements ? "yes" : "no")<<std::endl;
+    /*With duplicate coordinates, removing (0,0) makes the next occurrence visible, with and without the index*/
+    SparseMatrixCOO<double> DUP_COO{2,2,{1.,2.,3.},{0,1,0},{0,1,0}};
+    DUP_COO.set_indexed(true);
+    DUP_COO(0,0) = 0;
+    std::cout<<"Duplicate (0,0) after removing the first one (indexed): "<<(double)DUP_COO(0,0)<<std::endl;
+    std::cout<<std::endl;
+
     ////////////////////////////////////////////////////////////////////////////////////
     std::cout << "/////////////////////////////////////////////////////////"<<std::endl;
     std::cout << "/////////////////////  CSR TESTS ////////////////////////"<<std::endl;
@@ -201,6 +259,126 @@ int main(){
     print_vector<double>(res);
     std::cout<<std::endl;
 
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    std::cout<<  "     PARALLEL MATRIX(CSR)-VECTOR MULTIPLICATION TEST     "<<std::endl;
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    /*We build a 1000x1000 "skewed" matrix: the first rows are dense, the others have just the diagonal*/
+    unsigned int big_n=1000;
+    std::vector<double> big_values;
+    std::vector<unsigned int> big_cols;
+    std::vector<unsigned int> big_rows_idx{0};
+    for(unsigned int i=0; i<big_n; i++){
+        unsigned int row_nnz = (i<10) ? big_n : 1;
+        for(unsigned int k=0; k<row_nnz; k++){
+            big_cols.push_back((row_nnz==1) ? i : k);
+            big_values.push_back(1.0/(i+k+1));
+        }
+        big_rows_idx.push_back(big_cols.size());
+    }
+    SparseMatrixCSR<double> BIG_CSR{big_n,big_n,big_values,big_cols,big_rows_idx};
+    std::vector<double> big_vec(big_n);
+    for(unsigned int i=0; i<big_n; i++) big_vec[i]=i%7;
+    std::vector<double> serial_res = BIG_CSR*big_vec;
+    BIG_CSR.set_threads(4);
+    std::vector<double> parallel_res = BIG_CSR*big_vec;
+    std::cout<<"Row blocks with 4 threads (nnz-balanced): ";
+    print_vector<unsigned int>(nnz_partition(BIG_CSR.get_rows_idx(),4));
+    std::cout<<"Parallel result equal to serial one: "<<(serial_res==parallel_res ? "yes" : "no")<<std::endl;
+    std::cout<<std::endl;
+
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    std::cout<<  "    VECTORIZED MATRIX-VECTOR MULTIPLICATION TEST (SIMD)  "<<std::endl;
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    /*Vectorized kernels sum each row in a different order, so we compare them with a tolerance*/
+    SimdLevel best_level = simd_level();
+    std::cout<<"Best instruction set supported by this CPU: "<<simd_name(best_level)<<std::endl;
+    BIG_CSR.set_threads(1);
+    std::vector<float> big_values_f(big_values.begin(), big_values.end());
+    std::vector<float> big_vec_f(big_vec.begin(), big_vec.end());
+    SparseMatrixCSR<float> BIG_CSR_F{big_n,big_n,big_values_f,big_cols,big_rows_idx};
+    set_simd_level(SimdLevel::Scalar);
+    std::vector<double> scalar_res = BIG_CSR*big_vec;
+    std::vector<float> scalar_res_f = BIG_CSR_F*big_vec_f;
+    for(SimdLevel level : {SimdLevel::AVX2, SimdLevel::AVX512}){
+        if(level>best_level) continue;
+        set_simd_level(level);
+        std::vector<double> simd_res = BIG_CSR*big_vec;
+        std::vector<float> simd_res_f = BIG_CSR_F*big_vec_f;
+        double max_err=0., max_err_f=0.;
+        for(unsigned int i=0; i<big_n; i++){
+            max_err = std::max(max_err, std::abs(simd_res[i]-scalar_res[i]));
+            max_err_f = std::max(max_err_f, (double)std::abs(simd_res_f[i]-scalar_res_f[i]));
+        }
+        std::cout<<simd_name(level)<<" kernels, max difference from scalar: "<<std::scientific
+                 <<max_err<<" (double), "<<max_err_f<<" (float)"<<std::fixed<<std::endl;
+    }
+    set_simd_level(best_level);
+    std::cout<<std::endl;
+
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    std::cout<<  "      MATRIX(CSR)-MULTIPLE VECTORS MULTIPLICATION TEST   "<<std::endl;
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    /*The two vectors [1,1,1,1,1] and [0,1,0,0,0] as columns of a 5x2 (row-major) matrix*/
+    std::vector<double> two_vecs{1.,0., 1.,1., 1.,0., 1.,0., 1.,0.};
+    std::vector<double> two_res = M_CSR.multiply_vectors(two_vecs, 2);
+    std::cout<<"Multiplication by [[1,0],[1,1],[1,0],[1,0],[1,0]] (4x2 result, row-major): ";
+    print_vector<double>(two_res);
+    /*On the 1000x1000 matrix with 8 vectors, compared with 8 single products*/
+    unsigned int n_vec=8;
+    std::vector<double> big_vecs(big_n*n_vec);
+    for(unsigned int i=0; i<big_n*n_vec; i++) big_vecs[i]=(i%11)*0.5;
+    std::vector<double> big_vecs_res = BIG_CSR.multiply_vectors(big_vecs, n_vec);
+    double vecs_err=0.;
+    for(unsigned int v=0; v<n_vec; v++){
+        std::vector<double> single(big_n);
+        for(unsigned int i=0; i<big_n; i++) single[i]=big_vecs[i*n_vec+v];
+        std::vector<double> single_res = BIG_CSR*single;
+        for(unsigned int i=0; i<big_n; i++){
+            vecs_err = std::max(vecs_err, std::abs(single_res[i]-big_vecs_res[i*n_vec+v]));
+        }
+    }
+    std::cout<<"1000x1000 matrix times 8 vectors, max difference from 8 single products: "
+             <<std::scientific<<vecs_err<<std::fixed<<std::endl;
+    /*In place, with Y = A*X already computed: 2*A*X + 3*Y should be 5*A*X*/
+    std::vector<double> big_vecs_acc = big_vecs_res;
+    BIG_CSR.multiply_vectors(2., big_vecs, 3., big_vecs_acc, n_vec);
+    double acc_err=0.;
+    for(size_t i=0; i<big_vecs_acc.size(); i++){
+        acc_err = std::max(acc_err, std::abs(big_vecs_acc[i]-5.*big_vecs_res[i]));
+    }
+    std::cout<<"In place Y = 2*A*X + 3*Y (with Y = A*X), max difference from 5*A*X: "
+             <<std::scientific<<acc_err<<std::fixed<<std::endl;
+    std::cout<<std::endl;
+
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    std::cout<<  "   MATRIX(CSR)-MATRIX(CSR) MULTIPLICATION TEST (SpGEMM)  "<<std::endl;
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    /*Product of M_CSR (4x5) with a 5x3 matrix*/
+    std::vector<double> right_values{1,2,1,3,1,1};
+    std::vector<unsigned int> right_cols{0,2,1,0,2,1};
+    std::vector<unsigned int> right_rows_idx{0,2,3,3,5,6};
+    SparseMatrixCSR<double> RIGHT_CSR{5,3,right_values,right_cols,right_rows_idx};
+    std::cout<<"Let's multiply M_CSR by the following matrix (RIGHT_CSR):"<<std::endl;
+    RIGHT_CSR.print();
+    SparseMatrixCSR<double> PROD_CSR = M_CSR*RIGHT_CSR;
+    std::cout<<"M_CSR*RIGHT_CSR:"<<std::endl;
+    PROD_CSR.print();
+    PROD_CSR.get_info();
+    /*On the 1000x1000 matrix: square of the matrix, serial and parallel*/
+    SparseMatrixCSR<double> BIG_SQUARE = BIG_CSR*BIG_CSR;
+    BIG_CSR.set_threads(4);
+    SparseMatrixCSR<double> BIG_SQUARE_PAR = BIG_CSR*BIG_CSR;
+    BIG_CSR.set_threads(1);
+    std::cout<<"Square of the 1000x1000 matrix: "<<BIG_SQUARE.get_nzeros()<<" nonzeros"<<std::endl;
+    std::cout<<"Parallel result equal to serial one: "
+             <<(BIG_SQUARE.get_values()==BIG_SQUARE_PAR.get_values() && BIG_SQUARE.get_cols()==BIG_SQUARE_PAR.get_cols() ? "yes" : "no")
+             <<std::endl;
+    std::cout<<std::endl;
+
     ////////////////////////////////////////////////////////////////////////////////////
     std::cout << "---------------------------------------------------------"<<std::endl;
     std::cout<<  "        ALTERNATIVE PRINT FOR LARGE CSR MATRICES         "<<std::endl;
@@ -209,6 +387,30 @@ int main(){
     std::cout<<"Print of a 15x15 CSR sparse matrix"<<std::endl;
     M2_CSR.print();
 
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    std::cout<<  "              CSR SORTED ROWS AND LOOKUP TEST            "<<std::endl;
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    /*Columns given in any order are sorted by the constructor (values follow their columns)*/
+    SparseMatrixCSR<double> UNSORTED_CSR{2,5,{1,2,3,4,5},{4,0,2,3,1},{0,3,5}};
+    std::cout<<"Matrix built from unsorted columns [4,0,2 | 3,1]:"<<std::endl;
+    UNSORTED_CSR.print();
+    UNSORTED_CSR.get_info();
+    /*A 1x5000 matrix with a nonzero every 3 columns: lookups use a binary search inside the (long) row*/
+    std::vector<double> long_values;
+    std::vector<unsigned int> long_cols;
+    for(unsigned int j=0; j<5000; j+=3){
+        long_values.push_back(j);
+        long_cols.push_back(j);
+    }
+    SparseMatrixCSR<double> LONG_CSR{1,5000,long_values,long_cols,{0,(unsigned int)long_cols.size()}};
+    bool long_ok = true;
+    for(unsigned int j=0; j<5000; j++){
+        long_ok = long_ok && (double)LONG_CSR(0,j)==((j%3==0) ? (double)j : 0.);
+    }
+    std::cout<<std::endl<<"All the 5000 entries of a long row read correctly: "<<(long_ok ? "yes" : "no")<<std::endl;
+    std::cout<<std::endl;
+
     // ////////////////////////////////////////////////////////////////////////////////////
     std::cout << "---------------------------------------------------------"<<std::endl;
     std::cout<<  "            CSR ASSIGNMENT OPERATOR (=) TEST             "<<std::endl;
@@ -246,11 +448,1160 @@ int main(){
     M3_COO->print();
     M3_COO->get_info();
     std::cout<<std::endl;
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    std::cout<<  "           PARALLEL COO to CSR CONVERSION TEST           "<<std::endl;
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    /*We take the nonzeros of the 1000x1000 matrix in reverse order (so rows are not sorted)*/
+    std::vector<double> big_coo_values(big_values.rbegin(), big_values.rend());
+    std::vector<unsigned int> big_coo_cols(big_cols.rbegin(), big_cols.rend());
+    std::vector<unsigned int> big_coo_rows;
+    for(unsigned int i=big_n; i>0; i--){
+        big_coo_rows.insert(big_coo_rows.end(), big_rows_idx[i]-big_rows_idx[i-1], i-1);
+    }
+    SparseMatrixCOO<double> *BIG_COO_1= new SparseMatrixCOO<double>{big_n,big_n,big_coo_values,big_coo_cols,big_coo_rows};
+    SparseMatrixCOO<double> *BIG_COO_4= new SparseMatrixCOO<double>{*BIG_COO_1};
+    BIG_COO_4->set_threads(4);
+    SparseMatrixCSR<double> *BIG_CSR_1 = COO_to_CSR(BIG_COO_1);
+    SparseMatrixCSR<double> *BIG_CSR_4 = COO_to_CSR(BIG_COO_4);
+    bool same_conversion = BIG_CSR_1->get_values()==BIG_CSR_4->get_values() &&
+                           BIG_CSR_1->get_cols()==BIG_CSR_4->get_cols() &&
+                           BIG_CSR_1->get_rows_idx()==BIG_CSR_4->get_rows_idx();
+    std::cout<<"Parallel conversion equal to serial one: "<<(same_conversion ? "yes" : "no")<<std::endl;
+    std::cout<<"Rows_idx equal to the original one: "<<(BIG_CSR_4->get_rows_idx()==big_rows_idx ? "yes" : "no")<<std::endl;
+    delete BIG_CSR_1;
+    delete BIG_CSR_4;
+    std::cout<<std::endl;
+
     /*Since we have a dynamic allocation as a return from the convertion, we have to manually delete it
     NB: M_COO and M3_CSR had already been deallocated when converted!*/
     std::cout<<"Manual deallocation of the (remaining) matrices allocated dynamically:"<<std::endl;
     delete M3_COO;
 
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "/////////////////////////////////////////////////////////"<<std::endl;
+    std::cout << "/////////////////////  SELL TESTS ///////////////////////"<<std::endl;
+    std::cout << "/////////////////////////////////////////////////////////"<<std::endl;
+    std::cout<<std::endl;
+
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    std::cout<<  "           DECLARATION OF A SELL SPARSE MATRIX           "<<std::endl;
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    /*Same matrix as M_CSR (original version), with chunks of C=2 rows sorted in windows of sigma=4 rows*/
+    SparseMatrixSELL<double> M_SELL{4,5,values,cols,rows_idx,2,4};
+    std::cout<< "Let's consider the following double matrix (M_SELL):"<<std::endl;
+    M_SELL.print();
+    M_SELL.get_info();
+    std::cout<<std::endl;
+
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    std::cout<<  "           READING/WRITING ON SELL MATRIX TEST           "<<std::endl;
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    std::cout<<"M_SELL(0,2): "<<M_SELL(0,2)<<std::endl;
+    std::cout<<"M_SELL(0,0): "<<M_SELL(0,0)<<std::endl;
+    /*Writing a new nonzero in a full row adds a new slot to its chunk, writing a zero frees it*/
+    M_SELL(0,0)=4;
+    M_SELL(2,1)=1;
+    M_SELL(1,4)=0;
+    std::cout<<"After M_SELL(0,0)=4, M_SELL(2,1)=1, M_SELL(1,4)=0 the matrix has changed to:"<<std::endl;
+    M_SELL.print();
+    M_SELL.get_info();
+    std::cout<<std::endl;
+
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    std::cout<<  "         MATRIX(SELL)-VECTOR MULTIPLICATION TEST         "<<std::endl;
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    res = M_SELL*vec;
+    std::cout<<std::endl<<"Multiplication by [1,1,1,1,1]: ";
+    print_vector<double>(res);
+    res = M_SELL*e2;
+    std::cout<<std::endl<<"Multiplication by [0,1,0,0,0]: ";
+    print_vector<double>(res);
+    std::cout<<std::endl;
+    /*On the 1000x1000 matrix we compare SELL (serial and parallel) with CSR*/
+    SparseMatrixCSR<double> *BIG_CSR_COPY = new SparseMatrixCSR<double>{BIG_CSR};
+    SparseMatrixSELL<double> *BIG_SELL = CSR_to_SELL(BIG_CSR_COPY, 8, 64);
+    std::cout<<"1000x1000 matrix converted to SELL-8-64: "<<BIG_SELL->get_nzeros()<<" nonzeros, "
+             <<BIG_SELL->get_values().size()<<" stored elements"<<std::endl;
+    std::vector<double> sell_res = (*BIG_SELL)*big_vec;
+    BIG_SELL->set_threads(4);
+    std::vector<double> sell_res_par = (*BIG_SELL)*big_vec;
+    double sell_err=0.;
+    for(unsigned int i=0; i<big_n; i++){
+        sell_err = std::max(sell_err, std::abs(sell_res[i]-serial_res[i]));
+    }
+    std::cout<<"Max difference from CSR: "<<std::scientific<<sell_err<<std::fixed<<std::endl;
+    std::cout<<"Parallel result equal to serial one: "<<(sell_res==sell_res_par ? "yes" : "no")<<std::endl;
+    delete BIG_SELL;
+    std::cout<<std::endl;
+
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "/////////////////////////////////////////////////////////"<<std::endl;
+    std::cout << "/////////////////////  BSR TESTS ////////////////////////"<<std::endl;
+    std::cout << "/////////////////////////////////////////////////////////"<<std::endl;
+    std::cout<<std::endl;
+
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    std::cout<<  "                CSR to BSR CONVERSION TEST               "<<std::endl;
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    /*A 6x6 matrix made of dense 2x2 blocks (as from a system with 2 unknowns per node)*/
+    std::vector<double> block_values{1,2,5,6, 3,4,7,8, 9,1, 2,3, 4,5,6,7, 8,9,1,2};
+    std::vector<unsigned int> block_cols{0,1,4,5, 0,1,4,5, 2,3, 2,3, 2,3,4,5, 2,3,4,5};
+    std::vector<unsigned int> block_rows_idx{0,4,8,10,12,16,20};
+    SparseMatrixCSR<double> *B_CSR = new SparseMatrixCSR<double>{6,6,block_values,block_cols,block_rows_idx};
+    std::cout<<"Let's consider the following CSR matrix (B_CSR):"<<std::endl;
+    B_CSR->print();
+    std::vector<double> b_vec{1.,2.,3.,4.,5.,6.};
+    std::vector<double> b_csr_res = (*B_CSR)*b_vec;
+    unsigned int block_size = detect_block_size(*B_CSR);
+    std::cout<<"Detected block size: "<<block_size<<"x"<<block_size<<std::endl;
+    SparseMatrixBSR<double,2,2> *B_BSR = CSR_to_BSR<2,2>(B_CSR);
+    B_BSR->print();
+    B_BSR->get_info();
+    /*A 5x5 matrix cannot be split in 2x2 blocks: the conversion is rejected and the input is left untouched*/
+    SparseMatrixCSR<double> *ODD_CSR = new SparseMatrixCSR<double>{5,5,{1.,2.},{0,4},{0,1,1,1,1,2}};
+    try{
+        delete CSR_to_BSR<2,2>(ODD_CSR);
+    }
+    catch(const std::invalid_argument &error){
+        std::cout<<"5x5 matrix in 2x2 blocks: "<<error.what()<<std::endl;
+    }
+    delete ODD_CSR;
+    std::cout<<std::endl;
+
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    std::cout<<  "            READING/WRITING ON BSR MATRIX TEST           "<<std::endl;
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    std::cout<<"B_BSR(0,5): "<<(*B_BSR)(0,5)<<std::endl;
+    std::cout<<"B_BSR(0,2): "<<(*B_BSR)(0,2)<<std::endl;
+    /*Writing in a new block adds the whole block, zeroing a whole block removes it*/
+    (*B_BSR)(5,0)=1;
+    (*B_BSR)(2,2)=0;
+    (*B_BSR)(2,3)=0;
+    (*B_BSR)(3,2)=0;
+    (*B_BSR)(3,3)=0;
+    std::cout<<"After B_BSR(5,0)=1 and zeroing the block (1,1) the matrix has changed to:"<<std::endl;
+    B_BSR->print();
+    B_BSR->get_info();
+    std::cout<<std::endl;
+
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    std::cout<<  "          MATRIX(BSR)-VECTOR MULTIPLICATION TEST         "<<std::endl;
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    (*B_BSR)(5,0)=0;
+    (*B_BSR)(2,2)=9;
+    (*B_BSR)(2,3)=1;
+    (*B_BSR)(3,2)=2;
+    (*B_BSR)(3,3)=3;
+    std::cout<<"Multiplication by [1,2,3,4,5,6] (CSR): ";
+    print_vector<double>(b_csr_res);
+    std::cout<<"Multiplication by [1,2,3,4,5,6] (BSR): ";
+    print_vector<double>((*B_BSR)*b_vec);
+    B_BSR->set_threads(2);
+    std::cout<<"Multiplication by [1,2,3,4,5,6] (BSR, 2 threads): ";
+    print_vector<double>((*B_BSR)*b_vec);
+    delete B_BSR;
+    std::cout<<std::endl;
+
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "/////////////////////////////////////////////////////////"<<std::endl;
+    std::cout << "/////////////////////  CSC TESTS ////////////////////////"<<std::endl;
+    std::cout << "/////////////////////////////////////////////////////////"<<std::endl;
+    std::cout<<std::endl;
+
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    std::cout<<  "                CSR to CSC CONVERSION TEST               "<<std::endl;
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    /*Same matrix as M_CSR (original version)*/
+    SparseMatrixCSC<double> *M_CSC = CSR_to_CSC(new SparseMatrixCSR<double>{4,5,values,cols,rows_idx});
+    std::cout<< "M_CSR converted to CSC (M_CSC):"<<std::endl;
+    M_CSC->print();
+    M_CSC->get_info();
+    std::cout<<std::endl;
+
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    std::cout<<  "            READING/WRITING ON CSC MATRIX TEST           "<<std::endl;
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    std::cout<<"M_CSC(0,2): "<<(*M_CSC)(0,2)<<std::endl;
+    std::cout<<"M_CSC(0,0): "<<(*M_CSC)(0,0)<<std::endl;
+    (*M_CSC)(0,0)=4;
+    (*M_CSC)(1,4)=0;
+    std::cout<<"After M_CSC(0,0)=4 and M_CSC(1,4)=0 the matrix has changed to:"<<std::endl;
+    M_CSC->print();
+    M_CSC->get_info();
+    std::cout<<std::endl;
+
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    std::cout<<  "   MATRIX(CSC)-VECTOR AND TRANSPOSED MULTIPLICATION TEST "<<std::endl;
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    res = (*M_CSC)*vec;
+    std::cout<<"Multiplication by [1,1,1,1,1]: ";
+    print_vector<double>(res);
+    std::vector<double> csc_t_res(5);
+    M_CSC->multiply_transposed(1., std::vector<double>{1,1,1,1}, 0., csc_t_res);
+    std::cout<<"Transposed multiplication by [1,1,1,1] (column sums): ";
+    print_vector<double>(csc_t_res);
+    SparseMatrixCSR<double> *M_CSR_BACK = CSC_to_CSR(M_CSC);
+    std::cout<<"Back to CSR:"<<std::endl;
+    M_CSR_BACK->print();
+    delete M_CSR_BACK;
+    /*The transposed CSR product scatters the rows: in parallel each thread uses its own copy of the result*/
+    std::vector<double> t_serial(big_n), t_parallel(big_n);
+    BIG_CSR.set_threads(1);
+    BIG_CSR.multiply_transposed(1., big_vec, 0., t_serial);
+    BIG_CSR.set_threads(4);
+    BIG_CSR.multiply_transposed(1., big_vec, 0., t_parallel);
+    BIG_CSR.set_threads(1);
+    double t_err=0.;
+    for(unsigned int i=0; i<big_n; i++) t_err = std::max(t_err, std::abs(t_parallel[i]-t_serial[i]));
+    std::cout<<"1000x1000 matrix, parallel A^T*x max difference from serial: "<<std::scientific<<t_err<<std::fixed<<std::endl;
+    std::cout<<std::endl;
+
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "/////////////////////////////////////////////////////////"<<std::endl;
+    std::cout << "///////////////////  DYNAMIC TESTS //////////////////////"<<std::endl;
+    std::cout << "/////////////////////////////////////////////////////////"<<std::endl;
+    std::cout<<std::endl;
+
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    std::cout<<  "          READING/WRITING ON DYNAMIC MATRIX TEST         "<<std::endl;
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    SparseMatrixDynamic<double> M_DYN{4,5};
+    M_DYN(0,4)=4;
+    M_DYN(0,2)=3.1;
+    M_DYN(1,2)=5;
+    M_DYN(3,1)=2;
+    M_DYN(3,3)=6;
+    M_DYN(1,4)=7.4;
+    std::cout<<"Same matrix as M_CSR, written element by element in any order (M_DYN):"<<std::endl;
+    M_DYN.print();
+    M_DYN.get_info();
+    M_DYN(0,2)=0;
+    M_DYN(2,0)=1;
+    std::cout<<"After M_DYN(0,2)=0 and M_DYN(2,0)=1 the matrix has changed to:"<<std::endl;
+    M_DYN.print();
+    std::cout<<std::endl;
+
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    std::cout<<  "               DYNAMIC MATRIX FREEZE TEST                "<<std::endl;
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    /*Update phase: many random writes (a third of them zeros, i.e. removals) on a 2000x2000 matrix,
+      then read-heavy phase on its frozen CSR version*/
+    SparseMatrixDynamic<double> BIG_DYN{2000,2000};
+    unsigned long long seed = 12345;
+    for(unsigned int it=0; it<200000; it++){
+        seed = seed*6364136223846793005ULL + 1442695040888963407ULL;
+        unsigned int i = (seed>>33)%2000, j = (seed>>13)%2000;
+        BIG_DYN(i,j) = (it%3==0) ? 0. : (double)(it%10+1);
+    }
+    SparseMatrixCSR<double> *FROZEN_CSR = BIG_DYN.freeze();
+    std::vector<double> dyn_vec(2000);
+    for(unsigned int i=0; i<2000; i++) dyn_vec[i]=i%5;
+    std::vector<double> dyn_res = BIG_DYN*dyn_vec;
+    FROZEN_CSR->set_threads(4);
+    std::vector<double> frozen_res = (*FROZEN_CSR)*dyn_vec;
+    std::cout<<"Nonzeros after the updates: "<<BIG_DYN.get_nzeros()<<" (dynamic), "<<FROZEN_CSR->get_nzeros()<<" (frozen CSR)"<<std::endl;
+    std::cout<<"Product of the frozen CSR equal to the dynamic one: "<<(dyn_res==frozen_res ? "yes" : "no")<<std::endl;
+    delete FROZEN_CSR;
+    std::cout<<std::endl;
+
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "/////////////////////////////////////////////////////////"<<std::endl;
+    std::cout << "//////////////////  IN-PLACE PRODUCTS ///////////////////"<<std::endl;
+    std::cout << "/////////////////////////////////////////////////////////"<<std::endl;
+    std::cout<<std::endl;
+
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    std::cout<<  "       IN-PLACE MATRIX-VECTOR MULTIPLICATION TEST        "<<std::endl;
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    /*y = 2*A*x + 3*y and y = 2*A^T*x + 3*y on the 1000x1000 matrix in all formats, compared with
+      the results computed by hand (A^T*x is scattered row by row from the CSR vectors)*/
+    std::vector<double> y_start(big_n), y_ref(big_n), yt_ref(big_n, 0.);
+    for(unsigned int i=0; i<big_n; i++) y_start[i]=1.0/(i+1);
+    for(unsigned int i=0; i<big_n; i++){
+        y_ref[i] = 2*serial_res[i] + 3*y_start[i];
+        for(unsigned int k=big_rows_idx[i]; k<big_rows_idx[i+1]; k++){
+            yt_ref[big_cols[k]] += 2*big_values[k]*big_vec[i];
+        }
+    }
+    for(unsigned int i=0; i<big_n; i++) yt_ref[i] += 3*y_start[i];
+    SparseMatrixCSR<double> *INPLACE_CSR = new SparseMatrixCSR<double>{BIG_CSR};
+    SparseMatrixCOO<double> *INPLACE_COO = CSR_to_COO(new SparseMatrixCSR<double>{BIG_CSR});
+    SparseMatrixSELL<double> *INPLACE_SELL = CSR_to_SELL(new SparseMatrixCSR<double>{BIG_CSR}, 8, 64);
+    SparseMatrixBSR<double,2,2> *INPLACE_BSR = CSR_to_BSR<2,2>(new SparseMatrixCSR<double>{BIG_CSR});
+    SparseMatrixCSC<double> *INPLACE_CSC = CSR_to_CSC(new SparseMatrixCSR<double>{BIG_CSR});
+    SparseMatrixDynamic<double> *INPLACE_DYN = CSR_to_Dynamic(new SparseMatrixCSR<double>{BIG_CSR});
+    std::vector<SparseMatrix<double>*> inplace_matrices{INPLACE_COO, INPLACE_CSR, INPLACE_SELL, INPLACE_BSR, INPLACE_CSC,
+                                                        INPLACE_DYN};
+    std::vector<std::string> inplace_names{"COO", "CSR", "SELL", "BSR", "CSC", "Dynamic"};
+    std::vector<double> y(big_n);
+    for(unsigned int m=0; m<inplace_matrices.size(); m++){
+        double max_err=0., max_err_t=0.;
+        for(unsigned int threads : {1u, 4u}){
+            inplace_matrices[m]->set_threads(threads);
+            y = y_start;
+            inplace_matrices[m]->multiply(2., big_vec, 3., y);
+            for(unsigned int i=0; i<big_n; i++) max_err = std::max(max_err, std::abs(y[i]-y_ref[i]));
+            y = y_start;
+            inplace_matrices[m]->multiply_transposed(2., big_vec, 3., y);
+            for(unsigned int i=0; i<big_n; i++) max_err_t = std::max(max_err_t, std::abs(y[i]-yt_ref[i]));
+        }
+        std::cout<<inplace_names[m]<<" max difference (1 and 4 threads): "<<std::scientific<<max_err
+                 <<" (A*x), "<<max_err_t<<" (A^T*x)"<<std::fixed<<std::endl;
+    }
+    /*With beta=0 the old content of y is ignored (so it may contain anything, e.g. NaN)*/
+    std::fill(y.begin(), y.end(), std::nan(""));
+    INPLACE_CSR->multiply(1., big_vec, 0., y);
+    std::cout<<"beta=0 on a vector of NaN gives A*x: "<<(y==serial_res ? "yes" : "no")<<std::endl;
+    /*The raw pointer version can write into a contiguous part of a bigger buffer (x and y are read and written with
+      stride 1, so e.g. a column of a column-major block, not of a row-major one)*/
+    std::vector<double> buffer(2*big_n, 0.);
+    INPLACE_CSR->multiply(1., big_vec.data(), 0., buffer.data()+big_n);
+    std::cout<<"Product written in the second half of a buffer: "
+             <<(std::equal(serial_res.begin(), serial_res.end(), buffer.begin()+big_n) ? "yes" : "no")<<std::endl;
+    for(SparseMatrix<double> *matrix : inplace_matrices){
+        delete matrix;
+    }
+    std::cout<<std::endl;
+
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "/////////////////////////////////////////////////////////"<<std::endl;
+    std::cout << "///////////////////  MATRIX ASSEMBLY ////////////////////"<<std::endl;
+    std::cout << "/////////////////////////////////////////////////////////"<<std::endl;
+    std::cout<<std::endl;
+
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    std::cout<<  "                 TRIPLET ASSEMBLY TEST                   "<<std::endl;
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    /*Triplets can be added in any order and repeated (their values are summed), zeros are dropped*/
+    SparseAssembler<double> small_assembler(3,3);
+    small_assembler.add(2,2,1.);
+    small_assembler.add(0,1,2.);
+    small_assembler.add(2,2,4.);
+    small_assembler.add(1,0,3.);
+    small_assembler.add(0,1,-2.);
+    std::cout<<"Triplets (2,2,1) (0,1,2) (2,2,4) (1,0,3) (0,1,-2) assembled in CSR:"<<std::endl;
+    SparseMatrixCSR<double> *SMALL_CSR = small_assembler.finalize();
+    SMALL_CSR->print();
+    SMALL_CSR->get_info();
+    delete SMALL_CSR;
+    /*1D finite elements: each of the n_el elements adds its 2x2 stiffness matrix [1 -1; -1 1]
+      to the rows/columns of its two nodes. 4 threads assemble 1/4 of the elements each, in their own buffer*/
+    unsigned int n_el = 100000;
+    SparseAssembler<double> fem_assembler(n_el+1, n_el+1, 4);
+    fem_assembler.set_threads(4);
+    std::vector<std::thread> fem_workers;
+    for(unsigned int t=0; t<4; t++){
+        fem_workers.emplace_back([&, t](){
+            fem_assembler.reserve(4*(n_el/4+1), t);
+            for(unsigned int e=t*n_el/4; e<(t+1)*n_el/4; e++){
+                fem_assembler.add(e, e, 1., t);
+                fem_assembler.add(e, e+1, -1., t);
+                fem_assembler.add(e+1, e, -1., t);
+                fem_assembler.add(e+1, e+1, 1., t);
+            }
+        });
+    }
+    for(std::thread &w : fem_workers){
+        w.join();
+    }
+    std::cout<<std::endl<<"1D stiffness matrix with "<<n_el<<" elements: "<<fem_assembler.get_ntriplets()<<" triplets"<<std::endl;
+    SparseMatrixCSR<double> *FEM_CSR = fem_assembler.finalize();
+    bool fem_ok = FEM_CSR->get_nzeros()==3*n_el+1;
+    for(unsigned int i=0; i<=n_el && fem_ok; i+=n_el/10){
+        double diagonal = (i==0 || i==n_el) ? 1. : 2.;
+        fem_ok = (*FEM_CSR)(i,i)==diagonal && (i==n_el || (*FEM_CSR)(i,i+1)==-1.);
+    }
+    std::cout<<"Assembled "<<FEM_CSR->get_nzeros()<<" nonzeros, tridiagonal [-1 2 -1] as expected: "
+             <<(fem_ok ? "yes" : "no")<<std::endl;
+    delete FEM_CSR;
+    std::cout<<std::endl;
+
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "/////////////////////////////////////////////////////////"<<std::endl;
+    std::cout << "//////////////////  ITERATIVE SOLVERS ///////////////////"<<std::endl;
+    std::cout << "/////////////////////////////////////////////////////////"<<std::endl;
+    std::cout<<std::endl;
+
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    std::cout<<  "          CONJUGATE GRADIENT AND BiCGSTAB TEST           "<<std::endl;
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    /*We build the 5-point discretization of -laplacian(u) + c*du/dx on a 30x30 grid:
+      with c=0 the matrix is symmetric positive definite (CG), otherwise it is non-symmetric (BiCGSTAB)*/
+    unsigned int grid=30, n_grid=grid*grid;
+    auto grid_matrix = [&](const double c){
+        std::vector<double> g_values;
+        std::vector<unsigned int> g_cols, g_rows_idx{0};
+        for(unsigned int i=0; i<n_grid; i++){
+            unsigned int gx=i%grid, gy=i/grid;
+            if(gy>0)      {g_values.push_back(-1);    g_cols.push_back(i-grid);}
+            if(gx>0)      {g_values.push_back(-1-c);  g_cols.push_back(i-1);}
+            g_values.push_back(4);                    g_cols.push_back(i);
+            if(gx<grid-1) {g_values.push_back(-1+c);  g_cols.push_back(i+1);}
+            if(gy<grid-1) {g_values.push_back(-1);    g_cols.push_back(i+grid);}
+            g_rows_idx.push_back(g_cols.size());
+        }
+        return SparseMatrixCSR<double>{n_grid,n_grid,g_values,g_cols,g_rows_idx};
+    };
+    std::vector<double> b_grid(n_grid, 1.);
+    for(double c : {0., 0.5}){
+        SparseMatrixCSR<double> A_grid = grid_matrix(c);
+        JacobiPreconditioner<double> jacobi(A_grid);
+        ILU0Preconditioner<double> ilu0(A_grid);
+        std::vector<const Preconditioner<double>*> preconds{nullptr, &jacobi, &ilu0};
+        std::vector<std::string> precond_names{"no preconditioner", "Jacobi", "ILU(0)"};
+        SolverCG<double> cg(A_grid, 2000, 1e-10);
+        SolverBiCGSTAB<double> bicgstab(A_grid, 2000, 1e-10);
+        std::vector<IterativeSolver<double>*> solvers{&cg, &bicgstab};
+        std::vector<std::string> solver_names{"CG", "BiCGSTAB"};
+        std::cout<<"Grid matrix with c="<<c<<(c==0. ? " (symmetric):" : " (non-symmetric):")<<std::endl;
+        for(unsigned int s_idx=(c==0. ? 0 : 1); s_idx<solvers.size(); s_idx++){
+            for(unsigned int p_idx=0; p_idx<preconds.size(); p_idx++){
+                std::vector<double> x_grid(n_grid, 0.), check(n_grid);
+                SolverResult sol = solvers[s_idx]->solve(b_grid, x_grid, preconds[p_idx]);
+                /*The true residual b-A*x is computed again from scratch*/
+                check = b_grid;
+                A_grid.multiply(-1., x_grid, 1., check);
+                double true_res=0.;
+                for(double v : check) true_res += v*v;
+                std::cout<<"  "<<solver_names[s_idx]<<" with "<<precond_names[p_idx]<<": "
+                         <<(sol.converged ? "converged" : "not converged")<<" in "<<sol.iterations<<" iterations, "
+                         <<"true relative residual "<<std::scientific<<std::sqrt(true_res/n_grid)<<std::fixed<<std::endl;
+            }
+        }
+    }
+    /*A missing diagonal element cannot be inverted: the preconditioners reject it (also without asserts)*/
+    SparseMatrixCSR<double> NO_DIAG{2,2,{1.,1.},{1,0},{0,1,2}};
+    try{
+        JacobiPreconditioner<double> jacobi(NO_DIAG);
+    }
+    catch(const std::invalid_argument &error){
+        std::cout<<"Jacobi on [[0,1],[1,0]]: "<<error.what()<<std::endl;
+    }
+    try{
+        ILU0Preconditioner<double> ilu0(NO_DIAG);
+    }
+    catch(const std::invalid_argument &error){
+        std::cout<<"ILU(0) on [[0,1],[1,0]]: "<<error.what()<<std::endl;
+    }
+    std::cout<<std::endl;
+
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    std::cout<<  "          STATIC (COMPILE-TIME) DISPATCH TEST            "<<std::endl;
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    /*The same generic code is run on a SparseMatrix<double>& (virtual calls) and on the format itself
+      (direct calls through SparseFormat, that the compiler can inline)*/
+    auto band_sum = [&](auto &matrix, const unsigned int repetitions){
+        double sum=0.;
+        for(unsigned int r=0; r<repetitions; r++){
+            for(unsigned int i=0; i<matrix.get_nrows(); i++){
+                for(unsigned int j=(i>0 ? i-1 : 0); j<std::min(i+2, matrix.get_ncols()); j++){
+                    sum += matrix(i,j);
+                }
+            }
+        }
+        return sum;
+    };
+    SparseMatrixCSR<double> A_static = grid_matrix(0.);
+    SparseMatrix<double> &A_dynamic = A_static;
+    auto start = std::chrono::steady_clock::now();
+    double sum_dynamic = band_sum(A_dynamic, 2000);
+    double time_dynamic = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()-start).count();
+    start = std::chrono::steady_clock::now();
+    double sum_static = band_sum(A_static, 2000);
+    double time_static = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()-start).count();
+    std::cout<<"Band element reads through SparseMatrix<double>&: "<<time_dynamic<<" ms, through SparseMatrixCSR<double>&: "
+             <<time_static<<" ms, same sum: "<<(sum_dynamic==sum_static ? "yes" : "no")<<std::endl;
+    /*The solvers are templates on the matrix type too: with the format the product is a direct call*/
+    SolverCG<double> cg_dynamic(A_dynamic, 2000, 1e-10);
+    SolverCG<double, SparseMatrixCSR<double>> cg_static(A_static, 2000, 1e-10);
+    std::vector<double> x_dynamic(n_grid, 0.), x_static(n_grid, 0.);
+    SolverResult sol_dynamic = cg_dynamic.solve(b_grid, x_dynamic);
+    SolverResult sol_static = cg_static.solve(b_grid, x_static);
+    std::cout<<"CG through SparseMatrix<double>&: "<<sol_dynamic.iterations<<" iterations, through SparseMatrixCSR<double>&: "
+             <<sol_static.iterations<<" iterations, same solution: "<<(x_dynamic==x_static ? "yes" : "no")<<std::endl;
+    std::cout<<std::endl;
+
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    std::cout<<  "                   INDEX TYPES TEST                      "<<std::endl;
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    /*A banded matrix with 60000 columns: 16-bit column indices are enough, so the column vector takes half the memory
+      (64-bit row pointers are needed only beyond 4.29 billion nonzeros, here they just show that nothing changes)*/
+    unsigned int n_band=60000, half_band=15;
+    std::vector<double> band_values;
+    std::vector<unsigned int> band_cols, band_rows_idx{0};
+    for(unsigned int i=0; i<n_band; i++){
+        for(unsigned int j=(i>half_band ? i-half_band : 0); j<=std::min(i+half_band, n_band-1); j++){
+            band_values.push_back(1.0/(1+i+j));
+            band_cols.push_back(j);
+        }
+        band_rows_idx.push_back(band_cols.size());
+    }
+    SparseMatrixCSR<double> *BAND_32 = new SparseMatrixCSR<double>{n_band, n_band, band_values, band_cols, band_rows_idx};
+    SparseMatrixCSR<double, unsigned short> *BAND_16 =
+        CSR_to_CSR<unsigned short, unsigned int>(new SparseMatrixCSR<double>(*BAND_32));
+    SparseMatrixCSR<double, unsigned int, unsigned long long> *BAND_64 =
+        CSR_to_CSR<unsigned int, unsigned long long>(new SparseMatrixCSR<double>(*BAND_32));
+    std::vector<double> x_band(n_band, 1.), y_32(n_band), y_16(n_band), y_64(n_band);
+    double t_32 = time_products(*BAND_32, x_band, y_32, 50);
+    double t_16 = time_products(*BAND_16, x_band, y_16, 50);
+    double t_64 = time_products(*BAND_64, x_band, y_64, 50);
+    auto index_bytes = [](auto &matrix){
+        return matrix.get_cols().size()*sizeof(matrix.get_cols()[0])
+               + matrix.get_rows_idx().size()*sizeof(matrix.get_rows_idx()[0]);
+    };
+    std::cout<<"Banded matrix with "<<BAND_32->get_nzeros()<<" nonzeros:"<<std::endl;
+    std::cout<<"  32-bit columns, 32-bit row pointers: "<<index_bytes(*BAND_32)/1e6<<" MB of indices, "
+             <<t_32<<" ms per product"<<std::endl;
+    std::cout<<"  16-bit columns, 32-bit row pointers: "<<index_bytes(*BAND_16)/1e6<<" MB of indices, "
+             <<t_16<<" ms per product, same result: "<<(y_16==y_32 ? "yes" : "no")<<std::endl;
+    std::cout<<"  32-bit columns, 64-bit row pointers: "<<index_bytes(*BAND_64)/1e6<<" MB of indices, "
+             <<t_64<<" ms per product, same result: "<<(y_64==y_32 ? "yes" : "no")<<std::endl;
+    delete BAND_32;
+    delete BAND_16;
+    delete BAND_64;
+    /*COO matrices with 16-bit indices are converted to CSR matrices with the same index types*/
+    SparseMatrixCOO<double, unsigned short> *SHORT_COO = new SparseMatrixCOO<double, unsigned short>{4, 5, values,
+        std::vector<unsigned short>(cols.begin(), cols.end()), std::vector<unsigned short>(rows.begin(), rows.end())};
+    SparseMatrixCSR<double, unsigned short> *SHORT_CSR = COO_to_CSR(SHORT_COO);
+    std::cout<<"M_COO with 16-bit indices, converted to CSR:"<<std::endl;
+    SHORT_CSR->print();
+    delete SHORT_CSR;
+    std::cout<<std::endl;
+
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    std::cout<<  "                    REORDERING TEST                      "<<std::endl;
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    /*A 300x300 grid (5-point stencil) whose nodes are numbered at random, as it happens with unstructured meshes:
+      the nonzeros are scattered all over the matrix, so the product reads x almost at random*/
+    unsigned int n_side=300, n_mesh=n_side*n_side;
+    std::vector<unsigned int> shuffled(n_mesh);
+    for(unsigned int k=0; k<n_mesh; k++){
+        shuffled[k] = k;
+    }
+    std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(42));
+    SparseAssembler<double> mesh_assembler(n_mesh, n_mesh);
+    for(unsigned int r=0; r<n_side; r++){
+        for(unsigned int c=0; c<n_side; c++){
+            unsigned int node = shuffled[r*n_side+c];
+            mesh_assembler.add(node, node, 4.);
+            if(r>0) mesh_assembler.add(node, shuffled[(r-1)*n_side+c], -1.);
+            if(r<n_side-1) mesh_assembler.add(node, shuffled[(r+1)*n_side+c], -1.);
+            if(c>0) mesh_assembler.add(node, shuffled[r*n_side+c-1], -1.);
+            if(c<n_side-1) mesh_assembler.add(node, shuffled[r*n_side+c+1], -1.);
+        }
+    }
+    SparseMatrixCSR<double> *MESH = mesh_assembler.finalize();
+    std::vector<double> x_mesh(n_mesh), y_mesh(n_mesh);
+    for(unsigned int k=0; k<n_mesh; k++){
+        x_mesh[k] = std::sin(0.001*k);
+    }
+    double t_mesh = time_products(*MESH, x_mesh, y_mesh, 50);
+    std::cout<<"Randomly numbered grid matrix: "<<t_mesh<<" ms per product"<<std::endl;
+    std::vector<ReorderingMethod> methods{ReorderingMethod::RCM, ReorderingMethod::NestedDissection};
+    std::vector<std::string> method_names{"RCM", "Nested dissection"};
+    for(unsigned int m=0; m<methods.size(); m++){
+        Reordering<double> reordering(*MESH, methods[m]);
+        std::cout<<method_names[m]<<":";
+        reordering.get_info();
+        SparseMatrixCSR<double> *REORDERED = reordering.permute(*MESH);
+        /*(P*A*P^T)*(P*x) = P*(A*x): restoring the order of the result gives back A*x*/
+        std::vector<double> x_perm = reordering.permute(x_mesh), y_perm(n_mesh);
+        double t_perm = time_products(*REORDERED, x_perm, y_perm, 50);
+        std::vector<double> y_restored = reordering.restore(y_perm);
+        double max_diff=0.;
+        for(unsigned int k=0; k<n_mesh; k++){
+            max_diff = std::max(max_diff, std::abs(y_restored[k]-y_mesh[k]));
+        }
+        std::cout<<"Reordered matrix: "<<t_perm<<" ms per product, max difference with A*x after restore: "
+                 <<std::scientific<<max_diff<<std::fixed<<std::endl;
+        delete REORDERED;
+    }
+    delete MESH;
+    std::cout<<std::endl;
+
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    std::cout<<  "                  MATRIX FILES TEST                      "<<std::endl;
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    /*A 400x400 grid matrix is written as a Matrix Market file and read back (serial and in parallel), then it is
+      written as a binary CSR file and mapped in memory*/
+    unsigned int io_side=400, n_io=io_side*io_side;
+    SparseAssembler<double> io_assembler(n_io, n_io);
+    for(unsigned int i=0; i<n_io; i++){
+        io_assembler.add(i, i, 4.+1./(i+1));
+        if(i>=io_side) io_assembler.add(i, i-io_side, -1.);
+        if(i+io_side<n_io) io_assembler.add(i, i+io_side, -1.);
+        if(i%io_side>0) io_assembler.add(i, i-1, -1./3);
+        if(i%io_side<io_side-1) io_assembler.add(i, i+1, -1./3);
+    }
+    SparseMatrixCSR<double> *IO = io_assembler.finalize();
+    std::string mtx_path = "sparse_matrix_test.mtx", bin_path = "sparse_matrix_test.csr";
+    auto elapsed_ms = [](const std::chrono::steady_clock::time_point &t0){
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()-t0).count();
+    };
+    auto t_io = std::chrono::steady_clock::now();
+    write_matrix_market(*IO, mtx_path);
+    std::cout<<"Matrix Market file with "<<IO->get_nzeros()<<" nonzeros written in "<<elapsed_ms(t_io)<<" ms"<<std::endl;
+    for(unsigned int threads : {1u, 4u}){
+        t_io = std::chrono::steady_clock::now();
+        SparseMatrixCSR<double> *READ = read_matrix_market<double>(mtx_path, threads);
+        double t_read = elapsed_ms(t_io);
+        std::cout<<"  read with "<<threads<<" thread(s) in "<<t_read<<" ms, same matrix: "
+                 <<(READ->get_values()==IO->get_values() && READ->get_cols()==IO->get_cols() &&
+                    READ->get_rows_idx()==IO->get_rows_idx() ? "yes" : "no")<<std::endl;
+        delete READ;
+    }
+    /*Symmetric files store only one triangle: the reader expands them*/
+    std::FILE *sym_file = std::fopen(mtx_path.c_str(), "w");
+    std::fprintf(sym_file, "%%%%MatrixMarket matrix coordinate real symmetric\n%% lower triangle only\n3 3 5\n"
+                           "1 1 2.0\n2 1 -1\n2 2 2.0\n3 2 -1e0\n3 3 2\n");
+    std::fclose(sym_file);
+    SparseMatrixCSR<double> *SYM = read_matrix_market<double>(mtx_path);
+    std::cout<<"Symmetric Matrix Market file (lower triangle):"<<std::endl;
+    SYM->print();
+    delete SYM;
+    std::remove(mtx_path.c_str());
+    /*Binary CSR file: opening it maps the file, the pages are read only when the product touches them*/
+    t_io = std::chrono::steady_clock::now();
+    write_binary(*IO, bin_path);
+    std::cout<<"Binary CSR file written in "<<elapsed_ms(t_io)<<" ms"<<std::endl;
+    {
+        t_io = std::chrono::steady_clock::now();
+        MappedMatrixCSR<double> MAPPED(bin_path);
+        double t_map = elapsed_ms(t_io);
+        std::vector<double> x_io(n_io), y_io(n_io);
+        for(unsigned int k=0; k<n_io; k++){
+            x_io[k] = std::cos(0.01*k);
+        }
+        IO->multiply(1., x_io, 0., y_io);
+        std::cout<<"  mapped in "<<t_map<<" ms, same product: "<<(MAPPED*x_io==y_io ? "yes" : "no")<<std::endl;
+        /*The body of the file is not covered by the checksum: validate() checks it, in O(nnz)*/
+        t_io = std::chrono::steady_clock::now();
+        MAPPED.validate();
+        std::cout<<"  validated in "<<elapsed_ms(t_io)<<" ms"<<std::endl;
+        /*The mapped matrix can be used by the solvers as any other format*/
+        SolverCG<double, MappedMatrixCSR<double>> cg_mapped(MAPPED, 2000, 1e-10);
+        SolverCG<double, SparseMatrixCSR<double>> cg_io(*IO, 2000, 1e-10);
+        std::vector<double> x_mapped(n_io, 0.), x_memory(n_io, 0.);
+        SolverResult sol_mapped = cg_mapped.solve(y_io, x_mapped);
+        cg_io.solve(y_io, x_memory);
+        std::cout<<"  CG on the mapped matrix: "<<sol_mapped.iterations<<" iterations, same solution as in memory: "
+                 <<(x_mapped==x_memory ? "yes" : "no")<<std::endl;
+    }
+    /*A corrupted column index is not detected when the file is opened, but by validate()*/
+    std::FILE *bin_file = std::fopen(bin_path.c_str(), "r+b");
+    BinaryHeader bin_header;
+    if(std::fread(&bin_header, sizeof(BinaryHeader), 1, bin_file)==1){
+        const unsigned int bad_col = n_io;
+        std::fseek(bin_file, bin_header.cols_offset, SEEK_SET);
+        std::fwrite(&bad_col, sizeof(unsigned int), 1, bin_file);
+    }
+    std::fclose(bin_file);
+    try{
+        MappedMatrixCSR<double> CORRUPTED(bin_path);
+        CORRUPTED.validate();
+    }
+    catch(const std::runtime_error &error){
+        std::cout<<"Corrupted column index: "<<error.what()<<std::endl;
+    }
+    /*A corrupted header is detected by the checksum*/
+    bin_file = std::fopen(bin_path.c_str(), "r+b");
+    std::fseek(bin_file, offsetof(BinaryHeader, n_cols), SEEK_SET);
+    std::fputc(0x7f, bin_file);
+    std::fclose(bin_file);
+    try{
+        MappedMatrixCSR<double> CORRUPTED(bin_path);
+    }
+    catch(const std::runtime_error &error){
+        std::cout<<"Corrupted file: "<<error.what()<<std::endl;
+    }
+    std::remove(bin_path.c_str());
+    delete IO;
+    std::cout<<std::endl;
+
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    std::cout<<  "                  SYMMETRIC FORMAT TEST                  "<<std::endl;
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    /*A small symmetric matrix: writing (i,j) also writes (j,i), since only the upper triangle is stored*/
+    SparseMatrixSymmetric<double> *SMALL_SYM = new SparseMatrixSymmetric<double>{4, {4., 1., 4., 2., 4., 4.},
+                                                                                 {0, 1, 1, 3, 2, 3}, {0, 2, 4, 5, 6}};
+    (*SMALL_SYM)(2,0) = -1.;
+    std::cout<<"Symmetric matrix after writing (2,0):"<<std::endl;
+    SMALL_SYM->print();
+    SMALL_SYM->get_info();
+    delete SMALL_SYM;
+    /*A 500x500 grid matrix (9-point stencil): CSR and symmetric versions of the same matrix*/
+    unsigned int sym_side=500, n_sym=sym_side*sym_side;
+    SparseAssembler<double> sym_assembler(n_sym, n_sym);
+    for(unsigned int r=0; r<sym_side; r++){
+        for(unsigned int c=0; c<sym_side; c++){
+            for(int dr=-1; dr<=1; dr++){
+                for(int dc=-1; dc<=1; dc++){
+                    if((int)r+dr>=0 && (int)r+dr<(int)sym_side && (int)c+dc>=0 && (int)c+dc<(int)sym_side){
+                        sym_assembler.add(r*sym_side+c, (r+dr)*sym_side+c+dc, (dr==0 && dc==0) ? 8. : -1.);
+                    }
+                }
+            }
+        }
+    }
+    SparseMatrixCSR<double> *SYM_CSR = sym_assembler.finalize();
+    SparseMatrixSymmetric<double> *SYM_HALF = CSR_to_Symmetric(new SparseMatrixCSR<double>(*SYM_CSR));
+    auto storage_bytes = [](auto &matrix){
+        return matrix.get_values().size()*sizeof(double)+matrix.get_cols().size()*sizeof(unsigned int)
+               +matrix.get_rows_idx().size()*sizeof(unsigned int);
+    };
+    std::cout<<"Grid matrix with "<<SYM_CSR->get_nzeros()<<" nonzeros ("<<SYM_HALF->get_nzeros()<<" in the symmetric "
+             <<"format, "<<SYM_HALF->get_nstored()<<" stored)"<<std::endl;
+    std::cout<<"  CSR: "<<storage_bytes(*SYM_CSR)/1e6<<" MB, symmetric: "<<storage_bytes(*SYM_HALF)/1e6<<" MB"<<std::endl;
+    std::vector<double> x_sym(n_sym), y_full(n_sym), y_half(n_sym);
+    for(unsigned int k=0; k<n_sym; k++){
+        x_sym[k] = std::sin(0.002*k);
+    }
+    for(unsigned int threads : {1u, 4u}){
+        SYM_CSR->set_threads(threads);
+        SYM_HALF->set_threads(threads);
+        double t_full = time_products(*SYM_CSR, x_sym, y_full, 50);
+        double t_half = time_products(*SYM_HALF, x_sym, y_half, 50);
+        double max_diff=0.;
+        for(unsigned int k=0; k<n_sym; k++){
+            max_diff = std::max(max_diff, std::abs(y_full[k]-y_half[k]));
+        }
+        std::cout<<"  "<<threads<<" thread(s): CSR "<<t_full<<" ms, symmetric "<<t_half<<" ms per product, "
+                 <<"max difference "<<std::scientific<<max_diff<<std::fixed<<std::endl;
+    }
+    /*Back to CSR: the same matrix as before*/
+    SparseMatrixCSR<double> *SYM_BACK = Symmetric_to_CSR(SYM_HALF);
+    std::cout<<"  converted back to CSR, same matrix: "<<(SYM_BACK->get_values()==SYM_CSR->get_values() &&
+               SYM_BACK->get_cols()==SYM_CSR->get_cols() ? "yes" : "no")<<std::endl;
+    delete SYM_BACK;
+    delete SYM_CSR;
+    /*A matrix with a_01 but not a_10 is not symmetric: it is rejected (and not deleted) also without asserts*/
+    SparseMatrixCSR<double> *NOT_SYM = new SparseMatrixCSR<double>{2,2,{1.,2.,3.},{0,1,1},{0,2,3}};
+    try{
+        delete CSR_to_Symmetric(NOT_SYM);
+    }
+    catch(const std::invalid_argument &error){
+        std::cout<<"Upper triangular 2x2 matrix: "<<error.what()<<std::endl;
+    }
+    delete NOT_SYM;
+    std::cout<<std::endl;
+
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    std::cout<<  "                  MIXED PRECISION TEST                   "<<std::endl;
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    /*A 600x600 grid matrix (5-point stencil, diagonal not representable in float) stored with double, float and
+      bfloat16 values: x, y and the sums are always double*/
+    unsigned int mixed_side=600, n_mixed=mixed_side*mixed_side;
+    SparseAssembler<double> mixed_assembler(n_mixed, n_mixed);
+    for(unsigned int i=0; i<n_mixed; i++){
+        mixed_assembler.add(i, i, 4.+1./(i+3));
+        if(i>=mixed_side) mixed_assembler.add(i, i-mixed_side, -1.);
+        if(i+mixed_side<n_mixed) mixed_assembler.add(i, i+mixed_side, -1.);
+        if(i%mixed_side>0) mixed_assembler.add(i, i-1, -0.7);
+        if(i%mixed_side<mixed_side-1) mixed_assembler.add(i, i+1, -0.7);
+    }
+    SparseMatrixCSR<double> *FULL = mixed_assembler.finalize();
+    SparseMatrixMixed<double, float> *MIXED_F = CSR_to_Mixed<float>(new SparseMatrixCSR<double>(*FULL));
+    SparseMatrixMixed<double, bfloat16> *MIXED_BF = CSR_to_Mixed<bfloat16>(new SparseMatrixCSR<double>(*FULL));
+    std::vector<double> x_mixed(n_mixed), y_mixed(n_mixed);
+    for(unsigned int k=0; k<n_mixed; k++){
+        x_mixed[k] = std::sin(0.003*k)+0.5;
+    }
+    std::cout<<"Grid matrix with "<<FULL->get_nzeros()<<" nonzeros, double values: "
+             <<time_products(*FULL, x_mixed, y_mixed, 50)<<" ms per product"<<std::endl;
+    std::cout<<"float values: "<<time_products(*MIXED_F, x_mixed, y_mixed, 50)<<" ms per product"<<std::endl;
+    precision_report(*FULL, *MIXED_F, x_mixed).print();
+    std::cout<<"bfloat16 values: "<<time_products(*MIXED_BF, x_mixed, y_mixed, 50)<<" ms per product"<<std::endl;
+    precision_report(*FULL, *MIXED_BF, x_mixed).print();
+    // The transposed product is the parallel scatter of CSR: 1 and 4 threads give the same result (up to rounding)
+    std::vector<double> yt_mixed_1(n_mixed), yt_mixed_4(n_mixed);
+    MIXED_F->multiply_transposed(1., x_mixed, 0., yt_mixed_1);
+    MIXED_F->set_threads(4);
+    MIXED_F->multiply_transposed(1., x_mixed, 0., yt_mixed_4);
+    MIXED_F->set_threads(1);
+    double mixed_t_err=0.;
+    for(unsigned int k=0; k<n_mixed; k++){
+        mixed_t_err = std::max(mixed_t_err, std::abs(yt_mixed_1[k]-yt_mixed_4[k]));
+    }
+    std::cout<<"float values, transposed product max difference (1 and 4 threads): "<<std::scientific
+             <<mixed_t_err<<std::fixed<<std::endl;
+    /*CG on the float matrix: the solution solves the rounded matrix, its residual on the full matrix is of the
+      order of the rounding of the values*/
+    std::vector<double> b_mixed = (*FULL)*x_mixed;
+    for(unsigned int s_idx=0; s_idx<2; s_idx++){
+        std::vector<double> x_cg(n_mixed, 0.), check = b_mixed;
+        SolverResult sol_mixed;
+        if(s_idx==0){
+            SolverCG<double, SparseMatrixCSR<double>> cg_full(*FULL, 2000, 1e-10);
+            sol_mixed = cg_full.solve(b_mixed, x_cg);
+        }
+        else{
+            SolverCG<double, SparseMatrixMixed<double, float>> cg_float(*MIXED_F, 2000, 1e-10);
+            sol_mixed = cg_float.solve(b_mixed, x_cg);
+        }
+        FULL->multiply(-1., x_cg, 1., check);
+        double true_res=0., b_norm=0.;
+        for(unsigned int k=0; k<n_mixed; k++){
+            true_res += check[k]*check[k];
+            b_norm += b_mixed[k]*b_mixed[k];
+        }
+        std::cout<<"CG on the "<<(s_idx==0 ? "double" : "float")<<" matrix: "<<sol_mixed.iterations
+                 <<" iterations, relative residual on the double matrix "<<std::scientific
+                 <<std::sqrt(true_res/b_norm)<<std::fixed<<std::endl;
+    }
+    delete FULL;
+    delete MIXED_F;
+    delete MIXED_BF;
+    std::cout<<std::endl;
+
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    std::cout<<  "                   TILED FORMAT TEST                     "<<std::endl;
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    /*A wide random matrix (x is much larger than the L2 cache): each row reads 40 random entries of x, so with CSR
+      almost every access to x is a miss, while each tile only reads a slice of x that stays in the cache*/
+    unsigned int tiled_rows=100000, tiled_cols=4000000, tiled_per_row=40;
+    std::mt19937 tiled_gen(7);
+    std::vector<double> tiled_values;
+    std::vector<unsigned int> tiled_c, tiled_r{0};
+    for(unsigned int i=0; i<tiled_rows; i++){
+        std::vector<unsigned int> row_cols(tiled_per_row);
+        for(unsigned int &j : row_cols){
+            j = tiled_gen()%tiled_cols;
+        }
+        std::sort(row_cols.begin(), row_cols.end());
+        row_cols.erase(std::unique(row_cols.begin(), row_cols.end()), row_cols.end());
+        for(unsigned int j : row_cols){
+            tiled_c.push_back(j);
+            tiled_values.push_back(1.+(tiled_gen()%1000)/1000.);
+        }
+        tiled_r.push_back(tiled_c.size());
+    }
+    SparseMatrixCSR<double> *WIDE = new SparseMatrixCSR<double>(tiled_rows, tiled_cols, tiled_values, tiled_c, tiled_r);
+    // Auto-tuned tile width (tile_width = 0)
+    SparseMatrixTiled<double> *TILED = CSR_to_Tiled(new SparseMatrixCSR<double>(*WIDE));
+    TILED->get_info();
+    std::vector<double> x_tiled(tiled_cols), y_wide(tiled_rows), y_tiled(tiled_rows);
+    for(unsigned int k=0; k<tiled_cols; k++){
+        x_tiled[k] = std::cos(0.001*k);
+    }
+    std::cout<<"CSR: "<<time_products(*WIDE, x_tiled, y_wide, 10)<<" ms per product"<<std::endl;
+    std::cout<<"Tiled: "<<time_products(*TILED, x_tiled, y_tiled, 10)<<" ms per product"<<std::endl;
+    double tiled_diff=0.;
+    for(unsigned int i=0; i<tiled_rows; i++){
+        tiled_diff = std::max(tiled_diff, std::abs(y_wide[i]-y_tiled[i]));
+    }
+    std::cout<<"Max difference between the two products: "<<tiled_diff<<std::endl;
+    /*Hardware counters are not always available (e.g. in containers), so the misses on x are counted by simulating a
+      16-way LRU cache as large as the L2 (64-byte lines) on the sequence of entries of x read by each format*/
+    auto simulated_misses = [](const std::vector<unsigned long long> &lines){
+        const unsigned int ways=16, n_sets=std::max(1u, 2*SparseMatrixTiled<double>::cache_columns()*8u/64/ways);
+        std::vector<unsigned long long> cache(n_sets*ways, ULLONG_MAX);
+        unsigned long long misses=0;
+        for(unsigned long long line : lines){
+            unsigned long long *set = cache.data()+(line%n_sets)*ways;
+            unsigned int w = 0;
+            while(w<ways-1 && set[w]!=line) w++;
+            if(set[w]!=line) misses++;
+            // The accessed line goes first, the others are shifted (the last one is evicted on a miss)
+            for(; w>0; w--) set[w] = set[w-1];
+            set[0] = line;
+        }
+        return 100.*misses/lines.size();
+    };
+    std::vector<unsigned long long> csr_lines, tiled_lines;
+    for(unsigned int j : WIDE->get_cols()){
+        csr_lines.push_back(j*sizeof(double)/64);
+    }
+    const std::vector<unsigned int> &tile_local = TILED->get_cols(), &tile_ptr = TILED->get_row_ptr();
+    for(unsigned int t=0; t<TILED->get_ntiles(); t++){
+        for(unsigned int k=tile_ptr[TILED->get_tiles_idx()[t]]; k<tile_ptr[TILED->get_tiles_idx()[t+1]]; k++){
+            tiled_lines.push_back((1ull*t*TILED->get_tile_width()+tile_local[k])*sizeof(double)/64);
+        }
+    }
+    // (the tiled rate depends on the width picked by the auto-tuning, which depends on the measured times)
+    std::cout<<"Simulated L2 miss rate on x: CSR "<<simulated_misses(csr_lines)<<"%, tiled with width "
+             <<TILED->get_tile_width()<<" "<<simulated_misses(tiled_lines)<<"%"<<std::endl;
+    delete WIDE;
+    delete TILED;
+    std::cout<<std::endl;
+
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    std::cout<<  "                    HYB FORMAT TEST                      "<<std::endl;
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    /*A power-law matrix (like the adjacency matrix of a graph): most rows have a few nonzeros, a few hubs have 10^5.
+      A hub cannot be split among the threads of the CSR product, the HYB product splits its tail as any other*/
+    unsigned int hyb_rows=300000, hyb_cols=300000;
+    std::mt19937 hyb_gen(11);
+    std::uniform_real_distribution<double> hyb_uniform(0., 1.);
+    std::vector<double> hyb_values;
+    std::vector<unsigned int> hyb_c, hyb_r{0};
+    for(unsigned int i=0; i<hyb_rows; i++){
+        const unsigned int degree = (i%60000==0) ? 100000 : std::min(1000., 2./std::pow(1.-hyb_uniform(hyb_gen), 0.6));
+        std::vector<unsigned int> row_cols(degree);
+        for(unsigned int &j : row_cols){
+            j = hyb_gen()%hyb_cols;
+        }
+        std::sort(row_cols.begin(), row_cols.end());
+        row_cols.erase(std::unique(row_cols.begin(), row_cols.end()), row_cols.end());
+        for(unsigned int j : row_cols){
+            hyb_c.push_back(j);
+            hyb_values.push_back(1./(1+j%7));
+        }
+        hyb_r.push_back(hyb_c.size());
+    }
+    SparseMatrixCSR<double> *GRAPH = new SparseMatrixCSR<double>(hyb_rows, hyb_cols, hyb_values, hyb_c, hyb_r);
+    SparseMatrixHYB<double> *HYB = CSR_to_HYB(new SparseMatrixCSR<double>(*GRAPH));
+    HYB->get_info();
+    // Work of the busiest of 16 threads, relative to the average (1 = perfect balance)
+    const unsigned int hyb_threads = 16;
+    std::vector<unsigned int> csr_blocks = nnz_partition(GRAPH->get_rows_idx(), hyb_threads);
+    unsigned int longest_row=0, busiest_csr=0;
+    for(unsigned int i=0; i<hyb_rows; i++){
+        longest_row = std::max(longest_row, hyb_r[i+1]-hyb_r[i]);
+    }
+    for(unsigned int t=0; t<hyb_threads; t++){
+        busiest_csr = std::max(busiest_csr, hyb_r[csr_blocks[t+1]]-hyb_r[csr_blocks[t]]);
+    }
+    const double hyb_average = (double)HYB->get_values().size()/hyb_threads + (double)HYB->get_tail().get_nzeros()/hyb_threads;
+    const double hyb_busiest = std::ceil((double)hyb_rows/hyb_threads)*HYB->get_ell_width()
+                               + std::ceil((double)HYB->get_tail().get_nzeros()/hyb_threads);
+    std::cout<<"Longest row: "<<longest_row<<" nonzeros"<<std::endl;
+    std::cout<<"Busiest of "<<hyb_threads<<" threads / average: CSR "<<busiest_csr/((double)GRAPH->get_nzeros()/hyb_threads)
+             <<", HYB "<<hyb_busiest/hyb_average<<std::endl;
+    std::vector<double> x_hyb(hyb_cols), y_graph(hyb_rows), y_hyb(hyb_rows);
+    for(unsigned int k=0; k<hyb_cols; k++){
+        x_hyb[k] = std::sin(0.01*k);
+    }
+    /*The better balance only shortens the product if each thread has its own core: with a single thread (or with
+      fewer cores than threads) HYB is a bit slower than CSR, since it also reads the padding of the slab and the
+      row index of each nonzero of the tail*/
+    std::cout<<"Cores available: "<<std::max(1u, std::thread::hardware_concurrency())<<std::endl;
+    for(unsigned int n_threads : {1u, hyb_threads}){
+        GRAPH->set_threads(n_threads);
+        HYB->set_threads(n_threads);
+        const double csr_time = time_products(*GRAPH, x_hyb, y_graph, 10);
+        const double hyb_time = time_products(*HYB, x_hyb, y_hyb, 10);
+        double hyb_diff=0.;
+        for(unsigned int i=0; i<hyb_rows; i++){
+            hyb_diff = std::max(hyb_diff, std::abs(y_graph[i]-y_hyb[i]));
+        }
+        std::cout<<n_threads<<" thread(s): CSR "<<csr_time<<" ms, HYB "<<hyb_time<<" ms per product (max difference "
+                 <<std::scientific<<hyb_diff<<std::fixed<<")"<<std::endl;
+    }
+    delete GRAPH;
+    delete HYB;
+    std::cout<<std::endl;
+
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    std::cout<<  "                 FORMAT SELECTOR TEST                    "<<std::endl;
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    /*Three matrices built in COO (as a user would do), each one handed to select_format: a grid matrix (symmetric),
+      a matrix made of dense 4x4 blocks and a power-law matrix. The product of the selected format is compared with
+      the one of the input matrix*/
+    std::mt19937 select_gen(5);
+    for(unsigned int example=0; example<3; example++){
+        const unsigned int n_select = (example==1) ? 100000 : 250000;
+        SparseAssembler<double> select_assembler(n_select, n_select);
+        for(unsigned int i=0; i<n_select; i++){
+            if(example==0){
+                const unsigned int side=500;
+                select_assembler.add(i, i, 4.);
+                if(i>=side) select_assembler.add(i, i-side, -1.);
+                if(i+side<n_select) select_assembler.add(i, i+side, -1.);
+                if(i%side>0) select_assembler.add(i, i-1, -1.);
+                if(i%side<side-1) select_assembler.add(i, i+1, -1.);
+            }
+            else if(example==1 && i%4==0){
+                // Three dense 4x4 blocks in each block row: the diagonal one and two random ones
+                for(unsigned int block_col : {i/4, (unsigned int)(select_gen()%(n_select/4)), (unsigned int)(select_gen()%(n_select/4))}){
+                    for(unsigned int r=0; r<4; r++){
+                        for(unsigned int c=0; c<4; c++){
+                            select_assembler.add(i+r, 4*block_col+c, 1.+r-0.5*c);
+                        }
+                    }
+                }
+            }
+            else if(example==2){
+                const unsigned int degree = (i%50000==0) ? 50000 : 1+select_gen()%4;
+                for(unsigned int k=0; k<degree; k++){
+                    select_assembler.add(i, select_gen()%n_select, 0.5);
+                }
+            }
+        }
+        SparseMatrix<double> *INPUT = CSR_to_COO(select_assembler.finalize());
+        std::vector<double> x_select(n_select), y_input(n_select), y_selected(n_select);
+        for(unsigned int k=0; k<n_select; k++){
+            x_select[k] = std::cos(0.02*k);
+        }
+        INPUT->multiply(1., x_select, 0., y_input);
+        FormatReport select_report;
+        SparseMatrix<double> *SELECTED = select_format(INPUT, true, &select_report);
+        std::cout<<std::endl;
+        select_report.print();
+        SELECTED->multiply(1., x_select, 0., y_selected);
+        double select_diff=0.;
+        for(unsigned int i=0; i<n_select; i++){
+            select_diff = std::max(select_diff, std::abs(y_input[i]-y_selected[i]));
+        }
+        std::cout<<"Max difference with the product of the input (COO) matrix: "<<std::scientific<<select_diff
+                 <<std::fixed<<std::endl;
+        /*Any format can be analyzed again: it is copied to CSR with its own conversion (linear in the nonzeros)*/
+        auto t_copy = std::chrono::steady_clock::now();
+        const MatrixStats selected_stats = analyze(*SELECTED);
+        std::cout<<"Analysis of the selected format: "<<selected_stats.nnz<<" nonzeros, "
+                 <<std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()-t_copy).count()
+                 <<" ms"<<std::endl;
+        delete SELECTED;
+    }
+    std::cout<<std::endl;
+
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    std::cout<<  "                TRIANGULAR SOLVE TEST                    "<<std::endl;
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    /*Forward sweep of Gauss-Seidel on a 1000x1000 grid matrix: (D+L)*x = b. The row i depends on the rows i-1 and
+      i-side, so the levels are the anti-diagonals of the grid (2*side-1 levels, up to side rows each)*/
+    unsigned int trsv_side=1000, n_trsv=trsv_side*trsv_side;
+    SparseAssembler<double> trsv_assembler(n_trsv, n_trsv);
+    for(unsigned int i=0; i<n_trsv; i++){
+        trsv_assembler.add(i, i, 4.);
+        if(i>=trsv_side) trsv_assembler.add(i, i-trsv_side, -1.);
+        if(i+trsv_side<n_trsv) trsv_assembler.add(i, i+trsv_side, -1.);
+        if(i%trsv_side>0) trsv_assembler.add(i, i-1, -1.);
+        if(i%trsv_side<trsv_side-1) trsv_assembler.add(i, i+1, -1.);
+    }
+    SparseMatrixCSR<double> *GRID = trsv_assembler.finalize();
+    std::vector<double> b_trsv(n_trsv), x_trsv(n_trsv), x_naive(n_trsv);
+    for(unsigned int k=0; k<n_trsv; k++){
+        b_trsv[k] = std::sin(0.001*k)+1.;
+    }
+    auto t_analysis = std::chrono::steady_clock::now();
+    SpTRSV<double> forward(*GRID, Triangle::Lower);
+    const double analysis_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()-t_analysis).count();
+    forward.get_info();
+    std::cout<<"Analysis: "<<analysis_time<<" ms (done once)"<<std::endl;
+    // Reference: the plain serial forward substitution on the CSR vectors
+    auto t_naive = std::chrono::steady_clock::now();
+    const std::vector<double> &grid_values = GRID->get_values();
+    const std::vector<unsigned int> &grid_cols = GRID->get_cols(), &grid_rows_idx = GRID->get_rows_idx();
+    for(unsigned int i=0; i<n_trsv; i++){
+        double sum = b_trsv[i], diagonal = 1.;
+        for(unsigned int k=grid_rows_idx[i]; k<grid_rows_idx[i+1]; k++){
+            if(grid_cols[k]<i) sum -= grid_values[k]*x_naive[grid_cols[k]];
+            else if(grid_cols[k]==i) diagonal = grid_values[k];
+        }
+        x_naive[i] = sum/diagonal;
+    }
+    std::cout<<"Plain forward substitution: "<<std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()-t_naive).count()
+             <<" ms"<<std::endl;
+    for(unsigned int n_threads : {1u, 4u}){
+        forward.set_threads(n_threads);
+        auto t_solve = std::chrono::steady_clock::now();
+        for(unsigned int r=0; r<10; r++){
+            forward.solve(b_trsv, x_trsv);
+        }
+        const double solve_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()-t_solve).count()/10;
+        double trsv_diff=0.;
+        for(unsigned int i=0; i<n_trsv; i++){
+            trsv_diff = std::max(trsv_diff, std::abs(x_trsv[i]-x_naive[i]));
+        }
+        std::cout<<"Level-set solve with "<<n_threads<<" thread(s) on "<<std::thread::hardware_concurrency()<<" core(s): "<<solve_time<<" ms per solve (max difference "
+                 <<std::scientific<<trsv_diff<<std::fixed<<")"<<std::endl;
+    }
+    delete GRID;
+    std::cout<<std::endl;
+
+    ////////////////////////////////////////////////////////////////////////////////////
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    std::cout<<  "                SPARSE VECTOR TEST                       "<<std::endl;
+    std::cout << "---------------------------------------------------------"<<std::endl;
+    /*Breadth-first search on the graph of a 400x400 grid (adjacency matrix, symmetric): the next frontier is
+      A^T*frontier without the visited nodes. From a corner the frontiers are anti-diagonals (at most 400 nodes), so
+      with a dense vector each of the 799 levels costs a full product, while the SpMSpV only reads the frontier rows*/
+    unsigned int bfs_side=400, n_bfs=bfs_side*bfs_side;
+    SparseAssembler<double> bfs_assembler(n_bfs, n_bfs);
+    for(unsigned int i=0; i<n_bfs; i++){
+        if(i>=bfs_side) bfs_assembler.add(i, i-bfs_side, 1.);
+        if(i+bfs_side<n_bfs) bfs_assembler.add(i, i+bfs_side, 1.);
+        if(i%bfs_side>0) bfs_assembler.add(i, i-1, 1.);
+        if(i%bfs_side<bfs_side-1) bfs_assembler.add(i, i+1, 1.);
+    }
+    SparseMatrixCSR<double> *BFS_GRAPH = bfs_assembler.finalize();
+    SparseVector<double> sv_example(8, {5, 1, 5}, {1., 2., 3.});
+    sv_example.print();
+    // (1) BFS with sparse frontiers
+    SpMSpV<double> spmspv;
+    std::vector<int> level_sparse(n_bfs, -1), level_dense(n_bfs, -1);
+    SparseVector<double> frontier(n_bfs, {0}, {1.}), reached;
+    unsigned long long total_touched=0;
+    unsigned int largest_frontier=0, n_bfs_levels=0;
+    level_sparse[0] = 0;
+    auto t_sparse_bfs = std::chrono::steady_clock::now();
+    while(frontier.get_nzeros()>0){
+        n_bfs_levels++;
+        largest_frontier = std::max(largest_frontier, frontier.get_nzeros());
+        spmspv.multiply_transposed(*BFS_GRAPH, frontier, reached);
+        total_touched += spmspv.get_touched();
+        std::vector<unsigned int> next;
+        for(const unsigned int i : reached.get_indices()){
+            if(level_sparse[i]<0){
+                level_sparse[i] = n_bfs_levels;
+                next.push_back(i);
+            }
+        }
+        frontier = SparseVector<double>(n_bfs, next, std::vector<double>(next.size(), 1.));
+    }
+    const double sparse_bfs_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()-t_sparse_bfs).count();
+    // (2) Same BFS with dense frontiers and the SpMV
+    std::vector<double> dense_frontier(n_bfs, 0.), dense_reached(n_bfs);
+    dense_frontier[0] = 1.;
+    level_dense[0] = 0;
+    auto t_dense_bfs = std::chrono::steady_clock::now();
+    for(unsigned int level=1; ; level++){
+        BFS_GRAPH->multiply_transposed(1., dense_frontier, 0., dense_reached);
+        bool found = false;
+        for(unsigned int i=0; i<n_bfs; i++){
+            dense_frontier[i] = 0.;
+            if(dense_reached[i]!=0. && level_dense[i]<0){
+                level_dense[i] = level;
+                dense_frontier[i] = 1.;
+                found = true;
+            }
+        }
+        if(!found) break;
+    }
+    const double dense_bfs_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()-t_dense_bfs).count();
+    std::cout<<"BFS on a "<<bfs_side<<"x"<<bfs_side<<" grid: "<<n_bfs_levels<<" levels, largest frontier "<<largest_frontier
+             <<" nodes, levels equal to the dense BFS: "<<(level_sparse==level_dense ? "yes" : "no")<<std::endl;
+    std::cout<<"Nonzeros read: SpMSpV "<<total_touched<<", dense SpMV "
+             <<(unsigned long long)n_bfs_levels*BFS_GRAPH->get_nzeros()<<std::endl;
+    std::cout<<"Time: SpMSpV "<<sparse_bfs_time<<" ms, dense SpMV "<<dense_bfs_time<<" ms"<<std::endl;
+    delete BFS_GRAPH;
+    std::cout<<std::endl;
+
     ////////////////////////////////////////////////////////////////////////////////////
     std::cout << "/////////////////////////////////////////////////////////"<<std::endl;
     std::cout << "End of main(): destruction of the remaining matrices:"<<std::endl<<std::endl;